@@ -1,14 +1,24 @@
 #include "App.h"
 
 #include "AppCtx.h"
+#include "ClipTiering.h"
 
+#include "audio/AudioFileImporter.h"
 #include "audio/AudioIO.h"
+#include "audio/MixdownExporter.h"
 #include "common/AppState.h"
+#include "common/ArrangementAudio.h"
+#include "common/Autosave.h"
 #include "common/MetronomeGenerator.h"
+#include "common/ProjectFile.h"
 #include "common/msg.h"
+#include "platform/AppMsgQueue.h"
 #include "platform/platform.h"
 #include "ui/UI.h"
 
+#include <filesystem>
+#include <fstream>
+
 namespace
 {
 AppState::AudioSettingsUI makeAudioSettingsUI(const vector<AudioDeviceProperties>& ads, const ActiveAudioDevices& as)
@@ -60,6 +70,9 @@ struct AppImpl
         : AppCtx(uiArg, appStateArg)
     {
         fmt::println("main thread: {}", this_thread::get_id());
+        if (std::getenv("DAWTRACKER_PROFILE_RSE")) {
+            rse.enableProfiling(true);
+        }
         audioIO->setAudioCallback([audioEngine_ = audioEngine.get()](
                                     span<const float*> inputChannels, span<float*> outputChannels, size_t numSamples
                                   ) {
@@ -69,73 +82,51 @@ struct AppImpl
         rse.registerUpdater(appState.audioSettingsUI, [this]() {
             return makeAudioSettingsUI(audioIO->getAudioDevices(), rse.get(appState.activeAudioDevices));
         });
-        rse.registerUpdater(appState.playButtonEnabled, [this]() {
-            return rse.get(appState.activeAudioDevices).outputDevice.has_value() && !rse.get(appState.clips).empty()
-                && !rse.get(appState.clipBeingRecorded);
-        });
-        rse.registerUpdater(appState.recordButtonEnabled, [this]() {
-            return rse.get(appState.activeAudioDevices).canRecord() && !rse.get(appState.clipBeingRecorded)
-                && !rse.get(appState.clipBeingPlayed);
-        });
-        rse.registerUpdater(appState.recordButton, [this]() {
-            return rse.get(appState.clipBeingRecorded).has_value();
-        });
-        rse.registerUpdater(appState.stopButtonEnabled, [this]() {
-            return rse.get(appState.clipBeingPlayed) || rse.get(appState.clipBeingRecorded).has_value();
-        });
-        rse.registerUpdater(appState.stopButton, [this]() {
-            return rse.get(appState.clipBeingPlayed) || rse.get(appState.clipBeingRecorded).has_value();
-        });
-        rse.registerUpdater(
-          appState.anyVariableDisplayedOnUIChanged,
-          []() {
-              return monostate{};
-          },
-          appState.audioSettingsUI,
-          appState.showAudioSettings,
-          appState.metronome,
-          appState.recordButtonEnabled,
-          appState.stopButtonEnabled,
-          appState.playButtonEnabled,
-          appState.recordButton,
-          appState.stopButton,
-          appState.inputs,
-          appState.outputs,
-          appState.clips
-        );
-        rse.registerUpdater(
-          appState.metronomeChanged,
-          []() {
-              return monostate{};
-          },
-          appState.metronome
-        );
-        rse.registerUpdater(appState.inputs, [this]() {
-            vector<AudioChannelPropertiesOnUI> inputs;
-            if (auto id = rse.get(appState.activeAudioDevices).inputDevice) {
-                inputs.reserve(id->channelNames.size());
-                for (auto& n : id->channelNames) {
-                    inputs.push_back(AudioChannelPropertiesOnUI{.name = n, .enabled = false});
-                }
-                for (auto i : id->activeChannels) {
-                    inputs.at(i).enabled = true;
-                }
-            }
-            return inputs;
-        });
-        rse.registerUpdater(appState.outputs, [this]() {
-            vector<AudioChannelPropertiesOnUI> outputs;
-            if (auto id = rse.get(appState.activeAudioDevices).outputDevice) {
-                outputs.reserve(id->channelNames.size());
-                for (auto& n : id->channelNames) {
-                    outputs.push_back(AudioChannelPropertiesOnUI{.name = n, .enabled = false});
-                }
-                for (auto i : id->activeChannels) {
-                    outputs.at(i).enabled = true;
-                }
-            }
-            return outputs;
-        });
+        appState.registerUpdaters();
+        ui->setInputLevelMeters(&audioEngine->inputLevelMeters());
+
+        clipTiering = make_unique<ClipTiering>(appState);
+        auto recoveredDir = recoverAutosavedProject();
+        auto autosaveErrorChanged = [](optional<string> error) {
+            sendToApp(msg::AutosaveStatus{MOVE(error)});
+        };
+        if (auto a =
+              Autosave::make(appState, Autosave::defaultDirectory(), MOVE(recoveredDir), MOVE(autosaveErrorChanged))) {
+            autosave = MOVE(*a);
+        } else {
+            LOG(ERROR) << fmt::format("Autosave disabled: {}", a.error());
+        }
+    }
+
+    unique_ptr<ClipTiering> clipTiering;
+    unique_ptr<Autosave> autosave;
+    unique_ptr<AudioFileImporter> audioFileImporter = AudioFileImporter::make();
+    unique_ptr<MixdownExporter> mixdownExporter = MixdownExporter::make();
+
+    // Returns the directory the project has been recovered from, nullptr if none.
+    unique_ptr<Autosave::LockedDir> recoverAutosavedProject()
+    {
+        auto lockedDir = Autosave::lockAbandonedDirectory(Autosave::defaultDirectory());
+        if (!lockedDir) {
+            return nullptr;
+        }
+        auto project = Autosave::recover(lockedDir->path());
+        if (!project) {
+            // Renamed so no instance tries to recover it again.
+            const auto dir = lockedDir->path();
+            lockedDir.reset(); // A directory with an open file can't be renamed on Windows.
+            auto keptDir = dir.parent_path() / "unrecovered_";
+            keptDir += dir.filename();
+            std::error_code ec;
+            std::filesystem::rename(dir, keptDir, ec);
+            LOG(ERROR) << fmt::format(
+              "Failed to recover the autosaved project, the files were moved to {}: {}", keptDir, project.error()
+            );
+            return nullptr;
+        }
+        setProject(appState, MOVE(*project));
+        LOG(WARNING) << "A previous session didn't exit cleanly, the autosaved project has been recovered";
+        return lockedDir;
     }
 
     void receiveMainMenu(msg::MainMenu m)
@@ -151,6 +142,178 @@ struct AppImpl
         case msg::MainMenu::hideSettings:
             rse.set(appState.showAudioSettings, false);
             break;
+        case msg::MainMenu::dumpStateGraph:
+            dumpStateGraph();
+            break;
+        case msg::MainMenu::saveProject:
+            saveProjectToDefaultPath();
+            break;
+        case msg::MainMenu::openProject:
+            openProjectFromDefaultPath();
+            break;
+        case msg::MainMenu::importAudioFiles:
+            importAudioFilesFromDefaultDirectory();
+            break;
+        }
+    }
+
+    // There's no file dialog yet, the project is kept at a fixed location.
+    static std::filesystem::path defaultProjectPath()
+    {
+        return std::filesystem::temp_directory_path() / "dawtracker_project.dtproj";
+    }
+
+    void saveProjectToDefaultPath()
+    {
+        auto path = defaultProjectPath();
+        if (auto r = saveProject(appState, path, ProjectAudioStorage::embeddedCompressed); !r) {
+            LOG(ERROR) << fmt::format("Failed to save project: {}", r.error());
+        } else {
+            LOG(INFO) << fmt::format("Project saved to {}", path);
+        }
+    }
+
+    void openProjectFromDefaultPath()
+    {
+        if (rse.get(appState.clipBeingRecorded) || rse.get(appState.clipBeingPlayed)) {
+            LOG(ERROR) << "Can't open a project while recording or playing";
+            return;
+        }
+        auto path = defaultProjectPath();
+        auto project = loadProject(path);
+        if (!project) {
+            LOG(ERROR) << fmt::format("Failed to open project: {}", project.error());
+            return;
+        }
+        setProject(appState, MOVE(*project));
+        LOG(INFO) << fmt::format("Project opened from {}", path);
+    }
+
+    // Without a file dialog the files to import are taken from a fixed directory.
+    static std::filesystem::path defaultImportDirectory()
+    {
+        return std::filesystem::temp_directory_path() / "dawtracker_import";
+    }
+
+    void importAudioFilesFromDefaultDirectory()
+    {
+        auto dir = defaultImportDirectory();
+        auto paths = audioFileImporter->findAudioFiles(dir);
+        if (paths.empty()) {
+            LOG(ERROR) << fmt::format("No audio files to import in {}", dir);
+            return;
+        }
+        const auto deviceSampleRate = rse.get(appState.activeAudioDevices).sampleRate;
+        const auto sampleRate = deviceSampleRate > 0 ? deviceSampleRate : double(TempoMap::k_defaultSampleRate);
+        const auto numFiles = paths.size();
+        if (!audioFileImporter->start(MOVE(paths), sampleRate)) {
+            LOG(ERROR) << "The previous import hasn't finished yet";
+            return;
+        }
+        LOG(INFO) << fmt::format("Importing {} files from {} at {} Hz", numFiles, dir, sampleRate);
+    }
+
+    void receiveAudioFilesImported(msg::AudioFilesImported&& m)
+    {
+        for (auto& e : m.errors) {
+            LOG(ERROR) << fmt::format("Import failed: {}", e);
+        }
+        const auto ids = Id<AudioClip>::makeN(m.clips.size());
+        vector<pair<Id<AudioClip>, AudioClip>> newClips;
+        newClips.reserve(m.clips.size());
+        for (size_t i : vi::iota(0u, m.clips.size())) {
+            newClips.emplace_back(ids[i], MOVE(m.clips[i]));
+        }
+        rse.insertAll(appState.clips, MOVE(newClips));
+        const auto seconds = m.duration.count();
+        const auto megabytes = double(m.numBytes) / 1e6;
+        LOG(INFO) << fmt::format(
+          "Imported {} files ({:.1f} MB) in {:.2f} s: {:.1f} files/s, {:.1f} MB/s",
+          m.clips.size(),
+          megabytes,
+          seconds,
+          double(m.clips.size()) / seconds,
+          megabytes / seconds
+        );
+    }
+
+    // Without a file dialog the mixdown is written to a fixed location.
+    static std::filesystem::path defaultMixdownPath(msg::Mixdown::Format format)
+    {
+        auto path = std::filesystem::temp_directory_path() / "dawtracker_mixdown";
+        switch (format) {
+        case msg::Mixdown::Format::wav:
+            path += ".wav";
+            break;
+        case msg::Mixdown::Format::flac:
+            path += ".flac";
+            break;
+        }
+        return path;
+    }
+
+    void receiveMixdown(msg::Mixdown::V&& m)
+    {
+        switch_variant(
+          m,
+          [this](const msg::Mixdown::Export& x) {
+              if (rse.get(appState.mixdownProgress)) {
+                  LOG(ERROR) << "The previous mixdown hasn't finished yet";
+                  return;
+              }
+              auto audio = ArrangementAudio::make(appState);
+              if (!audio) {
+                  LOG(ERROR) << fmt::format("Can't export the mixdown: {}", audio.error());
+                  return;
+              }
+              auto arrangement = std::make_shared<const ArrangementAudio>(MOVE(*audio));
+              if (arrangement->numSamples == 0) {
+                  LOG(ERROR) << "The arrangement is empty, there's nothing to export";
+                  return;
+              }
+              auto path = defaultMixdownPath(x.format);
+              const auto seconds = double(arrangement->numSamples) / arrangement->sampleRate();
+              if (!mixdownExporter->start(MOVE(arrangement), path, x.format)) {
+                  LOG(ERROR) << "The previous mixdown hasn't finished yet";
+                  return;
+              }
+              rse.set(appState.mixdownProgress, 0.0);
+              LOG(INFO) << fmt::format("Exporting the mixdown of {:.1f} seconds to {}", seconds, path);
+          },
+          [this](const msg::Mixdown::Cancel&) {
+              mixdownExporter->cancel();
+          },
+          [this](const msg::Mixdown::Progress& x) {
+              if (rse.get(appState.mixdownProgress)) {
+                  rse.set(appState.mixdownProgress, x.fraction);
+              }
+          },
+          [this](const msg::Mixdown::Finished& x) {
+              rse.set(appState.mixdownProgress, nullopt);
+              if (x.error) {
+                  LOG(ERROR) << fmt::format("Mixdown export failed: {}", *x.error);
+              } else if (x.cancelled) {
+                  LOG(INFO) << "Mixdown export cancelled";
+              } else {
+                  LOG(INFO) << fmt::format("Mixdown exported to {} in {:.2f} s", x.path, x.duration.count());
+              }
+          }
+        );
+    }
+
+    void dumpStateGraph()
+    {
+        auto dir = std::filesystem::temp_directory_path();
+        for (auto& [filename, content] :
+             {pair(dir / "dawtracker_rse.dot", rse.dumpGraphAsGraphviz()),
+              pair(dir / "dawtracker_rse.json", rse.dumpGraphAsJson())}) {
+            std::ofstream f(filename);
+            f << content;
+            if (!f) {
+                LOG(ERROR) << fmt::format("Failed to write {}", filename);
+            } else {
+                LOG(INFO) << fmt::format("State graph written to {}", filename);
+            }
         }
     }
 
@@ -216,11 +379,6 @@ struct AppImpl
         rse.set(appState.metronome, MOVE(metronome));
     }
 
-    void runAudioIODispatchLoop() override
-    {
-        audioIO->runDispatchLoopUntil(chr::milliseconds(1));
-    }
-
     void receiveTransport(msg::Transport t)
     {
         switch (t) {
@@ -233,6 +391,7 @@ struct AppImpl
               appState.clipBeingRecorded, AudioClip(aad.sampleRate, aad.inputDevice->activeChannels.size())
             );
             rse.set(appState.clipBeingRecordedSeconds, 0);
+            rse.set(appState.recordingWaveform, vector<PeakPyramid::Peak>{});
             audioEngine->record();
         } break;
         case msg::Transport::stop: {
@@ -256,6 +415,7 @@ struct AppImpl
         auto clipBeingRecorded = rse.exchange(appState.clipBeingRecorded, nullopt).value();
         CHECK(rse.insert(appState.clips, pair(Id<AudioClip>::make(), MOVE(clipBeingRecorded))).second);
         rse.set(appState.clipBeingRecordedSeconds, nullopt);
+        rse.set(appState.recordingWaveform, vector<PeakPyramid::Peak>{});
     }
 
     void receiveAudioEngine(const msg::AudioEngine::V& msg)
@@ -273,13 +433,25 @@ struct AppImpl
                   LOG(INFO) << "RecordingBufferRecorded when not recording";
                   return;
               }
-              CHECK(!clipBeingRecordedConst->channels.empty());
+              CHECK(clipBeingRecordedConst->numChannels() != 0);
               // Add buffer to current clip.
               auto clipBeingRecorded = rse.exchange(appState.clipBeingRecorded, nullopt);
               clipBeingRecorded->append(*x.recordingBuffer);
-              auto numChannels = clipBeingRecorded->channels[0].size();
+              auto numChannels = clipBeingRecorded->channels()[0].size();
               rse.setAsDifferent(appState.clipBeingRecorded, MOVE(clipBeingRecorded));
 
+              // One column for the buffer, all channels merged.
+              auto& channels = x.recordingBuffer->channels;
+              auto column = PeakPyramid::summarize(channels[0]);
+              for (size_t i : vi::iota(1u, channels.size())) {
+                  column = PeakPyramid::merge(
+                    column, i * channels[0].size(), PeakPyramid::summarize(channels[i]), channels[i].size()
+                  );
+              }
+              auto recordingWaveform = rse.exchange(appState.recordingWaveform, vector<PeakPyramid::Peak>{});
+              recordingWaveform.push_back(column);
+              rse.setAsDifferent(appState.recordingWaveform, MOVE(recordingWaveform));
+
               x.recordingBuffer->sentToApp = false;
               LOG(INFO) << fmt::format(
                 "[{}]->sentToApp = false, {} ms",
@@ -296,6 +468,7 @@ struct AppImpl
     }
     void playClip(Id<AudioClip> id)
     {
+        clipTiering->decompressNow(id);
         auto& clips = rse.get(appState.clips);
         rse.set(appState.clipBeingPlayed, true);
         audioEngine->play(AudioClip(clips.at(id)));
@@ -339,8 +512,21 @@ struct AppImpl
             receiveAudioEngine(*g);
         } else if (auto* i = std::any_cast<msg::PlayClip>(&msg)) {
             playClip(i->id);
+        } else if (auto* j = std::any_cast<msg::PrefetchClip>(&msg)) {
+            clipTiering->prefetch(j->id);
+        } else if (auto* k = std::any_cast<msg::ClipStorage::V>(&msg)) {
+            clipTiering->receive(MOVE(*k));
+        } else if (auto* l = std::any_cast<msg::AudioFilesImported>(&msg)) {
+            receiveAudioFilesImported(MOVE(*l));
+        } else if (auto* m = std::any_cast<msg::Mixdown::V>(&msg)) {
+            receiveMixdown(MOVE(*m));
         } else if (std::any_cast<msg::AddTrack>(&msg)) {
             addTrack();
+        } else if (auto* n = std::any_cast<msg::AutosaveStatus>(&msg)) {
+            if (!n->error) {
+                LOG(INFO) << "Autosave works again";
+            }
+            rse.set(appState.autosaveError, MOVE(n->error));
         } else {
             LOG(DFATAL) << fmt::format("Invalid message: {}", msg.type().name());
         }
@@ -348,11 +534,18 @@ struct AppImpl
         if (!rse.isUpToDate(appState.metronomeChanged)) {
             rse.updateIfNeeded(appState.metronomeChanged);
             auto& metronome = rse.get(appState.metronome);
-            audioEngine->sendStateChangerFn([on = metronome.on, bpm = metronome.bpm()](AudioEngineState& s) {
+            const auto beat = Ticks::noteValue(metronome.timeSignature.lower);
+            audioEngine->sendStateChangerFn([on = metronome.on, tempo = metronome.tempo, beat](AudioEngineState& s) {
                 s.metronome.on = on;
-                s.metronome.bpm = bpm;
+                s.metronome.tempo = tempo;
+                s.metronome.beat = beat;
             });
         }
+
+        clipTiering->update();
+        if (autosave) {
+            autosave->commit();
+        }
     }
 
     void receiveAudioIO(const msg::AudioIO::V& msg)
@@ -367,17 +560,12 @@ struct AppImpl
           },
           [this](const msg::AudioIO::AudioCallbacksStopped&) {
               audioEngine->audioCallbacksStopped();
+          },
+          [this](const msg::AudioIO::MessagesPending&) {
+              audioIO->dispatchPendingMessages();
           }
         );
     }
-    bool getAndClearIfUIRefreshNeeded() override
-    {
-        if (rse.isUpToDate(appState.anyVariableDisplayedOnUIChanged)) {
-            return false;
-        }
-        rse.updateIfNeeded(appState.anyVariableDisplayedOnUIChanged);
-        return true;
-    }
 };
 
 unique_ptr<App> App::make(UI* ui, AppState& appState)
@@ -12,6 +12,4 @@ public:
     virtual ~App() = default;
 
     virtual void receive(std::any&& msg) = 0;
-    virtual void runAudioIODispatchLoop() = 0;
-    virtual bool getAndClearIfUIRefreshNeeded() = 0;
 };
@@ -0,0 +1,198 @@
+#include "ClipTiering.h"
+
+#include "platform/AppMsgQueue.h"
+
+ClipTiering::ClipTiering(AppState& appStateArg)
+    : appState(appStateArg)
+    , rse(appState.rse)
+{
+    const auto numWorkers = std::max(1u, std::thread::hardware_concurrency() / 2);
+    for (UNUSED unsigned i : vi::iota(0u, numWorkers)) {
+        workers.emplace_back(&ClipTiering::workerMain, this);
+    }
+}
+
+ClipTiering::~ClipTiering()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        jobs.clear();
+    }
+    cv.notify_all();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+ClipTiering::ClipEntry& ClipTiering::entry(Id<AudioClip> id)
+{
+    return entries.try_emplace(id, ClipEntry{.lastUsed = chr::steady_clock::now(), .jobInFlight = false})
+      .first->second;
+}
+
+void ClipTiering::prefetch(Id<AudioClip> id)
+{
+    auto& clips = rse.get(appState.clips);
+    auto it = clips.find(id);
+    if (it == clips.end()) {
+        return;
+    }
+    auto& e = entry(id);
+    e.lastUsed = chr::steady_clock::now();
+    if (!it->second.compressed || e.jobInFlight) {
+        return;
+    }
+    e.jobInFlight = true;
+    pushJob([id, compressed = it->second.compressed] {
+        const auto t0 = chr::steady_clock::now();
+        auto channels = compressed->decompress();
+        sendToApp(msg::ClipStorage::V(msg::ClipStorage::Decompressed{
+          .id = id, .channels = MOVE(channels), .duration = chr::steady_clock::now() - t0
+        }));
+    });
+}
+
+void ClipTiering::decompressNow(Id<AudioClip> id)
+{
+    auto& clips = rse.get(appState.clips);
+    auto it = clips.find(id);
+    if (it == clips.end()) {
+        return;
+    }
+    entry(id).lastUsed = chr::steady_clock::now();
+    if (!it->second.compressed) {
+        return;
+    }
+    const auto t0 = chr::steady_clock::now();
+    rse.modifyAt(appState.clips, id, [](AudioClip& clip) {
+        clip.setDecompressed(clip.compressed->decompress());
+    });
+    stats.decompressionTime += chr::steady_clock::now() - t0;
+    ++stats.numSynchronousDecompressions;
+    updateStats();
+}
+
+void ClipTiering::update()
+{
+    const auto now = chr::steady_clock::now();
+    if (now - lastScan < k_scanInterval) {
+        return;
+    }
+    lastScan = now;
+    auto& clips = rse.get(appState.clips);
+    std::erase_if(entries, [&clips](auto& x) {
+        return !clips.contains(x.first);
+    });
+    for (auto& [id, clip] : clips) {
+        if (numJobsInFlight >= maxJobsInFlight()) {
+            break; // The rest is left to the next scans.
+        }
+        auto& e = entry(id);
+        if (clip.compressed || e.jobInFlight || clip.size() == 0 || now - e.lastUsed < k_idleTimeBeforeCompression) {
+            continue;
+        }
+        e.jobInFlight = true;
+        pushJob([id, channels = clip.sharedChannels()] {
+            const auto t0 = chr::steady_clock::now();
+            auto compressed = CompressedAudio::compress(*channels);
+            sendToApp(msg::ClipStorage::V(msg::ClipStorage::Compressed{
+              .id = id, .audio = MOVE(compressed), .duration = chr::steady_clock::now() - t0
+            }));
+        });
+    }
+    updateStats();
+}
+
+void ClipTiering::receive(msg::ClipStorage::V&& m)
+{
+    // The results are dropped if the clip has been removed, used or decompressed synchronously since the job started.
+    auto& clips = rse.get(appState.clips);
+    switch_variant(
+      m,
+      [&](msg::ClipStorage::Compressed& x) {
+          --numJobsInFlight;
+          stats.compressionTime += x.duration;
+          auto it = clips.find(x.id);
+          if (it == clips.end()) {
+              return;
+          }
+          auto& e = entry(x.id);
+          e.jobInFlight = false;
+          if (it->second.compressed || chr::steady_clock::now() - e.lastUsed < k_idleTimeBeforeCompression) {
+              return;
+          }
+          rse.modifyAt(appState.clips, x.id, [&x](AudioClip& clip) {
+              clip.compress(MOVE(x.audio));
+          });
+      },
+      [&](msg::ClipStorage::Decompressed& x) {
+          --numJobsInFlight;
+          stats.decompressionTime += x.duration;
+          auto it = clips.find(x.id);
+          if (it == clips.end()) {
+              return;
+          }
+          entry(x.id).jobInFlight = false;
+          if (!it->second.compressed) {
+              return;
+          }
+          rse.modifyAt(appState.clips, x.id, [&x](AudioClip& clip) {
+              clip.setDecompressed(MOVE(x.channels));
+          });
+      }
+    );
+    updateStats();
+}
+
+size_t ClipTiering::maxJobsInFlight() const
+{
+    return 2 * workers.size();
+}
+
+void ClipTiering::pushJob(function<void()> job)
+{
+    ++numJobsInFlight;
+    {
+        std::lock_guard lock(mutex);
+        jobs.push_back(MOVE(job));
+    }
+    cv.notify_one();
+}
+
+void ClipTiering::workerMain()
+{
+    for (;;) {
+        function<void()> job;
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this] {
+                return stopping || !jobs.empty();
+            });
+            if (stopping) {
+                return;
+            }
+            job = MOVE(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+void ClipTiering::updateStats()
+{
+    stats.numDecodedClips = stats.numCompressedClips = 0;
+    stats.decodedBytes = stats.compressedBytes = stats.compressedClipsDecodedBytes = 0;
+    for (auto& clip : rse.get(appState.clips) | vi::values) {
+        const auto decodedBytes = clip.size() * clip.numChannels() * sizeof(float);
+        if (clip.compressed) {
+            ++stats.numCompressedClips;
+            stats.compressedBytes += clip.compressed->memoryUsage();
+            stats.compressedClipsDecodedBytes += decodedBytes;
+        } else {
+            ++stats.numDecodedClips;
+            stats.decodedBytes += decodedBytes;
+        }
+    }
+    rse.set(appState.clipStorageStats, stats);
+}
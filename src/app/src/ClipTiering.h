@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common/AppState.h"
+#include "common/msg.h"
+
+#include <condition_variable>
+#include <mutex>
+
+// Tiered in-memory storage of the clips' samples. Clips which haven't been played for k_idleTimeBeforeCompression are
+// compressed losslessly on background threads (see CompressedAudio), their peaks stay decoded so the waveforms can
+// still be drawn. A clip which is likely to be played is decompressed in the background, a clip played before that
+// finished is decompressed on the main thread.
+//
+// The jobs post their results to the App, which passes them to `receive`. A job shares the clip's samples read-only (see
+// AudioClip) so the clip stays usable while it's being compressed. At most `maxJobsInFlight()` compression jobs are
+// started, the jobs hold on to the samples of the clips they compress until they finish.
+class ClipTiering
+{
+public:
+    static constexpr chr::seconds k_idleTimeBeforeCompression{30};
+    static constexpr chr::seconds k_scanInterval{1};
+
+    explicit ClipTiering(AppState& appState);
+    ~ClipTiering();
+
+    void prefetch(Id<AudioClip> id);
+    void decompressNow(Id<AudioClip> id);
+    // Starts compressing the idle clips, scans the clips at most once per k_scanInterval.
+    void update();
+    void receive(msg::ClipStorage::V&& m);
+
+private:
+    struct ClipEntry {
+        chr::steady_clock::time_point lastUsed;
+        bool jobInFlight = false;
+    };
+
+    AppState& appState;
+    ReactiveStateEngine& rse;
+    unordered_map<Id<AudioClip>, ClipEntry> entries;
+    chr::steady_clock::time_point lastScan;
+    AppState::ClipStorageStats stats;
+    size_t numJobsInFlight = 0; // Pushed and not yet received.
+
+    // Shared with the worker threads.
+    std::mutex mutex;
+    std::condition_variable cv;
+    deque<function<void()>> jobs;
+    bool stopping = false;
+
+    vector<std::thread> workers;
+
+    ClipEntry& entry(Id<AudioClip> id);
+    size_t maxJobsInFlight() const;
+    void pushJob(function<void()> job);
+    void workerMain();
+    void updateStats();
+};
@@ -0,0 +1,35 @@
+#include "FramePacer.h"
+
+FramePacer::FramePacer(Clock::duration minFrameIntervalArg)
+    : minFrameInterval(minFrameIntervalArg)
+{
+}
+
+void FramePacer::setMinFrameInterval(Clock::duration d)
+{
+    minFrameInterval = d;
+}
+
+void FramePacer::inputReceived()
+{
+    numFramesToRenderAfterInput = k_numFramesToRenderAfterInput;
+}
+
+optional<FramePacer::Clock::duration> FramePacer::timeUntilNextFrame(State state, Clock::time_point now) const
+{
+    if (state == State::idle && numFramesToRenderAfterInput == 0) {
+        return nullopt;
+    }
+    if (!lastFrameTime) {
+        return Clock::duration::zero();
+    }
+    return std::max(Clock::duration::zero(), *lastFrameTime + minFrameInterval - now);
+}
+
+void FramePacer::frameRendered(Clock::time_point t)
+{
+    lastFrameTime = t;
+    if (numFramesToRenderAfterInput > 0) {
+        --numFramesToRenderAfterInput;
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "common/std.h"
+
+// Decides when the main loop renders a frame and how long it may block waiting for events in between.
+//
+// - stateChanged: there was input or the AppState read by the last frame has changed. Render as soon as the frame rate
+//   cap allows, so a burst of messages (e.g. one per audio buffer) results in a single frame.
+// - animating: the screen changes without state changes (playback, dragging). Render at the frame rate cap.
+// - idle: nothing to render, block until the next event.
+//
+// A few frames are rendered after input regardless of the state since ImGui may need an extra frame to settle.
+class FramePacer
+{
+public:
+    using Clock = chr::steady_clock;
+
+    enum class State {
+        idle,
+        animating,
+        stateChanged
+    };
+
+    explicit FramePacer(Clock::duration minFrameInterval);
+
+    void setMinFrameInterval(Clock::duration d);
+    void inputReceived();
+
+    // Zero means render now, nullopt means there's nothing to render until the next event.
+    optional<Clock::duration> timeUntilNextFrame(State state, Clock::time_point now) const;
+    void frameRendered(Clock::time_point t);
+
+private:
+    static constexpr int k_numFramesToRenderAfterInput = 2;
+
+    Clock::duration minFrameInterval;
+    optional<Clock::time_point> lastFrameTime;
+    int numFramesToRenderAfterInput = 0;
+};
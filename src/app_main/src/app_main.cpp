@@ -1,9 +1,13 @@
+#include "FramePacer.h"
+
 #include "app/App.h"
 #include "common/AppState.h"
+#include "common/FrameProfiler.h"
 #include "common/common.h"
 #include "common/msg.h"
 #include "platform/AppMsgQueue.h"
 #include "platform/SDL.h"
+#include "platform/TimelineRenderer.h"
 #include "platform/platform.h"
 #include "ui/UI.h"
 
@@ -82,9 +86,16 @@ UNUSED void g()
 
 namespace
 {
-constexpr auto k_minUIRefreshInterval = chr::milliseconds(50);
-constexpr auto k_maxUIRefreshInterval = chr::milliseconds(200);
-constexpr double k_refreshIntervalIncreaseFactorWhenNoEvents = 1.05;
+constexpr auto k_defaultFrameInterval = chr::microseconds(16667);
+
+FramePacer::Clock::duration displayFrameInterval(SDL_Window* window)
+{
+    auto* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(window));
+    if (!mode || mode->refresh_rate <= 0) {
+        return k_defaultFrameInterval;
+    }
+    return chr::duration_cast<FramePacer::Clock::duration>(chr::duration<double>(1.0 / double(mode->refresh_rate)));
+}
 } // namespace
 
 //// This example doesn't compile with Emscripten yet! Awaiting SDL3 support.
@@ -153,6 +164,13 @@ int main(int, char**)
 
     AppState appState;
     auto ui = UI::make(appState);
+    unique_ptr<TimelineRenderer> timelineRenderer;
+    if (auto tr = TimelineRenderer::make(sdl->glsl_version())) {
+        timelineRenderer = MOVE(*tr);
+        ui->setTimelineRenderer(timelineRenderer.get());
+    } else {
+        LOG(ERROR) << fmt::format("Falling back to drawing the timeline with ImGui: {}", tr.error());
+    }
     auto app = App::make(ui.get(), appState);
 
     auto amq = AppMsgQueue::make([app_ = app.get()](std::any&& msg) {
@@ -162,8 +180,37 @@ int main(int, char**)
 
     // Main loop
     bool done = false;
-    optional<chr::high_resolution_clock::time_point> lastUIRefreshStartTime;
-    auto targetRefreshInterval = chr::duration<double>(k_minUIRefreshInterval);
+    FramePacer framePacer(displayFrameInterval(sdl->window()));
+    FrameProfiler frameProfiler;
+    ui->setFrameProfiler(&frameProfiler);
+    // App messages are dispatched after polling the events so the two can be timed separately.
+    size_t numAppMessageNotifications = 0;
+    // Poll and handle events (inputs, window resize, etc.)
+    // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to
+    // tell if dear imgui wants to use your inputs.
+    // - When io.WantCaptureMouse is true, do not dispatch mouse input data to
+    // your main application, or clear/overwrite your copy of the mouse data.
+    // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input
+    // data to your main application, or clear/overwrite your copy of the
+    // keyboard data. Generally you may always pass all inputs to dear imgui,
+    // and hide them from your application based on those two flags.
+    auto handleEvent = [&](const SDL_Event& event) {
+        if (event.type == appQueueNotificationSdlEventType()) {
+            ++numAppMessageNotifications;
+            return;
+        }
+        ImGui_ImplSDL3_ProcessEvent(&event);
+        framePacer.inputReceived();
+        if (event.type == SDL_EVENT_QUIT) {
+            done = true;
+        }
+        if (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(sdl->window())) {
+            done = true;
+        }
+        if (event.type == SDL_EVENT_WINDOW_DISPLAY_CHANGED) {
+            framePacer.setMinFrameInterval(displayFrameInterval(sdl->window()));
+        }
+    };
 #ifdef __EMSCRIPTEN__
     // For an Emscripten build we are disabling file-system access, so let's not
     // attempt to do a fopen() of the imgui.ini file. You may manually call
@@ -174,78 +221,64 @@ int main(int, char**)
     while (!done)
 #endif
     {
-        // Poll and handle events (inputs, window resize, etc.)
-        // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to
-        // tell if dear imgui wants to use your inputs.
-        // - When io.WantCaptureMouse is true, do not dispatch mouse input data to
-        // your main application, or clear/overwrite your copy of the mouse data.
-        // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input
-        // data to your main application, or clear/overwrite your copy of the
-        // keyboard data. Generally you may always pass all inputs to dear imgui,
-        // and hide them from your application based on those two flags.
+        frameProfiler.beginFrame();
         SDL_Event event;
-        bool hadAnSDLEvent = false;
-        for (bool waitForEvent = false;;) {
-            if (waitForEvent) {
-                if (!lastUIRefreshStartTime) {
-                    break;
-                }
-                auto timeout = targetRefreshInterval - (chr::high_resolution_clock::now() - *lastUIRefreshStartTime);
-                if (timeout < chr::milliseconds(1)) {
-                    break;
-                }
-                auto timeoutMs = clampCast<Sint32>(chr::duration_cast<chr::milliseconds>(timeout).count());
-                if (!SDL_WaitEventTimeout(&event, timeoutMs)) {
-                    break;
-                }
-            } else {
-                if (!SDL_PollEvent(&event)) {
-                    waitForEvent = true;
-                    continue;
-                }
-            }
-            hadAnSDLEvent = true;
-            if (event.type == appQueueNotificationSdlEventType()) {
-                tryDequeueAndMakeAppReceiveIt();
-            } else {
-                ImGui_ImplSDL3_ProcessEvent(&event);
-                if (event.type == SDL_EVENT_QUIT) {
-                    done = true;
-                }
-                if (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED
-                    && event.window.windowID == SDL_GetWindowID(sdl->window())) {
-                    done = true;
-                }
-            }
+        while (SDL_PollEvent(&event)) {
+            handleEvent(event);
         }
-        app->runAudioIODispatchLoop();
-        lastUIRefreshStartTime = chr::high_resolution_clock::now();
-        if (SDL_GetWindowFlags(sdl->window()) & SDL_WINDOW_MINIMIZED) {
-            continue;
+        frameProfiler.endStage(FrameProfiler::Stage::pollEvents);
+        // State changes caused by the messages are picked up by `ui->isRefreshNeeded()`.
+        for (; numAppMessageNotifications > 0; --numAppMessageNotifications) {
+            tryDequeueAndMakeAppReceiveIt();
         }
-        if (app->getAndClearIfUIRefreshNeeded() || hadAnSDLEvent) {
-            targetRefreshInterval = k_minUIRefreshInterval;
-        } else {
-            targetRefreshInterval = std::min(
-              targetRefreshInterval * k_refreshIntervalIncreaseFactorWhenNoEvents,
-              chr::duration<double>(k_maxUIRefreshInterval)
-            );
+        frameProfiler.endStage(FrameProfiler::Stage::dispatchMessages);
+
+        auto state = FramePacer::State::idle;
+        if (!(SDL_GetWindowFlags(sdl->window()) & SDL_WINDOW_MINIMIZED)) {
+            if (ui->isRefreshNeeded()) {
+                state = FramePacer::State::stateChanged;
+            } else if (ui->isAnimating()) {
+                state = FramePacer::State::animating;
+            }
         }
-        // Render UI frame.
-        {
+        auto frameStartTime = FramePacer::Clock::now();
+        auto timeUntilNextFrame = framePacer.timeUntilNextFrame(state, frameStartTime);
+        if (timeUntilNextFrame && *timeUntilNextFrame == FramePacer::Clock::duration::zero()) {
+            ui->updateState();
+            frameProfiler.endStage(FrameProfiler::Stage::rseUpdate);
             // Start the Dear ImGui frame
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplSDL3_NewFrame();
             ui->render();
+            frameProfiler.endStage(FrameProfiler::Stage::imguiBuild);
             glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
             glClearColor(
               clear_color.x * clear_color.w, clear_color.y * clear_color.w, clear_color.z * clear_color.w, clear_color.w
             );
             glClear(GL_COLOR_BUFFER_BIT);
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            frameProfiler.endStage(FrameProfiler::Stage::glSubmit);
             SDL_GL_SwapWindow(sdl->window());
-            auto t1 = chr::high_resolution_clock::now();
-            ui->addFrameTime(*lastUIRefreshStartTime, t1 - *lastUIRefreshStartTime);
+            frameProfiler.endStage(FrameProfiler::Stage::swap);
+            frameProfiler.endFrame();
+            framePacer.frameRendered(frameStartTime);
+            continue;
+        }
+
+        // Block until the next event or until it's time for the next frame. Nothing runs while idle, unless the UI
+        // polls for changes which come without events.
+        if (auto maxWait = ui->idlePollInterval(); maxWait && (!timeUntilNextFrame || *timeUntilNextFrame > *maxWait)) {
+            timeUntilNextFrame = *maxWait;
+        }
+        bool gotEvent = false;
+        if (timeUntilNextFrame) {
+            auto timeoutMs = clampCast<Sint32>(chr::ceil<chr::milliseconds>(*timeUntilNextFrame).count());
+            gotEvent = SDL_WaitEventTimeout(&event, timeoutMs);
+        } else {
+            gotEvent = SDL_WaitEvent(&event);
+        }
+        if (gotEvent) {
+            handleEvent(event);
         }
     }
 #ifdef __EMSCRIPTEN__
@@ -253,6 +286,9 @@ int main(int, char**)
 #endif
 
     // Cleanup
+    ui->setFrameProfiler(nullptr);
+    ui->setTimelineRenderer(nullptr);
+    timelineRenderer.reset();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     ImGui::DestroyContext();
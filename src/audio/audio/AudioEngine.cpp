@@ -32,6 +32,13 @@ struct AudioEngineImpl : public AudioEngine {
     vector<float> metronomeBuffer;
     array<RecordingBuffer, k_numRecordingBuffers> recordingBuffers;
     std::atomic_bool recording;
+    AudioLevelMeters inputLevelMeters_;
+
+    AudioLevelMeters& inputLevelMeters() override
+    {
+        return inputLevelMeters_;
+    }
+
     void audioCallbacksAboutToStart(double sampleRateArg, size_t bufferSizeArg, size_t numInputChannels) override
     {
         LOG(INFO) << fmt::format(
@@ -43,7 +50,7 @@ struct AudioEngineImpl : public AudioEngine {
         );
         sampleRate = sampleRateArg;
         bufferSize = bufferSizeArg;
-        metronome.timeSinceLastStart = 0;
+        metronome.reset();
         metronomeBuffer.resize(bufferSize);
         audioCallbacksRunning = true;
         for (auto& rb : recordingBuffers) {
@@ -54,6 +61,7 @@ struct AudioEngineImpl : public AudioEngine {
     void audioCallbacksStopped() override
     {
         audioCallbacksRunning = false;
+        inputLevelMeters_.reset();
         LOG(INFO) << fmt::format("audioCallbacksStopped thread: {}", this_thread::get_id());
         processMainToCallbackThreadQueue();
     }
@@ -70,9 +78,13 @@ struct AudioEngineImpl : public AudioEngine {
         }
         processMainToCallbackThreadQueue();
 
+        inputLevelMeters_.process(inputChannels, numSamples, sampleRate);
+
         if (state.metronome.on) {
             assert(metronomeBuffer.size() == numSamples);
-            metronome.generate(sampleRate, boost::rational_cast<double>(state.metronome.bpm), metronomeBuffer);
+            metronome.generate(
+              int64_t(std::llround(sampleRate)), state.metronome.tempo, state.metronome.beat, metronomeBuffer
+            );
             for (auto oc : outputChannels) {
                 elementWiseOperatorPlusEquals(span<float>(oc, numSamples), metronomeBuffer);
             }
@@ -81,8 +93,8 @@ struct AudioEngineImpl : public AudioEngine {
             auto& clip = *state.clipToPlay;
             if (state.nextSampleToPlay < clip.size()) {
                 auto endSampleIx = std::min(numSamples, clip.size() - state.nextSampleToPlay);
-                for (size_t chix : vi::iota(0u, std::min(outputChannels.size(), clip.channels.size()))) {
-                    auto& sourceChannel = state.clipToPlay->channels[chix];
+                for (size_t chix : vi::iota(0u, std::min(outputChannels.size(), clip.numChannels()))) {
+                    auto& sourceChannel = clip.channels()[chix];
                     auto& outputChannel = outputChannels[chix];
                     for (size_t i = 0; i < endSampleIx; ++i) {
                         outputChannel[i] += sourceChannel[state.nextSampleToPlay + i];
@@ -98,6 +110,16 @@ struct AudioEngineImpl : public AudioEngine {
                 sendToApp(MAKE_VARIANT_V(msg::AudioEngine, PlayedTime{state.nextSampleToPlay / sampleRate}));
             }
         }
+        if (state.arrangement) {
+            state.arrangement->mix(
+              state.nextArrangementSample, outputChannels, numSamples, state.arrangementDecodeBuffers
+            );
+            state.nextArrangementSample += int64_t(numSamples);
+            if (state.arrangement->numSamples <= state.nextArrangementSample) {
+                state.arrangement.reset();
+                state.nextArrangementSample = 0;
+            }
+        }
         if (recording) {
             RecordingBuffer* recordingBuffer{};
             for (auto& rb : recordingBuffers) {
@@ -160,11 +182,24 @@ struct AudioEngineImpl : public AudioEngine {
             s.nextSampleToPlay = 0;
         });
     }
+    void playArrangement(std::shared_ptr<const ArrangementAudio> arrangement, int64_t fromSample) override
+    {
+        auto decodeBuffers = arrangement->makeDecodeBuffers();
+        mainToCallbackThreadQueue.enqueue([arrangement = MOVE(arrangement),
+                                           decodeBuffers = MOVE(decodeBuffers),
+                                           fromSample](AudioEngineState& s) mutable {
+            s.arrangement = MOVE(arrangement);
+            s.arrangementDecodeBuffers = MOVE(decodeBuffers);
+            s.nextArrangementSample = fromSample;
+        });
+    }
     void stopPlaying() override
     {
         mainToCallbackThreadQueue.enqueue([](AudioEngineState& s) mutable {
             s.clipToPlay.reset();
             s.nextSampleToPlay = 0;
+            s.arrangement.reset();
+            s.nextArrangementSample = 0;
         });
     }
 };
@@ -2,17 +2,25 @@
 
 #include "common/common.h"
 
+#include "common/ArrangementAudio.h"
 #include "common/AudioClip.h"
+#include "common/AudioLevelMeters.h"
+#include "common/Ticks.h"
 
 struct AudioEngineState {
     struct Metronome {
         bool on = false;
-        Rational bpm;
+        Rational tempo; // Whole notes per minute.
+        Ticks beat;
     } metronome;
 
     // todo these should be one data.
     optional<AudioClip> clipToPlay;
     size_t nextSampleToPlay = 0;
+
+    std::shared_ptr<const ArrangementAudio> arrangement;
+    ArrangementAudio::DecodeBuffers arrangementDecodeBuffers; // Made on the main thread with the arrangement.
+    int64_t nextArrangementSample = 0;
 };
 
 class AudioEngine
@@ -30,8 +38,13 @@ public:
     virtual void stopRecording() = 0;
 
     virtual void play(AudioClip&& clip) = 0;
+    // Stops by itself at the end of the arrangement.
+    virtual void playArrangement(std::shared_ptr<const ArrangementAudio> arrangement, int64_t fromSample) = 0;
     virtual void stopPlaying() = 0;
 
+    // Levels of the input channels active on the device, can be read from any thread.
+    virtual AudioLevelMeters& inputLevelMeters() = 0;
+
     virtual void audioCallbacksAboutToStart(double sampleRate, size_t bufferSize, size_t numInputChannels) = 0;
     virtual void audioCallbacksStopped() = 0;
 
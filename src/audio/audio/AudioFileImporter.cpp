@@ -0,0 +1,296 @@
+#include "AudioFileImporter.h"
+
+#include "common/AudioClip.h"
+#include "common/common.h"
+#include "common/msg.h"
+#include "platform/AppMsgQueue.h"
+
+#include "juce_audio_formats/juce_audio_formats.h"
+
+#include <mutex>
+#include <numeric>
+
+namespace
+{
+constexpr int k_blockSize = 65536; // Frames decoded and resampled at once.
+// The anti-aliasing filter passes up to 95% of the output's Nyquist frequency and stops above it. The Blackman window
+// attenuates the stopband by about 74 dB and needs about 5.5 / (number of taps) cycles per sample for the transition.
+constexpr double k_antiAliasingCutoff = 0.95;
+constexpr double k_antiAliasingTransitionTaps = 5.5;
+
+// Linear-phase low-pass FIR (Blackman-windowed sinc) for the input when downsampling. The kernel of
+// juce::WindowedSincInterpolator is fixed to the input's Nyquist frequency so without this the content between the
+// output's and the input's Nyquist frequency would alias.
+class AntiAliasingFilter
+{
+public:
+    // `ratio` is the input frames per output frame, greater than 1.
+    explicit AntiAliasingFilter(double ratio)
+    {
+        const double halfBand = 0.5 / ratio; // Output Nyquist in cycles per input sample.
+        const double cutoff = halfBand * k_antiAliasingCutoff;
+        const double transition = 2 * (halfBand - cutoff);
+        const auto halfLength = size_t(std::ceil(k_antiAliasingTransitionTaps / transition / 2));
+        const auto numTaps = 2 * halfLength + 1;
+        taps.resize(numTaps);
+        double sum = 0;
+        for (size_t i : vi::iota(0u, numTaps)) {
+            const double t = double(i) - double(halfLength);
+            const double sinc =
+              t == 0 ? 2 * cutoff : std::sin(2 * std::numbers::pi * cutoff * t) / (std::numbers::pi * t);
+            const double phase = 2 * std::numbers::pi * double(i) / double(numTaps - 1);
+            const double window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2 * phase);
+            taps[i] = float(sinc * window);
+            sum += double(taps[i]);
+        }
+        for (auto& x : taps) {
+            x = float(double(x) / sum); // Unity gain at DC.
+        }
+        history.assign(numTaps - 1, 0.0f);
+    }
+
+    // Input frames by which the output lags the input.
+    size_t delay() const
+    {
+        return (taps.size() - 1) / 2;
+    }
+
+    // Filter `xs` in place, continuing the signal of the previous call.
+    void process(span<float> xs)
+    {
+        buffer.assign(history.begin(), history.end());
+        buffer.insert(buffer.end(), xs.begin(), xs.end());
+        // The taps are symmetric, the convolution is a dot product with the window of the input ending at the sample.
+        for (size_t i : vi::iota(0u, xs.size())) {
+            xs[i] = std::inner_product(taps.begin(), taps.end(), buffer.begin() + ptrdiff_t(i), 0.0f);
+        }
+        history.assign(buffer.end() - ptrdiff_t(history.size()), buffer.end());
+    }
+
+private:
+    vector<float> taps;
+    vector<float> history; // The last taps.size() - 1 input frames.
+    vector<float> buffer;
+};
+
+// Decode one file block by block. Each block is resampled with a windowed sinc interpolator per channel and appended
+// to the clip, which updates its peaks. When downsampling the input is low-pass filtered first.
+expected<AudioClip, string>
+importAudioFile(juce::AudioFormatManager& formatManager, const std::filesystem::path& path, double sampleRate)
+{
+    unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(juce::File(juce::String(path.string()))));
+    if (!reader) {
+        return unexpected(fmt::format("{}: not a supported audio file", path));
+    }
+    const auto numChannels = size_t(reader->numChannels);
+    const auto numFrames = reader->lengthInSamples;
+    if (numChannels == 0 || reader->sampleRate <= 0) {
+        return unexpected(fmt::format("{}: no audio", path));
+    }
+    AudioClip clip(sampleRate, numChannels);
+    juce::AudioBuffer<float> block(int(numChannels), k_blockSize);
+    vector<vector<float>> out(numChannels);
+
+    const double ratio = reader->sampleRate / sampleRate; // Input frames per output frame.
+    if (ratio == 1) {
+        for (int64_t pos = 0; pos < numFrames;) {
+            const auto n = int(std::min<int64_t>(k_blockSize, numFrames - pos));
+            if (!reader->read(&block, 0, n, pos, true, true)) {
+                return unexpected(fmt::format("{}: read error at frame {}", path, pos));
+            }
+            for (size_t ch : vi::iota(0u, numChannels)) {
+                auto* p = block.getReadPointer(int(ch));
+                out[ch].assign(p, p + n);
+            }
+            clip.append(out);
+            pos += n;
+        }
+        return clip;
+    }
+
+    // The filter's and the interpolator's output lags their input, the first `latency` output frames are dropped and
+    // the input is padded with zeros at the end to flush the last frames out.
+    vector<juce::WindowedSincInterpolator> interpolators(numChannels);
+    vector<AntiAliasingFilter> filters;
+    if (ratio > 1) {
+        filters.assign(numChannels, AntiAliasingFilter(ratio));
+    }
+    const size_t filterDelay = filters.empty() ? 0 : filters[0].delay();
+    const auto latency = int64_t(
+      std::llround((double(juce::WindowedSincInterpolator::getBaseLatency()) + double(filterDelay)) / ratio)
+    );
+    const auto numOutputFrames = int64_t(std::llround(double(numFrames) / ratio));
+    int64_t numFramesToProduce = numOutputFrames + latency;
+    int64_t numFramesToDrop = latency;
+    vector<vector<float>> pending(numChannels); // Input not consumed by the interpolators yet.
+    bool filtersFlushed = false;
+    for (int64_t pos = 0; numFramesToProduce > 0;) {
+        int64_t n = 0;
+        if (pos < numFrames) {
+            n = std::min<int64_t>(k_blockSize, numFrames - pos);
+            if (!reader->read(&block, 0, int(n), pos, true, true)) {
+                return unexpected(fmt::format("{}: read error at frame {}", path, pos));
+            }
+            pos += n;
+        }
+        // The filter's last `filterDelay` frames are flushed out with zeros after the end of the file.
+        const bool flushFilters = !filters.empty() && pos == numFrames && !filtersFlushed;
+        for (size_t ch : vi::iota(0u, numChannels)) {
+            auto* p = block.getReadPointer(int(ch));
+            auto& pch = pending[ch];
+            const auto begin = pch.size();
+            pch.insert(pch.end(), p, p + n);
+            if (flushFilters) {
+                pch.resize(pch.size() + filterDelay, 0.0f);
+            }
+            if (!filters.empty()) {
+                filters[ch].process(span(pch).subspan(begin));
+            }
+        }
+        filtersFlushed = filtersFlushed || flushFilters;
+        int64_t numOut = 0;
+        if (pos < numFrames) {
+            // Only as many frames as the pending input surely covers.
+            numOut = std::min(numFramesToProduce, int64_t(double(pending[0].size()) / ratio) - 1);
+        } else {
+            numOut = numFramesToProduce;
+            const auto numInputNeeded = size_t(std::ceil(double(numOut) * ratio)) + 2;
+            for (auto& p : pending) {
+                p.resize(std::max(p.size(), numInputNeeded), 0.0f);
+            }
+        }
+        if (numOut <= 0) {
+            continue;
+        }
+        int used = 0;
+        for (size_t ch : vi::iota(0u, numChannels)) {
+            out[ch].resize(size_t(numOut));
+            used = interpolators[ch].process(
+              ratio, pending[ch].data(), out[ch].data(), int(numOut), int(pending[ch].size()), 0
+            );
+            // Past the end of the pending input the interpolator reads zeros.
+            const auto consumed = std::min(size_t(used), pending[ch].size());
+            pending[ch].erase(pending[ch].begin(), pending[ch].begin() + ptrdiff_t(consumed));
+        }
+        numFramesToProduce -= numOut;
+        const auto drop = std::min(numFramesToDrop, numOut);
+        numFramesToDrop -= drop;
+        if (drop > 0) {
+            for (auto& o : out) {
+                o.erase(o.begin(), o.begin() + drop);
+            }
+        }
+        clip.append(out);
+    }
+    return clip;
+}
+} // namespace
+
+struct AudioFileImporterImpl : public AudioFileImporter {
+    juce::AudioFormatManager formatManager; // Only for findAudioFiles, each worker has its own.
+    vector<std::thread> workers;
+    std::atomic<size_t> busyWorkers = 0;
+
+    // The batch being imported, shared with the workers.
+    vector<std::filesystem::path> paths;
+    double sampleRate = 0;
+    std::atomic<size_t> nextPathIx = 0;
+    chr::steady_clock::time_point startTime;
+    std::mutex mutex;
+    vector<optional<AudioClip>> clips; // By path index.
+    vector<string> errors;
+
+    AudioFileImporterImpl()
+    {
+        formatManager.registerBasicFormats();
+    }
+    ~AudioFileImporterImpl() override
+    {
+        nextPathIx = paths.size(); // Don't start new files.
+        joinWorkers();
+    }
+
+    vector<std::filesystem::path> findAudioFiles(const std::filesystem::path& directory) override
+    {
+        vector<std::filesystem::path> r;
+        std::error_code ec;
+        for (auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+            if (entry.is_regular_file(ec)
+                && formatManager.findFormatForFileExtension(juce::String(entry.path().extension().string()))) {
+                r.push_back(entry.path());
+            }
+        }
+        ra::sort(r);
+        return r;
+    }
+
+    bool start(vector<std::filesystem::path> pathsArg, double sampleRateArg) override
+    {
+        if (busyWorkers > 0) {
+            return false;
+        }
+        joinWorkers();
+        paths = MOVE(pathsArg);
+        sampleRate = sampleRateArg;
+        nextPathIx = 0;
+        startTime = chr::steady_clock::now();
+        clips.assign(paths.size(), nullopt);
+        errors.clear();
+        const auto numWorkers =
+          std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), paths.size()));
+        busyWorkers = numWorkers;
+        for (UNUSED size_t i : vi::iota(0u, numWorkers)) {
+            workers.emplace_back(&AudioFileImporterImpl::workerMain, this);
+        }
+        return true;
+    }
+
+    void joinWorkers()
+    {
+        for (auto& w : workers) {
+            w.join();
+        }
+        workers.clear();
+    }
+
+    void workerMain()
+    {
+        juce::AudioFormatManager workerFormatManager;
+        workerFormatManager.registerBasicFormats();
+        for (size_t i; (i = nextPathIx++) < paths.size();) {
+            auto clip = importAudioFile(workerFormatManager, paths[i], sampleRate);
+            std::lock_guard lock(mutex);
+            if (clip) {
+                clips[i] = MOVE(*clip);
+            } else {
+                errors.push_back(MOVE(clip.error()));
+            }
+        }
+        if (--busyWorkers == 0) {
+            finishBatch();
+        }
+    }
+
+    // On the last worker to finish.
+    void finishBatch()
+    {
+        msg::AudioFilesImported m{
+          .clips = {}, .errors = MOVE(errors), .numBytes = 0, .duration = chr::steady_clock::now() - startTime
+        };
+        for (size_t i : vi::iota(0u, paths.size())) {
+            if (clips[i]) {
+                std::error_code ec;
+                const auto size = std::filesystem::file_size(paths[i], ec);
+                m.numBytes += ec ? 0 : size_t(size);
+                m.clips.push_back(MOVE(*clips[i]));
+            }
+        }
+        clips.clear();
+        sendToApp(MOVE(m));
+    }
+};
+
+unique_ptr<AudioFileImporter> AudioFileImporter::make()
+{
+    return make_unique<AudioFileImporterImpl>();
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common/std.h"
+
+#include <filesystem>
+
+// Imports audio files into clips: decodes a batch of files on a pool of background threads with JUCE's audio formats,
+// resamples them to the session's sample rate and builds the clips' peaks in the same pass. Posts a single
+// msg::AudioFilesImported when the whole batch is done, so the App can insert the clips in one step.
+class AudioFileImporter
+{
+public:
+    static unique_ptr<AudioFileImporter> make();
+
+    virtual ~AudioFileImporter() = default;
+
+    // The files in `directory` with the extension of a supported format, sorted by name.
+    virtual vector<std::filesystem::path> findAudioFiles(const std::filesystem::path& directory) = 0;
+
+    // Returns false without starting if the previous batch is still being imported.
+    virtual bool start(vector<std::filesystem::path> paths, double sampleRate) = 0;
+};
@@ -8,10 +8,130 @@
 
 #include "juce_audio_devices/juce_audio_devices.h"
 
+#if JUCE_LINUX || JUCE_BSD
+  #include <poll.h>
+  #include <unistd.h>
+
+  #include <condition_variable>
+  #include <mutex>
+#endif
+
 namespace
 {
 std::atomic_bool s_singleInstanceCreated;
 
+#if JUCE_LINUX || JUCE_BSD
+// JUCE's message queue on Linux is a set of file descriptors serviced by JUCE's own event loop, which SDL doesn't wait
+// on. This thread waits on them instead and sends msg::AudioIO::MessagesPending, which wakes up the main loop. The
+// descriptors stay readable until the main thread has dispatched the messages so it doesn't poll them until then.
+class JuceEventLoopWatcher : private juce::LinuxEventLoopInternal::Listener
+{
+public:
+    JuceEventLoopWatcher()
+    {
+        CHECK(::pipe(wakeUpPipe.data()) == 0);
+        juce::LinuxEventLoopInternal::registerLinuxEventLoopListener(*this);
+        thread = std::thread(&JuceEventLoopWatcher::threadMain, this);
+    }
+    ~JuceEventLoopWatcher() override
+    {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        wakeUp();
+        thread.join();
+        juce::LinuxEventLoopInternal::deregisterLinuxEventLoopListener(*this);
+        for (int fd : wakeUpPipe) {
+            ::close(fd);
+        }
+    }
+
+    // Main thread. Invokes the callbacks of the ready descriptors until none is ready, a callback may dispatch only
+    // some of the messages.
+    void dispatch()
+    {
+        vector<pollfd> pfds;
+        for (;;) {
+            pfds.clear();
+            for (int fd : juce::LinuxEventLoopInternal::getRegisteredFds()) {
+                pfds.push_back(pollfd{.fd = fd, .events = POLLIN, .revents = 0});
+            }
+            if (::poll(pfds.data(), intCast<nfds_t>(pfds.size()), 0) <= 0) {
+                break;
+            }
+            for (auto& pfd : pfds) {
+                if (pfd.revents != 0) {
+                    juce::LinuxEventLoopInternal::invokeEventLoopCallbackForFd(pfd.fd);
+                }
+            }
+        }
+        {
+            std::lock_guard lock(mutex);
+            messagesPending = false;
+        }
+        cv.notify_all();
+    }
+
+private:
+    std::thread thread;
+    array<int, 2> wakeUpPipe{};
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+    bool messagesPending = false; // Sent to the app and not yet dispatched.
+
+    // JUCE registered or removed a descriptor, poll the new set.
+    void fdCallbacksChanged() override
+    {
+        wakeUp();
+    }
+
+    void wakeUp()
+    {
+        const char c = 0;
+        UNUSED auto n = ::write(wakeUpPipe[1], &c, 1);
+    }
+
+    void threadMain()
+    {
+        vector<pollfd> pfds;
+        for (;;) {
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] {
+                    return stopping || !messagesPending;
+                });
+                if (stopping) {
+                    return;
+                }
+            }
+            pfds.assign(1, pollfd{.fd = wakeUpPipe[0], .events = POLLIN, .revents = 0});
+            for (int fd : juce::LinuxEventLoopInternal::getRegisteredFds()) {
+                pfds.push_back(pollfd{.fd = fd, .events = POLLIN, .revents = 0});
+            }
+            if (::poll(pfds.data(), intCast<nfds_t>(pfds.size()), -1) <= 0) {
+                continue;
+            }
+            if (pfds[0].revents != 0) {
+                array<char, 64> buffer{};
+                UNUSED auto n = ::read(wakeUpPipe[0], buffer.data(), buffer.size());
+            }
+            if (ra::any_of(span(pfds).subspan(1), [](const pollfd& pfd) {
+                    return pfd.revents != 0;
+                })) {
+                {
+                    std::lock_guard lock(mutex);
+                    messagesPending = true;
+                }
+                sendToApp(MAKE_VARIANT_V(msg::AudioIO, MessagesPending{}));
+            }
+        }
+    }
+};
+#endif
+
 optional<ActiveAudioDevices::Device> toAudioSettingsDevice(
   const juce::String& deviceName, const juce::StringArray& channelNames, const juce::BigInteger& activeChannels
 )
@@ -99,6 +219,9 @@ struct AudioIOImpl
     juce::ScopedJuceInitialiser_GUI juceInitialiser;
     AudioIODeviceCallback deviceCallback;
     juce::AudioDeviceManager deviceManager;
+#if JUCE_LINUX || JUCE_BSD
+    JuceEventLoopWatcher juceEventLoopWatcher;
+#endif
     AudioIOImpl()
     {
         deviceManager.addChangeListener(this);
@@ -116,9 +239,11 @@ struct AudioIOImpl
         sendToApp(MAKE_VARIANT_V(msg::AudioIO, Changed{}));
     }
 
-    void runDispatchLoopUntil(chr::milliseconds d) override
+    void dispatchPendingMessages() override
     {
-        juce::MessageManager::getInstance()->runDispatchLoopUntil(int(d.count()));
+#if JUCE_LINUX || JUCE_BSD
+        juceEventLoopWatcher.dispatch();
+#endif
     }
 
     vector<AudioDeviceProperties> getAudioDevices() override
@@ -18,5 +18,8 @@ public:
     virtual ActiveAudioDevices getActiveAudioDevices() = 0;
     virtual void setAudioCallback(AudioCallbackFn callbackFn) = 0;
     virtual expected<void, string> enableInOrOut(InOrOut ioo, string_view name, bool enabled) = 0;
-    virtual void runDispatchLoopUntil(chr::milliseconds d) = 0;
+    // JUCE's message queue is serviced by the native event loop on macOS and Windows which SDL runs while waiting for
+    // events. On Linux JUCE has its own event loop: a thread waits on it and sends msg::AudioIO::MessagesPending, which
+    // wakes up the main loop. Call this then, it dispatches all the JUCE messages posted so far without waiting.
+    virtual void dispatchPendingMessages() = 0;
 };
@@ -0,0 +1,250 @@
+#include "MixdownExporter.h"
+
+#include "AudioEngine.h"
+
+#include "common/common.h"
+#include "platform/AppMsgQueue.h"
+
+#include "juce_audio_formats/juce_audio_formats.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace
+{
+constexpr size_t k_blockSize = 4096; // Frames rendered at once.
+constexpr size_t k_numBlocks = 16; // Rendered but not yet encoded blocks, at most.
+constexpr size_t k_numChannels = 2;
+constexpr int k_bitsPerSample = 24;
+constexpr double k_progressStep = 0.01; // Progress is posted when the fraction done advanced this much.
+
+unique_ptr<juce::AudioFormat> makeAudioFormat(msg::Mixdown::Format format)
+{
+    switch (format) {
+    case msg::Mixdown::Format::wav:
+        return make_unique<juce::WavAudioFormat>();
+    case msg::Mixdown::Format::flac:
+        return make_unique<juce::FlacAudioFormat>();
+    }
+    LOG(FATAL) << fmt::format("Invalid mixdown format: {}", int(format));
+    return nullptr;
+}
+} // namespace
+
+struct MixdownExporterImpl : public MixdownExporter {
+    struct Block {
+        vector<vector<float>> channels;
+        size_t numFrames = 0;
+    };
+
+    std::thread renderer, encoder;
+    std::atomic_bool busy = false;
+    std::atomic_bool cancelled = false;
+
+    // The export in progress, shared with the threads.
+    std::shared_ptr<const ArrangementAudio> arrangement;
+    std::filesystem::path path, partialPath;
+    msg::Mixdown::Format format = msg::Mixdown::Format::wav;
+    chr::steady_clock::time_point startTime;
+
+    // The blocks go from `freeBlocks` to the renderer, to `renderedBlocks`, to the encoder and back.
+    array<Block, k_numBlocks> blocks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    deque<size_t> freeBlocks, renderedBlocks;
+    bool stopping = false; // Cancelled or the encoder failed.
+    bool renderingDone = false;
+
+    ~MixdownExporterImpl() override
+    {
+        cancel();
+        joinThreads();
+    }
+
+    bool start(
+      std::shared_ptr<const ArrangementAudio> arrangementArg,
+      std::filesystem::path pathArg,
+      msg::Mixdown::Format formatArg
+    ) override
+    {
+        if (busy) {
+            return false;
+        }
+        joinThreads();
+        arrangement = MOVE(arrangementArg);
+        path = MOVE(pathArg);
+        partialPath = path;
+        partialPath += ".part";
+        format = formatArg;
+        startTime = chr::steady_clock::now();
+        cancelled = false;
+        stopping = false;
+        renderingDone = false;
+        freeBlocks.clear();
+        renderedBlocks.clear();
+        for (size_t i : vi::iota(0u, k_numBlocks)) {
+            blocks[i].channels.assign(k_numChannels, vector<float>(k_blockSize));
+            freeBlocks.push_back(i);
+        }
+        busy = true;
+        renderer = std::thread(&MixdownExporterImpl::renderMain, this);
+        encoder = std::thread(&MixdownExporterImpl::encodeMain, this);
+        return true;
+    }
+
+    void cancel() override
+    {
+        {
+            std::lock_guard lock(mutex);
+            cancelled = true;
+            stopping = true;
+        }
+        cv.notify_all();
+    }
+
+    void joinThreads()
+    {
+        for (auto* t : {&renderer, &encoder}) {
+            if (t->joinable()) {
+                t->join();
+            }
+        }
+    }
+
+    void renderMain()
+    {
+        auto engine = AudioEngine::make();
+        engine->audioCallbacksAboutToStart(arrangement->sampleRate(), k_blockSize, 0);
+        engine->playArrangement(arrangement, 0);
+        for (int64_t pos = 0; pos < arrangement->numSamples;) {
+            size_t ix = 0;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] {
+                    return stopping || !freeBlocks.empty();
+                });
+                if (stopping) {
+                    break;
+                }
+                ix = freeBlocks.front();
+                freeBlocks.pop_front();
+            }
+            auto& block = blocks[ix];
+            block.numFrames = size_t(std::min<int64_t>(k_blockSize, arrangement->numSamples - pos));
+            array<float*, k_numChannels> outputChannels{};
+            for (size_t ch : vi::iota(0u, k_numChannels)) {
+                outputChannels[ch] = block.channels[ch].data();
+            }
+            engine->process({}, outputChannels, block.numFrames);
+            pos += int64_t(block.numFrames);
+            {
+                std::lock_guard lock(mutex);
+                renderedBlocks.push_back(ix);
+            }
+            cv.notify_all();
+        }
+        engine->audioCallbacksStopped();
+        {
+            std::lock_guard lock(mutex);
+            renderingDone = true;
+        }
+        cv.notify_all();
+    }
+
+    void encodeMain()
+    {
+        auto error = encode();
+        {
+            std::unique_lock lock(mutex);
+            if (error) {
+                stopping = true;
+                cv.notify_all();
+            }
+            cv.wait(lock, [this] {
+                return renderingDone;
+            });
+        }
+        arrangement.reset();
+        std::error_code ec;
+        if (error || cancelled) {
+            std::filesystem::remove(partialPath, ec);
+        } else if (std::filesystem::rename(partialPath, path, ec); ec) {
+            error = fmt::format("Can't rename {} to {}: {}", partialPath, path, ec.message());
+        }
+        msg::Mixdown::Finished m{
+          .path = path.string(),
+          .error = MOVE(error),
+          .cancelled = cancelled,
+          .duration = chr::steady_clock::now() - startTime
+        };
+        busy = false;
+        sendToApp(msg::Mixdown::V(MOVE(m)));
+    }
+
+    // Returns the error, nullopt if done or cancelled.
+    optional<string> encode()
+    {
+        const juce::File file(juce::String(partialPath.string()));
+        file.deleteFile(); // The stream would append to it.
+        auto stream = file.createOutputStream();
+        if (!stream) {
+            return fmt::format("Can't create {}", partialPath);
+        }
+        const auto sampleRate = arrangement->sampleRate();
+        unique_ptr<juce::AudioFormatWriter> writer(makeAudioFormat(format)->createWriterFor(
+          stream.get(), sampleRate, unsigned(k_numChannels), k_bitsPerSample, {}, 0
+        ));
+        if (!writer) {
+            return fmt::format(
+              "Can't write {} channels of {} bits at {} Hz", k_numChannels, k_bitsPerSample, sampleRate
+            );
+        }
+        stream.release(); // Owned by the writer.
+
+        int64_t numFramesWritten = 0;
+        double progressPosted = 0;
+        for (;;) {
+            size_t ix = 0;
+            {
+                std::unique_lock lock(mutex);
+                cv.wait(lock, [this] {
+                    return stopping || renderingDone || !renderedBlocks.empty();
+                });
+                if (stopping) {
+                    return nullopt;
+                }
+                if (renderedBlocks.empty()) {
+                    break;
+                }
+                ix = renderedBlocks.front();
+                renderedBlocks.pop_front();
+            }
+            auto& block = blocks[ix];
+            array<const float*, k_numChannels> channels{};
+            for (size_t ch : vi::iota(0u, k_numChannels)) {
+                channels[ch] = block.channels[ch].data();
+            }
+            if (!writer->writeFromFloatArrays(channels.data(), int(k_numChannels), int(block.numFrames))) {
+                return fmt::format("Can't write {}", partialPath);
+            }
+            numFramesWritten += int64_t(block.numFrames);
+            {
+                std::lock_guard lock(mutex);
+                freeBlocks.push_back(ix);
+            }
+            cv.notify_all();
+            const auto fraction = double(numFramesWritten) / double(arrangement->numSamples);
+            if (progressPosted + k_progressStep <= fraction) {
+                progressPosted = fraction;
+                sendToApp(msg::Mixdown::V(msg::Mixdown::Progress{fraction}));
+            }
+        }
+        writer.reset(); // Writes the header and closes the file.
+        return nullopt;
+    }
+};
+
+unique_ptr<MixdownExporter> MixdownExporter::make()
+{
+    return make_unique<MixdownExporterImpl>();
+}
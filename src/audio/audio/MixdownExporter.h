@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common/ArrangementAudio.h"
+#include "common/msg.h"
+#include "common/std.h"
+
+#include <filesystem>
+
+// Exports the arrangement's mixdown to a WAV or FLAC file in the background. An offline AudioEngine renders the
+// arrangement block by block on one thread while another encodes the rendered blocks with JUCE's audio formats. The
+// blocks are recycled through a fixed pool, so the memory used doesn't depend on the length of the song and a slow
+// encoder holds back the renderer.
+//
+// Posts msg::Mixdown::Progress while exporting and a final msg::Mixdown::Finished. The file is written next to `path`
+// and renamed when complete, a failed or cancelled export leaves nothing behind.
+class MixdownExporter
+{
+public:
+    static unique_ptr<MixdownExporter> make();
+
+    virtual ~MixdownExporter() = default;
+
+    // Returns false without starting if the previous export is still running.
+    virtual bool
+    start(std::shared_ptr<const ArrangementAudio> arrangement, std::filesystem::path path, msg::Mixdown::Format format
+    ) = 0;
+
+    // The export stops soon after, the msg::Mixdown::Finished is still posted.
+    virtual void cancel() = 0;
+};
@@ -5,7 +5,93 @@
 namespace
 {
 static const string k_question_mark = "?";
+
+ArrangementLayout makeArrangementLayout(
+  const SlotMap<Id<Section>, Section>& sections,
+  const TempoMap& tempoMap,
+  const SlotMap<Id<ClipLink>, ClipLink>& clipLinks
+)
+{
+    constexpr auto k_pixelsPerSecond = ArrangementLayout::k_pixelsPerSecond;
+    ArrangementLayout layout;
+    const auto sectionStarts = tempoMap.sections();
+    layout.sections.reserve(sectionStarts.size());
+    unordered_map<Id<Section>, size_t> sectionIxs;
+    for (size_t ix : vi::iota(0u, sectionStarts.size())) {
+        auto& ss = sectionStarts[ix];
+        auto& section = sections.at(ss.id);
+        const auto endSeconds =
+          ix + 1 < sectionStarts.size() ? sectionStarts[ix + 1].seconds : tempoMap.durationSeconds();
+        const auto startSeconds = boost::rational_cast<double>(ss.seconds);
+        const auto durationSeconds = boost::rational_cast<double>(endSeconds - ss.seconds);
+        auto& sl = layout.sections.emplace_back(ArrangementLayout::SectionLayout{
+          .id = ss.id,
+          .startSeconds = startSeconds,
+          .durationSeconds = durationSeconds,
+          .y = float(startSeconds) * k_pixelsPerSecond,
+          .height = float(durationSeconds) * k_pixelsPerSecond,
+          .textLines = {fmt::format("name: {}, {} s", section.name, float(durationSeconds))},
+          .beatMarkersBegin = layout.beatMarkers.size(),
+          .beatMarkersEnd = 0
+        });
+        switch_variant(
+          section.structure,
+          [&](const Bars& x) {
+              for (auto& b : x.bars) {
+                  sl.textLines.push_back(fmt::format("{}/{}", b.timeSignature.upper, b.timeSignature.lower));
+              }
+          },
+          [&](const Period& x) {
+              sl.textLines.push_back(fmt::format("{:.2f} whole notes", boost::rational_cast<float>(x.wholeNotes)));
+          },
+          [&](const Duration& x) {
+              sl.textLines.push_back(fmt::format("{:.2f} seconds", boost::rational_cast<float>(x.seconds)));
+          }
+        );
+        for (auto& b : tempoMap.beats().subspan(ss.beatsBegin, ss.beatsEnd - ss.beatsBegin)) {
+            const auto secondsInSection = (b.ticks - ss.ticks).toWholeNotes() / ss.tempo * 60;
+            layout.beatMarkers.push_back(ArrangementLayout::BeatMarker{
+              .yInSection = boost::rational_cast<float>(secondsInSection) * k_pixelsPerSecond, .barStart = b.barStart
+            });
+        }
+        sl.beatMarkersEnd = layout.beatMarkers.size();
+        sectionIxs.insert(pair(ss.id, ix));
+    }
+    layout.durationSeconds = boost::rational_cast<double>(tempoMap.durationSeconds());
+
+    // The clips are placed with the tempo map so the UI, the playback and the mixdown agree to the sample.
+    for (auto& [id, cl] : clipLinks) {
+        auto it = sectionIxs.find(cl.sectionId);
+        if (it == sectionIxs.end()) {
+            continue;
+        }
+        auto& ss = sectionStarts[it->second];
+        Rational clipOriginSeconds;
+        int64_t clipOriginSample{};
+        switch (cl.timeUnit) {
+        case TimeUnit::wholeNotes: {
+            const auto clipOriginTicks = ss.ticks - Ticks::fromWholeNotes(cl.clipOriginToSectionStart);
+            clipOriginSeconds = tempoMap.secondsFromTicks(clipOriginTicks);
+            clipOriginSample = tempoMap.samplesFromTicks(clipOriginTicks);
+        } break;
+        case TimeUnit::seconds:
+            clipOriginSeconds = ss.seconds - cl.clipOriginToSectionStart;
+            clipOriginSample = tempoMap.samplesFromSeconds(clipOriginSeconds);
+            break;
+        }
+        const auto clipOriginSecondsDouble = boost::rational_cast<double>(clipOriginSeconds);
+        layout.clipLinks.push_back(ArrangementLayout::ClipLinkPlacement{
+          .id = id,
+          .audioClipId = cl.audioClipId,
+          .clipOriginSeconds = clipOriginSecondsDouble,
+          .clipOriginSample = clipOriginSample,
+          .y = float(clipOriginSecondsDouble) * k_pixelsPerSecond
+        });
+    }
+    ra::sort(layout.clipLinks, {}, &ArrangementLayout::ClipLinkPlacement::clipOriginSample);
+    return layout;
 }
+} // namespace
 
 const string& AppState::AudioSettingsUI::selectedOutputDeviceName() const
 {
@@ -20,6 +106,41 @@ const string& AppState::AudioSettingsUI::selectedInputDeviceName() const
 
 AppState::AppState()
 {
+    RSE_SET_NODE_NAME(rse, audioSettingsUI);
+    RSE_SET_NODE_NAME(rse, showAudioSettings);
+    RSE_SET_NODE_NAME(rse, metronome);
+    RSE_SET_NODE_NAME(rse, recordButtonEnabled);
+    RSE_SET_NODE_NAME(rse, stopButtonEnabled);
+    RSE_SET_NODE_NAME(rse, playButtonEnabled);
+    RSE_SET_NODE_NAME(rse, recordButton);
+    RSE_SET_NODE_NAME(rse, stopButton);
+    RSE_SET_NODE_NAME(rse, inputs);
+    RSE_SET_NODE_NAME(rse, outputs);
+    RSE_SET_NODE_NAME(rse, activeAudioDevices);
+    RSE_SET_NODE_NAME(rse, metronomeChanged);
+    RSE_SET_NODE_NAME(rse, clipBeingRecordedSeconds);
+    RSE_SET_NODE_NAME(rse, playedTime);
+    RSE_SET_NODE_NAME(rse, mixdownProgress);
+    RSE_SET_NODE_NAME(rse, autosaveError);
+    RSE_SET_NODE_NAME(rse, clipBeingRecorded);
+    RSE_SET_NODE_NAME(rse, recordingWaveform);
+    RSE_SET_NODE_NAME(rse, clipBeingPlayed);
+    RSE_SET_NODE_NAME(rse, clips);
+    RSE_SET_NODE_NAME(rse, clipIds);
+    RSE_SET_NODE_NAME(rse, clipExtents);
+    RSE_SET_NODE_NAME(rse, clipStorageStats);
+    RSE_SET_NODE_NAME(rse, clipList);
+    RSE_SET_NODE_NAME(rse, sections);
+    RSE_SET_NODE_NAME(rse, sectionOrder);
+    RSE_SET_NODE_NAME(rse, nextNewTrackId);
+    RSE_SET_NODE_NAME(rse, tracks);
+    RSE_SET_NODE_NAME(rse, trackOrder);
+    RSE_SET_NODE_NAME(rse, trackLabels);
+    RSE_SET_NODE_NAME(rse, clipLinks);
+    RSE_SET_NODE_NAME(rse, tempoMap);
+    RSE_SET_NODE_NAME(rse, arrangementLayout);
+    RSE_SET_NODE_NAME(rse, timelineIndex);
+
     auto ts88 = TimeSignature{8, 8};
     auto ts44 = TimeSignature{4, 4};
     auto ts34 = TimeSignature{3, 4};
@@ -68,18 +189,26 @@ Rational Section::duration(Rational defaultTempo) const
     );
 }
 
+Ticks Bar::length() const
+{
+    return Ticks::noteValue(timeSignature.lower) * timeSignature.upper;
+}
 Rational Bar::duration(Rational tempo) const
 {
-    return Rational(60 * timeSignature.upper, timeSignature.lower) / tempo;
+    return length().toWholeNotes() / tempo * 60;
 }
-Rational Bars::duration(Rational tempo) const
+Ticks Bars::length() const
 {
-    Rational r(0);
+    Ticks r;
     for (auto& b : bars) {
-        r += b.duration(tempo);
+        r += b.length();
     }
     return r;
 }
+Rational Bars::duration(Rational tempo) const
+{
+    return length().toWholeNotes() / tempo * 60;
+}
 Rational Period::duration(Rational tempo) const
 {
     return wholeNotes / tempo * 60;
@@ -89,3 +218,130 @@ Rational AppState::Metronome::bpm() const
 {
     return tempo * timeSignature.lower;
 }
+
+void AppState::registerUpdaters()
+{
+    rse.registerUpdater(playButtonEnabled, [this]() {
+        return rse.get(activeAudioDevices).outputDevice.has_value() && !rse.get(clips).empty()
+            && !rse.get(clipBeingRecorded);
+    });
+    rse.registerUpdater(recordButtonEnabled, [this]() {
+        return rse.get(activeAudioDevices).canRecord() && !rse.get(clipBeingRecorded) && !rse.get(clipBeingPlayed);
+    });
+    rse.registerUpdater(recordButton, [this]() {
+        return rse.get(clipBeingRecorded).has_value();
+    });
+    rse.registerUpdater(stopButtonEnabled, [this]() {
+        return rse.get(clipBeingPlayed) || rse.get(clipBeingRecorded).has_value();
+    });
+    rse.registerUpdater(stopButton, [this]() {
+        return rse.get(clipBeingPlayed) || rse.get(clipBeingRecorded).has_value();
+    });
+    rse.registerUpdater(
+      metronomeChanged,
+      []() {
+          return monostate{};
+      },
+      metronome
+    );
+    rse.registerUpdater(inputs, [this]() {
+        vector<AudioChannelPropertiesOnUI> r;
+        if (auto id = rse.get(activeAudioDevices).inputDevice) {
+            r.reserve(id->channelNames.size());
+            for (auto& n : id->channelNames) {
+                r.push_back(AudioChannelPropertiesOnUI{.name = n, .enabled = false});
+            }
+            for (auto i : id->activeChannels) {
+                r.at(i).enabled = true;
+            }
+        }
+        return r;
+    });
+    rse.registerUpdater(outputs, [this]() {
+        vector<AudioChannelPropertiesOnUI> r;
+        if (auto od = rse.get(activeAudioDevices).outputDevice) {
+            r.reserve(od->channelNames.size());
+            for (auto& n : od->channelNames) {
+                r.push_back(AudioChannelPropertiesOnUI{.name = n, .enabled = false});
+            }
+            for (auto i : od->activeChannels) {
+                r.at(i).enabled = true;
+            }
+        }
+        return r;
+    });
+    rse.registerUpdater(tempoMap, [this]() {
+        auto& m = rse.get(metronome);
+        const auto sampleRate = int64_t(std::llround(rse.get(activeAudioDevices).sampleRate));
+        return TempoMap(
+          rse.get(sections),
+          rse.get(sectionOrder),
+          m.tempo,
+          m.timeSignature.lower,
+          sampleRate > 0 ? sampleRate : TempoMap::k_defaultSampleRate
+        );
+    });
+    rse.registerUpdater(arrangementLayout, [this]() {
+        return makeArrangementLayout(rse.get(sections), rse.get(tempoMap), rse.get(clipLinks));
+    });
+    rse.registerUpdater(timelineIndex, [this]() {
+        const auto sampleRate = double(rse.get(tempoMap).sampleRate());
+        auto& extents = rse.get(clipExtents);
+        auto& placements = rse.get(arrangementLayout).clipLinks;
+        vector<TimelineIndex::Interval> intervals;
+        intervals.reserve(placements.size());
+        for (auto& cl : placements) {
+            auto it = ra::lower_bound(extents, cl.audioClipId.v, {}, [](const ClipExtent& x) {
+                return x.id.v;
+            });
+            if (it == extents.end() || it->id != cl.audioClipId) {
+                continue;
+            }
+            const auto begin = cl.clipOriginSample;
+            const auto length = int64_t(std::llround(double(it->numFrames) * sampleRate / it->sampleRate));
+            intervals.push_back(TimelineIndex::Interval{
+              .begin = begin, .end = begin + length, .clipLinkId = cl.id, .audioClipId = cl.audioClipId
+            });
+        }
+        return TimelineIndex(MOVE(intervals), sampleRate);
+    });
+    rse.registerUpdater(clipIds, [this]() {
+        auto& clipMap = rse.get(clips);
+        vector<Id<AudioClip>> r;
+        r.reserve(clipMap.size());
+        for (auto& id : clipMap | vi::keys) {
+            r.push_back(id);
+        }
+        ra::sort(r, {}, &Id<AudioClip>::v);
+        return r;
+    });
+    rse.registerUpdater(clipExtents, [this]() {
+        auto& clipMap = rse.get(clips);
+        vector<ClipExtent> r;
+        r.reserve(clipMap.size());
+        for (auto& id : rse.get(clipIds)) {
+            auto& clip = clipMap.at(id);
+            r.push_back(ClipExtent{.id = id, .numFrames = clip.size(), .sampleRate = clip.sampleRate});
+        }
+        return r;
+    });
+    rse.registerUpdater(clipList, [this]() {
+        vector<ClipListItem> r;
+        auto& ids = rse.get(clipIds);
+        r.reserve(ids.size());
+        for (auto& id : ids) {
+            r.push_back(ClipListItem{
+              .id = id, .label = fmt::format("Clip #{}", id.v), .playButtonLabel = fmt::format("Play##{}", id.v)
+            });
+        }
+        return r;
+    });
+    rse.registerUpdater(trackLabels, [this]() {
+        auto& trackMap = rse.get(tracks);
+        vector<string> r;
+        for (auto& id : rse.get(trackOrder)) {
+            r.push_back(fmt::format("{}##{}", trackMap.at(id).name, id.v));
+        }
+        return r;
+    });
+}
@@ -3,6 +3,10 @@
 #include "AudioClip.h"
 #include "Id.h"
 #include "ReactiveStateEngine.h"
+#include "SlotMap.h"
+#include "TempoMap.h"
+#include "Ticks.h"
+#include "TimelineIndex.h"
 #include "audiodevicetypes.h"
 #include "common.h"
 
@@ -12,20 +16,26 @@ struct TimeSignature {
 };
 struct Bar {
     TimeSignature timeSignature;
+    Ticks length() const;
     Rational duration(Rational tempo) const;
+    bool operator==(const Bar&) const = default;
 };
 
 struct Bars {
     vector<Bar> bars;
+    Ticks length() const;
     Rational duration(Rational tempo) const;
+    bool operator==(const Bars&) const = default;
 };
 
 struct Period {
     Rational wholeNotes;
     Rational duration(Rational tempo) const;
+    bool operator==(const Period&) const = default;
 };
 struct Duration {
     Rational seconds;
+    bool operator==(const Duration&) const = default;
 };
 
 struct Section;
@@ -41,6 +51,7 @@ struct ClipLink {
     Id<AudioClip> audioClipId;
     TimeUnit timeUnit; // For start
     Rational clipOriginToSectionStart;
+    bool operator==(const ClipLink&) const = default;
 };
 
 struct Section {
@@ -51,6 +62,42 @@ struct Section {
     vector<ClipLink> clipLinksOverlapping;
 
     Rational duration(Rational defaultTempo) const;
+    bool operator==(const Section&) const = default;
+};
+
+// Geometry of the Arrangement window, computed from the tempo map so the UI doesn't do Rational math on every frame.
+// Times are in seconds from the start of the arrangement, y coordinates are in pixels.
+struct ArrangementLayout {
+    static constexpr float k_pixelsPerSecond = 40.0f;
+
+    struct BeatMarker {
+        float yInSection;
+        bool barStart;
+        bool operator==(const BeatMarker&) const = default;
+    };
+    struct SectionLayout {
+        Id<Section> id;
+        double startSeconds, durationSeconds;
+        float y, height;
+        vector<string> textLines;
+        size_t beatMarkersBegin, beatMarkersEnd; // Range in `beatMarkers`.
+        bool operator==(const SectionLayout&) const = default;
+    };
+    struct ClipLinkPlacement {
+        Id<ClipLink> id;
+        Id<AudioClip> audioClipId;
+        double clipOriginSeconds;
+        int64_t clipOriginSample; // Exact, from the tempo map at its sample rate.
+        float y;
+        bool operator==(const ClipLinkPlacement&) const = default;
+    };
+
+    vector<SectionLayout> sections; // In sectionOrder.
+    vector<BeatMarker> beatMarkers;
+    vector<ClipLinkPlacement> clipLinks; // Sorted by clipOriginSample.
+    double durationSeconds = 0;
+
+    bool operator==(const ArrangementLayout&) const = default;
 };
 
 struct Track {
@@ -67,6 +114,10 @@ struct AudioChannelPropertiesOnUI {
 struct AppState {
     AppState();
 
+    // Register the updaters of the computed nodes which depend only on other AppState nodes, the App registers the
+    // rest.
+    void registerUpdaters();
+
     ReactiveStateEngine rse;
 
     struct AudioSettingsUI {
@@ -96,19 +147,58 @@ struct AppState {
 
     rse::Value<ActiveAudioDevices> activeAudioDevices;
 
-    rse::Computed<monostate> anyVariableDisplayedOnUIChanged, metronomeChanged;
+    rse::Computed<monostate> metronomeChanged;
 
     rse::Value<optional<double>> clipBeingRecordedSeconds;
     rse::Value<optional<double>> playedTime;
+    rse::Value<optional<double>> mixdownProgress; // Fraction done while a mixdown is being exported.
+    rse::Value<optional<string>> autosaveError; // While the autosave fails to write its journal.
     rse::Value<optional<AudioClip>> clipBeingRecorded;
+    // Summary of each recorded buffer of the clip being recorded for the live waveform, only ever appended to so the
+    // growing clip is not read again.
+    rse::Value<vector<PeakPyramid::Peak>> recordingWaveform;
     rse::Value<bool> clipBeingPlayed{false};
 
-    rse::Value<unordered_map<Id<AudioClip>, AudioClip>> clips;
-    rse::Value<unordered_map<Id<Section>, Section>> sections;
+    rse::Value<SlotMap<Id<AudioClip>, AudioClip>> clips;
+    // The ids of `clips` in increasing order. Unlike `clips` it doesn't change when a clip is compressed or
+    // decompressed in the background.
+    rse::Computed<vector<Id<AudioClip>>> clipIds;
+    // The length of each clip in the order of `clipIds`, not changed by compressing or decompressing either. The
+    // samples of a clip don't change once it's in `clips` so together with the id this also identifies its peaks.
+    struct ClipExtent {
+        Id<AudioClip> id;
+        size_t numFrames;
+        double sampleRate;
+        bool operator==(const ClipExtent&) const = default;
+    };
+    rse::Computed<vector<ClipExtent>> clipExtents;
+    struct ClipStorageStats {
+        size_t numDecodedClips = 0, numCompressedClips = 0;
+        size_t decodedBytes = 0, compressedBytes = 0;
+        size_t compressedClipsDecodedBytes = 0; // The memory the compressed clips would take decoded.
+        chr::duration<double> compressionTime{}, decompressionTime{}; // Total, on the background threads.
+        size_t numSynchronousDecompressions = 0; // Clips played before their prefetch finished.
+        bool operator==(const ClipStorageStats&) const = default;
+    };
+    rse::Value<ClipStorageStats> clipStorageStats;
+    // Clips ordered by id for the clip list, with the labels formatted once instead of on every frame.
+    struct ClipListItem {
+        Id<AudioClip> id;
+        string label, playButtonLabel;
+        bool operator==(const ClipListItem&) const = default;
+    };
+    rse::Computed<vector<ClipListItem>> clipList;
+    rse::Value<SlotMap<Id<Section>, Section>> sections;
     rse::Value<vector<Id<Section>>> sectionOrder;
     rse::UndoableValue<int> nextNewTrackId{1};
-    rse::UndoableValue<unordered_map<Id<Track>, Track>> tracks;
+    rse::UndoableValue<SlotMap<Id<Track>, Track>> tracks;
     rse::UndoableValue<vector<Id<Track>>> trackOrder;
+    rse::Computed<vector<string>> trackLabels; // Selectable labels for the tracks in trackOrder.
+
+    rse::Value<SlotMap<Id<ClipLink>, ClipLink>> clipLinks;
 
-    rse::Value<unordered_map<Id<ClipLink>, ClipLink>> clipLinks;
+    rse::Computed<TempoMap> tempoMap;
+    rse::Computed<ArrangementLayout> arrangementLayout;
+    // The linked clips' extents in samples at the tempo map's sample rate, for time range queries.
+    rse::Computed<TimelineIndex> timelineIndex;
 };
@@ -0,0 +1,150 @@
+#include "ArrangementAudio.h"
+
+#include "AppState.h"
+
+namespace
+{
+// Add `n` samples of the channels of a clip from `offset` to `outputChannels` from `outputOffset`, see
+// ArrangementAudio::mix.
+template<class Channel>
+void addToOutputs(
+  span<const Channel> clipChannels, size_t offset, size_t n, span<float*> outputChannels, size_t outputOffset
+)
+{
+    for (size_t oc : vi::iota(0u, outputChannels.size())) {
+        const auto cc = clipChannels.size() == 1 ? 0 : oc;
+        if (cc >= clipChannels.size()) {
+            continue;
+        }
+        auto source = clipChannels[cc].begin() + ptrdiff_t(offset);
+        auto* output = outputChannels[oc] + outputOffset;
+        for (size_t i : vi::iota(0u, n)) {
+            output[i] += source[ptrdiff_t(i)];
+        }
+    }
+}
+
+// The channels of a chunk of a compressed clip, decoded into the least recently used buffer unless already there.
+span<const vector<float>> decodedChunk(
+  ArrangementAudio::DecodeBuffers& buffers, Id<AudioClip> clipId, const CompressedAudio& audio, size_t chunkIx
+)
+{
+    auto& chunks = buffers.chunks;
+    ++buffers.numUses;
+    auto it = ra::find_if(chunks, [clipId, chunkIx](auto& c) {
+        return c.clipId == clipId && c.chunkIx == chunkIx;
+    });
+    if (it == chunks.end()) {
+        if (chunks.empty()) {
+            chunks.emplace_back();
+        }
+        it = ra::min_element(chunks, {}, &ArrangementAudio::DecodeBuffers::Chunk::lastUsed);
+        if (it->channels.size() < audio.numChannels) {
+            it->channels.resize(audio.numChannels, vector<float>(CompressedAudio::k_compressedAudioChunkSize));
+        }
+        for (size_t c : vi::iota(0u, audio.numChannels)) {
+            audio.decompressBlock(chunkIx, c, it->channels[c]);
+        }
+        it->clipId = clipId;
+        it->chunkIx = chunkIx;
+    }
+    it->lastUsed = buffers.numUses;
+    return span<const vector<float>>(it->channels).first(audio.numChannels);
+}
+} // namespace
+
+expected<ArrangementAudio, string> ArrangementAudio::make(AppState& appState)
+{
+    auto& rse = appState.rse;
+    ArrangementAudio r;
+    r.timelineIndex = rse.get(appState.timelineIndex);
+    auto& tempoMap = rse.get(appState.tempoMap);
+    r.numSamples = tempoMap.samplesFromSeconds(tempoMap.durationSeconds());
+    auto& clips = rse.get(appState.clips);
+    for (auto& x : r.timelineIndex.all()) {
+        r.numSamples = std::max(r.numSamples, x.end);
+        if (r.clips.contains(x.audioClipId)) {
+            continue;
+        }
+        auto& clip = clips.at(x.audioClipId);
+        if (std::abs(clip.sampleRate - r.sampleRate()) > 1e-6 * r.sampleRate()) {
+            return unexpected(fmt::format(
+              "A clip is recorded at {} Hz but the arrangement plays at {} Hz, resampling is not supported",
+              clip.sampleRate,
+              r.sampleRate()
+            ));
+        }
+        r.clips.insert(pair(x.audioClipId, clip));
+    }
+    return r;
+}
+
+ArrangementAudio::DecodeBuffers ArrangementAudio::makeDecodeBuffers() const
+{
+    // The ends and begins of the compressed clips' intervals, at the same time the ends first.
+    vector<pair<int64_t, bool>> events;
+    size_t numChannels = 0;
+    for (auto& x : timelineIndex.all()) {
+        auto& clip = clips.at(x.audioClipId);
+        if (clip.compressed) {
+            events.push_back(pair(x.begin, true));
+            events.push_back(pair(x.end, false));
+            numChannels = std::max(numChannels, clip.numChannels());
+        }
+    }
+    DecodeBuffers r;
+    if (events.empty()) {
+        return r;
+    }
+    ra::sort(events);
+    size_t overlap = 0, maxOverlap = 0;
+    for (bool isBegin : events | vi::values) {
+        overlap = isBegin ? overlap + 1 : overlap - 1;
+        maxOverlap = std::max(maxOverlap, overlap);
+    }
+    // One more so a clip starting in a block doesn't evict the chunk of a clip still playing when another one ends in
+    // the same block.
+    r.chunks.resize(maxOverlap + 1);
+    for (auto& c : r.chunks) {
+        c.channels.assign(numChannels, vector<float>(CompressedAudio::k_compressedAudioChunkSize));
+    }
+    return r;
+}
+
+void ArrangementAudio::mix(int64_t begin, span<float*> outputChannels, size_t numFrames, DecodeBuffers& decodeBuffers)
+  const
+{
+    const auto end = begin + int64_t(numFrames);
+    timelineIndex.forEachOverlapping(begin, end, [&](const TimelineIndex::Interval& x) {
+        auto& clip = clips.at(x.audioClipId);
+        // [from, to) in the arrangement.
+        const auto from = std::max(begin, x.begin);
+        const auto to = std::min({end, x.end, x.begin + int64_t(clip.size())});
+        if (from >= to) {
+            return;
+        }
+        auto n = size_t(to - from);
+        auto clipOffset = size_t(from - x.begin);
+        auto outputOffset = size_t(from - begin);
+        if (!clip.compressed) {
+            addToOutputs(span(clip.channels()), clipOffset, n, outputChannels, outputOffset);
+            return;
+        }
+        constexpr auto k_chunkSize = CompressedAudio::k_compressedAudioChunkSize;
+        while (n > 0) {
+            const auto chunkIx = clipOffset / k_chunkSize;
+            const auto chunkOffset = clipOffset % k_chunkSize;
+            const auto m = std::min(n, k_chunkSize - chunkOffset);
+            addToOutputs(
+              decodedChunk(decodeBuffers, x.audioClipId, *clip.compressed, chunkIx),
+              chunkOffset,
+              m,
+              outputChannels,
+              outputOffset
+            );
+            clipOffset += m;
+            outputOffset += m;
+            n -= m;
+        }
+    });
+}
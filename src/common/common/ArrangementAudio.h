@@ -0,0 +1,47 @@
+#pragma once
+
+#include "AudioClip.h"
+#include "SlotMap.h"
+#include "TimelineIndex.h"
+
+struct AppState;
+
+// Snapshot of the arrangement's linked clips for rendering it: where each clip plays and its samples. Shared read-only
+// with the thread rendering it. The clips share their samples with the ones in the state (see AudioClip), taking the
+// snapshot copies no audio. The compressed clips stay compressed, `mix` decodes the chunks it needs.
+struct ArrangementAudio {
+    // Scratch space of `mix` for the decoded chunks of the compressed clips (see CompressedAudio), belongs to the thread
+    // calling it. Holds a chunk for each clip playing at the same time, so when mixing block by block each chunk is
+    // decoded once.
+    struct DecodeBuffers {
+        struct Chunk {
+            optional<Id<AudioClip>> clipId; // Empty if unused.
+            size_t chunkIx = 0;
+            uint64_t lastUsed = 0;
+            vector<vector<float>> channels; // k_compressedAudioChunkSize samples each.
+        };
+        vector<Chunk> chunks;
+        uint64_t numUses = 0;
+    };
+
+    TimelineIndex timelineIndex;
+    SlotMap<Id<AudioClip>, AudioClip> clips; // Only the linked ones.
+    int64_t numSamples = 0; // The end of the arrangement or of the last clip, whichever is later.
+
+    // Taken from the current state, on the main thread. Fails if a clip's sample rate differs from the arrangement's,
+    // resampling is not supported.
+    static expected<ArrangementAudio, string> make(AppState& appState);
+
+    double sampleRate() const
+    {
+        return timelineIndex.sampleRate();
+    }
+
+    // Allocates the buffers `mix` needs for this arrangement.
+    DecodeBuffers makeDecodeBuffers() const;
+
+    // Add the clips playing in [begin, begin + numFrames) to `outputChannels`. Mono clips are added to every output
+    // channel, the channels of the other clips to the output channel of the same index. Doesn't allocate if
+    // `decodeBuffers` has been made by `makeDecodeBuffers`.
+    void mix(int64_t begin, span<float*> outputChannels, size_t numFrames, DecodeBuffers& decodeBuffers) const;
+};
@@ -5,16 +5,89 @@
 
 AudioClip::AudioClip(double sampleRateArg, size_t numChannels)
     : sampleRate(sampleRateArg)
-    , channels(numChannels)
+    , peaks(numChannels)
+    , samples(std::make_shared<vector<deque<float>>>(numChannels))
 {
 }
 
 void AudioClip::append(const RecordingBuffer& from)
 {
-    CHECK(channels.size() == from.channels.size());
-    for (size_t i : vi::iota(0u, channels.size())) {
-        auto& toChannel = channels[i];
-        auto& fromChannel = from.channels[i];
+    append(from.channels);
+}
+
+void AudioClip::append(span<const vector<float>> fromChannels)
+{
+    CHECK(!compressed);
+    CHECK(samples->size() == fromChannels.size());
+    if (samples.use_count() > 1) {
+        samples = std::make_shared<vector<deque<float>>>(*samples);
+    }
+    for (size_t i : vi::iota(0u, samples->size())) {
+        auto& toChannel = (*samples)[i];
+        auto& fromChannel = fromChannels[i];
         toChannel.insert(toChannel.end(), fromChannel.begin(), fromChannel.end());
+        peaks[i].append(fromChannel);
+    }
+}
+
+void AudioClip::compress(CompressedAudio c)
+{
+    CHECK(!compressed);
+    CHECK(c.numChannels == samples->size() && c.numFrames == size());
+    compressed = std::make_shared<const CompressedAudio>(MOVE(c));
+    samples = std::make_shared<vector<deque<float>>>(compressed->numChannels);
+}
+
+void AudioClip::setDecompressed(vector<deque<float>> decompressedChannels)
+{
+    CHECK(compressed);
+    CHECK(decompressedChannels.size() == samples->size());
+    for (auto& channel : decompressedChannels) {
+        CHECK(channel.size() == compressed->numFrames);
+    }
+    samples = std::make_shared<vector<deque<float>>>(MOVE(decompressedChannels));
+    compressed.reset();
+}
+
+AudioClip AudioClip::decompressed() const
+{
+    AudioClip r = *this;
+    if (compressed) {
+        r.setDecompressed(compressed->decompress());
+    }
+    return r;
+}
+
+void AudioClip::waveform(size_t channel, size_t sampleBegin, size_t sampleEnd, span<PeakPyramid::Peak> pixels) const
+{
+    CHECK(channel < samples->size());
+    CHECK(sampleBegin <= sampleEnd);
+    if (pixels.empty()) {
+        return;
+    }
+    auto numPixels = pixels.size();
+    if (compressed || sampleEnd - sampleBegin >= numPixels * PeakPyramid::k_level0BlockSize) {
+        peaks[channel].query(sampleBegin, sampleEnd, pixels);
+        return;
+    }
+    // Less than a level 0 block per pixel, reading the samples is still bounded by the number of pixels.
+    auto& channelSamples = (*samples)[channel];
+    sampleEnd = std::min(sampleEnd, channelSamples.size());
+    const double samplesPerPixel = double(sampleEnd - std::min(sampleBegin, sampleEnd)) / double(numPixels);
+    for (size_t px : vi::iota(0u, numPixels)) {
+        auto s0 = sampleBegin + size_t(double(px) * samplesPerPixel);
+        auto s1 = std::min(sampleEnd, std::max(s0 + 1, sampleBegin + size_t(double(px + 1) * samplesPerPixel)));
+        if (s0 >= s1) {
+            pixels[px] = PeakPyramid::Peak{};
+            continue;
+        }
+        auto p = PeakPyramid::Peak{.min = channelSamples[s0], .max = channelSamples[s0], .meanSquare = 0};
+        for (size_t s : vi::iota(s0, s1)) {
+            p.min = std::min(p.min, channelSamples[s]);
+            p.max = std::max(p.max, channelSamples[s]);
+            p.meanSquare += channelSamples[s] * channelSamples[s];
+        }
+        p.meanSquare /= float(s1 - s0);
+        pixels[px] = p;
     }
 }
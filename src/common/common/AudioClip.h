@@ -1,18 +1,56 @@
 #pragma once
 
+#include "CompressedAudio.h"
+#include "PeakPyramid.h"
 #include "std.h"
 
 struct RecordingBuffer;
 
 // Todo make it safer, guarantee invariants.
+//
+// The samples are shared read-only between the copies of a clip, so copying a clip for the undo history, a background
+// job or a snapshot rendered on another thread doesn't copy the audio. `append` copies them first if they are shared.
+// The copies are made on the main thread, that's where the clips live.
 struct AudioClip {
     AudioClip(double sampleRate, size_t numChannels);
     double sampleRate;
-    vector<deque<float>> channels;
+    vector<PeakPyramid> peaks; // One for each channel, kept in sync with the samples by `append`.
+    // The samples of an idle clip can be held compressed instead of in `channels()`, see ClipTiering. The peaks are
+    // kept.
+    std::shared_ptr<const CompressedAudio> compressed;
 
+    size_t numChannels() const
+    {
+        return samples->size();
+    }
+    // Empty deques while the clip is compressed.
+    const vector<deque<float>>& channels() const
+    {
+        return *samples;
+    }
+    // For reading the samples on another thread while the clip may be changed or compressed.
+    std::shared_ptr<const vector<deque<float>>> sharedChannels() const
+    {
+        return samples;
+    }
     size_t size() const
     {
-        return channels.empty() ? 0 : channels[0].size();
+        return compressed ? compressed->numFrames : samples->empty() ? 0 : (*samples)[0].size();
     }
     void append(const RecordingBuffer& from);
+    void append(span<const vector<float>> fromChannels);
+
+    void compress(CompressedAudio c);
+    // Replace the compressed samples with `decompressedChannels`, the result of `compressed->decompress()`.
+    void setDecompressed(vector<deque<float>> decompressedChannels);
+    // A copy with the samples in `channels()`.
+    AudioClip decompressed() const;
+
+    // Summarize [sampleBegin, sampleEnd) of a channel split evenly into `pixels.size()` ranges. Uses the peak pyramid
+    // when zoomed out or when the clip is compressed and the samples when zoomed in, so the cost is proportional to the
+    // number of pixels.
+    void waveform(size_t channel, size_t sampleBegin, size_t sampleEnd, span<PeakPyramid::Peak> pixels) const;
+
+private:
+    std::shared_ptr<vector<deque<float>>> samples; // Never null.
 };
@@ -0,0 +1,214 @@
+#include "AudioLevelMeters.h"
+
+#include "common.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define AUDIO_LEVEL_METERS_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define AUDIO_LEVEL_METERS_NEON
+#endif
+
+namespace
+{
+// Four floats in a SIMD register, with the few operations the meters need: SSE2 on x86-64, NEON on ARM64 and a plain
+// array elsewhere.
+struct F32x4 {
+#if defined(AUDIO_LEVEL_METERS_SSE2)
+    __m128 v;
+
+    static F32x4 zero()
+    {
+        return {_mm_setzero_ps()};
+    }
+    static F32x4 load(const float* p)
+    {
+        return {_mm_loadu_ps(p)};
+    }
+    void store(float* p) const
+    {
+        _mm_storeu_ps(p, v);
+    }
+    F32x4 abs() const
+    {
+        return {_mm_andnot_ps(_mm_set1_ps(-0.0f), v)};
+    }
+    friend F32x4 max(F32x4 x, F32x4 y)
+    {
+        return {_mm_max_ps(x.v, y.v)};
+    }
+    friend F32x4 operator+(F32x4 x, F32x4 y)
+    {
+        return {_mm_add_ps(x.v, y.v)};
+    }
+    friend F32x4 operator*(F32x4 x, F32x4 y)
+    {
+        return {_mm_mul_ps(x.v, y.v)};
+    }
+#elif defined(AUDIO_LEVEL_METERS_NEON)
+    float32x4_t v;
+
+    static F32x4 zero()
+    {
+        return {vdupq_n_f32(0)};
+    }
+    static F32x4 load(const float* p)
+    {
+        return {vld1q_f32(p)};
+    }
+    void store(float* p) const
+    {
+        vst1q_f32(p, v);
+    }
+    F32x4 abs() const
+    {
+        return {vabsq_f32(v)};
+    }
+    friend F32x4 max(F32x4 x, F32x4 y)
+    {
+        return {vmaxq_f32(x.v, y.v)};
+    }
+    friend F32x4 operator+(F32x4 x, F32x4 y)
+    {
+        return {vaddq_f32(x.v, y.v)};
+    }
+    friend F32x4 operator*(F32x4 x, F32x4 y)
+    {
+        return {vmulq_f32(x.v, y.v)};
+    }
+#else
+    array<float, 4> v;
+
+    static F32x4 zero()
+    {
+        return {};
+    }
+    static F32x4 load(const float* p)
+    {
+        F32x4 r;
+        std::copy_n(p, 4, r.v.begin());
+        return r;
+    }
+    void store(float* p) const
+    {
+        ra::copy(v, p);
+    }
+    F32x4 abs() const
+    {
+        return map(*this, *this, [](float x, float) {
+            return std::abs(x);
+        });
+    }
+    friend F32x4 max(F32x4 x, F32x4 y)
+    {
+        return map(x, y, [](float a, float b) {
+            return std::max(a, b);
+        });
+    }
+    friend F32x4 operator+(F32x4 x, F32x4 y)
+    {
+        return map(x, y, std::plus<float>());
+    }
+    friend F32x4 operator*(F32x4 x, F32x4 y)
+    {
+        return map(x, y, std::multiplies<float>());
+    }
+
+    template<class Fn>
+    static F32x4 map(F32x4 x, F32x4 y, Fn fn)
+    {
+        F32x4 r;
+        for (size_t i : vi::iota(0u, 4u)) {
+            r.v[i] = fn(x.v[i], y.v[i]);
+        }
+        return r;
+    }
+#endif
+};
+} // namespace
+
+PeakAndSumOfSquares peakAndSumOfSquares(span<const float> xs)
+{
+    // Two accumulators of each so consecutive additions don't wait for each other.
+    constexpr size_t k_step = 8;
+    auto peaks0 = F32x4::zero(), peaks1 = F32x4::zero(), sums0 = F32x4::zero(), sums1 = F32x4::zero();
+    const size_t numFullSteps = xs.size() / k_step * k_step;
+    for (size_t i = 0; i < numFullSteps; i += k_step) {
+        const auto x0 = F32x4::load(xs.data() + i), x1 = F32x4::load(xs.data() + i + 4);
+        peaks0 = max(peaks0, x0.abs());
+        peaks1 = max(peaks1, x1.abs());
+        sums0 = sums0 + x0 * x0;
+        sums1 = sums1 + x1 * x1;
+    }
+    array<float, 4> peaks{}, sums{};
+    max(peaks0, peaks1).store(peaks.data());
+    (sums0 + sums1).store(sums.data());
+    PeakAndSumOfSquares r{0, 0};
+    for (size_t j : vi::iota(0u, 4u)) {
+        r.peak = std::max(r.peak, peaks[j]);
+        r.sumOfSquares += sums[j];
+    }
+    for (size_t i : vi::iota(numFullSteps, xs.size())) {
+        r.peak = std::max(r.peak, std::abs(xs[i]));
+        r.sumOfSquares += xs[i] * xs[i];
+    }
+    return r;
+}
+
+void AudioLevelMeters::process(span<const float* const> channelData, size_t numSamples, double sampleRate)
+{
+    const size_t n = std::min(channelData.size(), k_maxNumChannels);
+    if (numSamples == 0 || sampleRate <= 0) {
+        return;
+    }
+    // One-pole integrator applied once per buffer.
+    const auto decay = float(std::exp(-double(numSamples) / (k_rmsIntegrationTime * sampleRate)));
+    for (size_t i : vi::iota(0u, n)) {
+        auto [peak, sumOfSquares] = peakAndSumOfSquares(span(channelData[i], numSamples));
+        auto& ims = integratedMeanSquares[i];
+        ims = decay * ims + (1 - decay) * sumOfSquares / float(numSamples);
+        auto& c = channels[i];
+        c.meanSquare.store(ims, std::memory_order_relaxed);
+        float oldPeak = c.peak.load(std::memory_order_relaxed);
+        while (oldPeak < peak && !c.peak.compare_exchange_weak(oldPeak, peak, std::memory_order_relaxed)) {
+            // `oldPeak` has been updated by compare_exchange_weak, retry.
+        }
+    }
+    if (numChannelsProcessed.load(std::memory_order_relaxed) != n) {
+        for (size_t i : vi::iota(n, k_maxNumChannels)) {
+            integratedMeanSquares[i] = 0;
+            channels[i].meanSquare.store(0, std::memory_order_relaxed);
+        }
+        numChannelsProcessed.store(n, std::memory_order_relaxed);
+    }
+}
+
+void AudioLevelMeters::reset()
+{
+    numChannelsProcessed.store(0, std::memory_order_relaxed);
+    for (size_t i : vi::iota(0u, k_maxNumChannels)) {
+        integratedMeanSquares[i] = 0;
+        channels[i].peak.store(0, std::memory_order_relaxed);
+        channels[i].meanSquare.store(0, std::memory_order_relaxed);
+    }
+}
+
+AudioLevelMeters::Levels AudioLevelMeters::read(size_t channelIx)
+{
+    CHECK_OR_RETURN_VAL(channelIx < k_maxNumChannels, Levels{});
+    auto& c = channels[channelIx];
+    return Levels{
+      .peak = c.peak.exchange(0, std::memory_order_relaxed),
+      .rms = std::sqrt(c.meanSquare.load(std::memory_order_relaxed))
+    };
+}
+
+AudioLevelMeters::Levels AudioLevelMeters::peek(size_t channelIx) const
+{
+    CHECK_OR_RETURN_VAL(channelIx < k_maxNumChannels, Levels{});
+    auto& c = channels[channelIx];
+    return Levels{
+      .peak = c.peak.load(std::memory_order_relaxed), .rms = std::sqrt(c.meanSquare.load(std::memory_order_relaxed))
+    };
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "std.h"
+
+#include <atomic>
+
+// Per-channel peak and RMS levels written by the audio thread and read by the UI at frame rate through relaxed
+// atomics: no messages, no locks and no allocations on the audio thread.
+//
+// The peak is the maximum absolute sample value since the last `read`. The RMS is integrated on the audio thread with
+// k_rmsIntegrationTime so it doesn't depend on how often it's read.
+class AudioLevelMeters
+{
+public:
+    static constexpr size_t k_maxNumChannels = 64;
+    static constexpr double k_rmsIntegrationTime = 0.3;
+
+    struct Levels {
+        float peak = 0;
+        float rms = 0;
+    };
+
+    // Audio thread. Channels beyond k_maxNumChannels are not metered.
+    void process(span<const float* const> channels, size_t numSamples, double sampleRate);
+
+    // When the audio callbacks have stopped.
+    void reset();
+
+    // Any thread. Resets the peak.
+    Levels read(size_t channelIx);
+    // Any thread. Leaves the peak for the next `read`.
+    Levels peek(size_t channelIx) const;
+    size_t numChannels() const
+    {
+        return numChannelsProcessed.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(64) Channel {
+        std::atomic<float> peak{0};
+        std::atomic<float> meanSquare{0};
+    };
+    array<Channel, k_maxNumChannels> channels;
+    std::atomic<size_t> numChannelsProcessed{0};
+
+    // Audio thread only.
+    array<float, k_maxNumChannels> integratedMeanSquares{};
+};
+
+struct PeakAndSumOfSquares {
+    float peak;
+    float sumOfSquares;
+};
+// Maximum absolute value and sum of squares of the samples, with SSE2 or NEON where available.
+PeakAndSumOfSquares peakAndSumOfSquares(span<const float> xs);
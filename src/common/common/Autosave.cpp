@@ -0,0 +1,645 @@
+#include "Autosave.h"
+
+#include <fstream>
+
+#ifdef _WIN32
+  #include <io.h>
+  #include <sys/locking.h>
+#else
+  #include <sys/file.h>
+  #include <unistd.h>
+#endif
+
+namespace
+{
+std::filesystem::path snapshotPath(const std::filesystem::path& dir)
+{
+    return dir / "snapshot.dtproj";
+}
+
+std::filesystem::path journalPath(const std::filesystem::path& dir)
+{
+    return dir / "journal.dtjl";
+}
+
+std::filesystem::path lockPath(const std::filesystem::path& dir)
+{
+    return dir / "lock";
+}
+
+constexpr string_view k_clipFilePrefix = "clip_";
+constexpr string_view k_clipFileExtension = ".dtclip";
+
+std::filesystem::path clipPath(const std::filesystem::path& dir, Id<AudioClip> id)
+{
+    return dir / fmt::format("{}{:016x}{}", k_clipFilePrefix, id.v, k_clipFileExtension);
+}
+
+// Including the temporary ones.
+vector<std::filesystem::path> clipFiles(const std::filesystem::path& dir)
+{
+    vector<std::filesystem::path> paths;
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (entry.path().filename().string().starts_with(k_clipFilePrefix)) {
+            paths.push_back(entry.path());
+        }
+    }
+    return paths;
+}
+
+// The instances' directories are named "session_<time>", the ones which couldn't be recovered are renamed.
+constexpr string_view k_sessionDirPrefix = "session_";
+
+bool hasRecoveryFiles(const std::filesystem::path& dir)
+{
+    std::error_code ec;
+    return std::filesystem::exists(journalPath(dir), ec) || std::filesystem::exists(snapshotPath(dir), ec);
+}
+
+std::filesystem::path tmpPath(std::filesystem::path path)
+{
+    return path += ".tmp";
+}
+
+// Flushes the stdio buffers and waits until the OS has written the file to the disk.
+bool syncFile(FILE* f)
+{
+    if (fflush(f) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+expected<void, string> syncFile(const std::filesystem::path& path)
+{
+    FILE* f = fopen(path.string().c_str(), "ab");
+    if (!f) {
+        return unexpected(fmt::format("Can't open {}", path));
+    }
+    const bool ok = syncFile(f);
+    fclose(f);
+    if (!ok) {
+        return unexpected(fmt::format("Failed to sync {}", path));
+    }
+    return {};
+}
+
+expected<vector<char>, string> readFile(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary | std::ios::ate);
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for reading", path));
+    }
+    vector<char> bytes(size_t(f.tellg()));
+    f.seekg(0);
+    f.read(bytes.data(), std::streamsize(bytes.size()));
+    if (!f) {
+        return unexpected(fmt::format("Failed to read {}", path));
+    }
+    return bytes;
+}
+
+size_t journalHeaderSize()
+{
+    vector<char> header;
+    startJournal(header);
+    return header.size();
+}
+
+// Writes the file to a temporary one and renames it to `path`, so a crash never leaves a partial file behind.
+expected<void, string> writeFileAtomically(const std::filesystem::path& path, span<const char> bytes)
+{
+    const auto tmp = tmpPath(path);
+    FILE* f = fopen(tmp.string().c_str(), "wb");
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for writing", tmp));
+    }
+    const bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size() && syncFile(f);
+    fclose(f);
+    if (!ok) {
+        return unexpected(fmt::format("Failed to write {}", tmp));
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        return unexpected(fmt::format("Can't rename {} to {}: {}", tmp, path, ec.message()));
+    }
+    return {};
+}
+
+// Writes an empty journal, returns it opened for appending.
+expected<FILE*, string> createJournal(const std::filesystem::path& path)
+{
+    vector<char> header;
+    startJournal(header);
+    if (auto r = writeFileAtomically(path, header); !r) {
+        return unexpected(r.error());
+    }
+    FILE* f = fopen(path.string().c_str(), "ab");
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for appending", path));
+    }
+    return f;
+}
+
+// A clip's audio is written once, to a journal of its own holding the single clipAdded record.
+expected<void, string> writeClipFile(const std::filesystem::path& dir, Id<AudioClip> id, const AudioClip& clip)
+{
+    vector<char> bytes;
+    startJournal(bytes);
+    appendJournalClipAdded(bytes, id, clip);
+    return writeFileAtomically(clipPath(dir, id), bytes);
+}
+
+// Replays the journal file over `project`.
+expected<void, string> replayJournalFile(const std::filesystem::path& path, Project& project)
+{
+    auto bytes = readFile(path);
+    if (!bytes) {
+        return unexpected(bytes.error());
+    }
+    auto replayed = replayJournal(*bytes, project);
+    if (!replayed) {
+        return unexpected(fmt::format("{}: {}", path, replayed.error()));
+    }
+    if (*replayed < bytes->size()) {
+        LOG(WARNING) << fmt::format(
+          "Ignoring the last {} bytes of {}, an incomplete record", bytes->size() - *replayed, path
+        );
+    }
+    return {};
+}
+
+// The snapshot with the journal replayed, and the clip files replayed between them if `withClips`.
+expected<Project, string> recoverFiles(const std::filesystem::path& dir, bool withClips)
+{
+    Project project;
+    std::error_code ec;
+    if (std::filesystem::exists(snapshotPath(dir), ec)) {
+        auto snapshot = loadProject(snapshotPath(dir));
+        if (!snapshot) {
+            return unexpected(snapshot.error());
+        }
+        project = MOVE(*snapshot);
+    }
+    if (withClips) {
+        for (auto& path : clipFiles(dir)) {
+            if (path.extension() != k_clipFileExtension) {
+                continue; // Left behind by a crash while it was being written.
+            }
+            if (auto r = replayJournalFile(path, project); !r) {
+                return unexpected(r.error());
+            }
+        }
+    }
+    if (std::filesystem::exists(journalPath(dir), ec)) {
+        if (auto r = replayJournalFile(journalPath(dir), project); !r) {
+            return unexpected(r.error());
+        }
+    }
+    return project;
+}
+
+// True if the node changed since `journaledTimestamp`, which is updated.
+template<class Node>
+bool changedSince(uint64_t& journaledTimestamp, ReactiveStateEngine& rse, const Node& node)
+{
+    const auto t = rse.changeTimestamp(node);
+    if (t == journaledTimestamp) {
+        return false;
+    }
+    journaledTimestamp = t;
+    return true;
+}
+
+// Appends the records of the items added or changed since `journaled` to `setRecords` and of the removed ones to
+// `removedRecords`, and updates `journaled`. Comparing the items costs much less than serializing all of them.
+template<class T>
+void journalItems(
+  const SlotMap<Id<T>, T>& items, SlotMap<Id<T>, T>& journaled, vector<char>& setRecords, vector<char>& removedRecords
+)
+{
+    for (auto& [id, x] : items) {
+        auto it = journaled.find(id);
+        if (it == journaled.end()) {
+            journaled.insert(pair(id, x));
+        } else if (it->second != x) {
+            it->second = x;
+        } else {
+            continue;
+        }
+        appendJournalItem(setRecords, id, x);
+    }
+    if (journaled.size() == items.size()) {
+        return;
+    }
+    vector<Id<T>> removed;
+    for (auto id : journaled | vi::keys) {
+        if (!items.contains(id)) {
+            removed.push_back(id);
+        }
+    }
+    for (auto id : removed) {
+        appendJournalItemRemoved(removedRecords, id);
+        journaled.erase(id);
+    }
+}
+} // namespace
+
+Autosave::LockedDir::LockedDir(std::filesystem::path dirArg, FILE* lockFileArg)
+    : dir(MOVE(dirArg))
+    , lockFile(lockFileArg)
+{
+}
+
+Autosave::LockedDir::~LockedDir()
+{
+    fclose(lockFile);
+}
+
+unique_ptr<Autosave::LockedDir> Autosave::LockedDir::lock(std::filesystem::path dir)
+{
+    FILE* f = fopen(lockPath(dir).string().c_str(), "wb");
+    if (!f) {
+        return nullptr;
+    }
+#ifdef _WIN32
+    const bool locked = _locking(_fileno(f), _LK_NBLCK, 1) == 0;
+#else
+    const bool locked = flock(fileno(f), LOCK_EX | LOCK_NB) == 0;
+#endif
+    if (!locked) {
+        fclose(f);
+        return nullptr;
+    }
+    return unique_ptr<LockedDir>(new LockedDir(MOVE(dir), f));
+}
+
+std::filesystem::path Autosave::defaultDirectory()
+{
+    return std::filesystem::temp_directory_path() / "dawtracker_autosave";
+}
+
+unique_ptr<Autosave::LockedDir> Autosave::lockAbandonedDirectory(const std::filesystem::path& baseDir)
+{
+    std::error_code ec;
+    for (auto& entry : std::filesystem::directory_iterator(baseDir, ec)) {
+        if (!entry.is_directory(ec) || !entry.path().filename().string().starts_with(k_sessionDirPrefix)) {
+            continue;
+        }
+        auto lockedDir = LockedDir::lock(entry.path());
+        if (!lockedDir) {
+            continue; // Running.
+        }
+        if (hasRecoveryFiles(lockedDir->path())) {
+            return lockedDir;
+        }
+        removeDirectory(MOVE(lockedDir)); // Emptied by an instance exiting right now, or left empty by a crash.
+    }
+    return nullptr;
+}
+
+// The autosave files are removed first, so an instance which finds the directory unlocked before it's gone doesn't
+// recover it.
+void Autosave::removeDirectory(unique_ptr<LockedDir> toRemove)
+{
+    const auto dir = toRemove->path();
+    std::error_code ec;
+    // The clip files last, they are not recovered without a journal or a snapshot.
+    vector<std::filesystem::path> paths{
+      journalPath(dir), snapshotPath(dir), tmpPath(journalPath(dir)), tmpPath(snapshotPath(dir))
+    };
+    for (auto& path : clipFiles(dir)) {
+        paths.push_back(path);
+    }
+    for (auto& path : paths) {
+        std::filesystem::remove(path, ec);
+        if (ec) {
+            LOG(ERROR) << fmt::format("Can't remove {}: {}", path, ec.message());
+        }
+    }
+    toRemove.reset(); // An open file can't be removed on Windows.
+    std::filesystem::remove(lockPath(dir), ec);
+    std::filesystem::remove(dir, ec); // Only if empty.
+}
+
+expected<Project, string> Autosave::recover(const std::filesystem::path& dir)
+{
+    return recoverFiles(dir, true);
+}
+
+expected<unique_ptr<Autosave>, string> Autosave::make(
+  AppState& appState,
+  const std::filesystem::path& baseDir,
+  unique_ptr<LockedDir> recovered,
+  ErrorChangedFn errorChanged
+)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(baseDir, ec);
+    if (ec) {
+        return unexpected(fmt::format("Can't create {}: {}", baseDir, ec.message()));
+    }
+    std::filesystem::path dir;
+    do {
+        dir = baseDir
+            / fmt::format("{}{}", k_sessionDirPrefix, chr::system_clock::now().time_since_epoch().count());
+    } while (!std::filesystem::create_directory(dir, ec) && !ec);
+    if (ec) {
+        return unexpected(fmt::format("Can't create {}: {}", dir, ec.message()));
+    }
+    auto lockedDir = LockedDir::lock(dir);
+    if (!lockedDir) {
+        return unexpected(fmt::format("Can't lock {}", dir));
+    }
+    auto journal = createJournal(journalPath(dir));
+    if (!journal) {
+        removeDirectory(MOVE(lockedDir));
+        return unexpected(journal.error());
+    }
+    unique_ptr<Autosave> autosave(new Autosave(appState, MOVE(lockedDir), *journal, MOVE(errorChanged)));
+    autosave->commit();
+    if (recovered) {
+        autosave->push(MOVE(recovered));
+    }
+    return autosave;
+}
+
+Autosave::Autosave(
+  AppState& appStateArg, unique_ptr<LockedDir> lockedDirArg, FILE* journalArg, ErrorChangedFn errorChangedArg
+)
+    : appState(appStateArg)
+    , lockedDir(MOVE(lockedDirArg))
+    , dir(lockedDir->path())
+    , errorChanged(MOVE(errorChangedArg))
+    , journal(journalArg)
+    , journalSize(journalHeaderSize())
+    , worker(&Autosave::workerMain, this)
+{
+}
+
+Autosave::~Autosave()
+{
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+    worker.join();
+    if (journal) {
+        fclose(journal);
+    }
+    removeDirectory(MOVE(lockedDir));
+}
+
+void Autosave::commit()
+{
+    auto& rse = appState.rse;
+    auto& t = journaledTimestamps;
+
+    // The added clips come first and the removed ones last, so the items of the document refer to journaled clips.
+    vector<Id<AudioClip>> removedClips;
+    if (changedSince(t.clips, rse, appState.clips)) {
+        auto& clips = rse.get(appState.clips);
+        for (auto it = journaledClips.begin(); it != journaledClips.end();) {
+            if (clips.contains(*it)) {
+                ++it;
+            } else {
+                removedClips.push_back(*it);
+                it = journaledClips.erase(it);
+            }
+        }
+        for (auto& [id, clip] : clips) {
+            if (journaledClips.insert(id).second) {
+                push(ClipToWrite{.id = id, .clip = clip});
+            }
+        }
+    }
+
+    // Likewise the items are added before and removed after the orders referring to them.
+    vector<char> records, removedRecords;
+    if (changedSince(t.metronome, rse, appState.metronome)) {
+        appendJournalMetronome(records, rse.get(appState.metronome));
+    }
+    if (changedSince(t.sections, rse, appState.sections)) {
+        journalItems(rse.get(appState.sections), journaledSections, records, removedRecords);
+    }
+    if (changedSince(t.tracks, rse, appState.tracks)) {
+        journalItems(rse.get(appState.tracks), journaledTracks, records, removedRecords);
+    }
+    if (changedSince(t.clipLinks, rse, appState.clipLinks)) {
+        journalItems(rse.get(appState.clipLinks), journaledClipLinks, records, removedRecords);
+    }
+    if (changedSince(t.sectionOrder, rse, appState.sectionOrder)) {
+        appendJournalSectionOrder(records, rse.get(appState.sectionOrder));
+    }
+    // Evaluated both so both timestamps are updated.
+    const bool nextNewTrackIdChanged = changedSince(t.nextNewTrackId, rse, appState.nextNewTrackId);
+    if (changedSince(t.trackOrder, rse, appState.trackOrder) || nextNewTrackIdChanged) {
+        appendJournalTrackOrder(records, rse.get(appState.nextNewTrackId), rse.get(appState.trackOrder));
+    }
+    records.insert(records.end(), removedRecords.begin(), removedRecords.end());
+    if (!records.empty()) {
+        push(MOVE(records));
+    }
+    for (auto id : removedClips) {
+        push(ClipRemoved{id});
+    }
+}
+
+void Autosave::push(Item item)
+{
+    {
+        std::lock_guard lock(mutex);
+        queue.push_back(MOVE(item));
+    }
+    cv.notify_one();
+}
+
+void Autosave::workerMain()
+{
+    for (;;) {
+        // The items which failed to be written come first.
+        auto items = MOVE(unwrittenItems);
+        unwrittenItems.clear();
+        {
+            std::unique_lock lock(mutex);
+            auto ready = [this] {
+                return stopping || !queue.empty();
+            };
+            if (items.empty()) {
+                cv.wait(lock, ready);
+            } else {
+                cv.wait_for(lock, k_autosaveRetryInterval, ready);
+            }
+            if (stopping && queue.empty()) {
+                return;
+            }
+            for (auto& item : queue) {
+                items.push_back(MOVE(item));
+            }
+            queue.clear();
+        }
+        if (auto r = writeBatch(items); !r) {
+            LOG(ERROR) << fmt::format("Autosave failed, retrying: {}", r.error());
+            unwrittenItems = MOVE(items); // Including the recovered directories, the document may not be anywhere else.
+            setWriteError(r.error());
+            continue;
+        }
+        setWriteError(nullopt);
+        if (journalSize > k_autosaveCompactionThreshold) {
+            compact();
+        }
+    }
+}
+
+// The clip files are written first, the records of the document may refer to the clips. The items are left in place
+// for retrying if writing fails.
+expected<void, string> Autosave::writeBatch(vector<Item>& items)
+{
+    vector<char> bytes;
+    vector<Id<AudioClip>> removedClips;
+    for (auto& item : items) {
+        auto r = switch_variant(
+          item,
+          [&](const vector<char>& records) -> expected<void, string> {
+              bytes.insert(bytes.end(), records.begin(), records.end());
+              return {};
+          },
+          [&](const ClipToWrite& x) -> expected<void, string> {
+              return writeClipFile(dir, x.id, x.clip);
+          },
+          [&](const ClipRemoved& x) -> expected<void, string> {
+              appendJournalClipRemoved(bytes, x.id);
+              removedClips.push_back(x.id);
+              return {};
+          },
+          [&](const unique_ptr<LockedDir>&) -> expected<void, string> {
+              return {};
+          }
+        );
+        if (!r) {
+            return r;
+        }
+    }
+    if (auto r = appendToJournal(bytes); !r) {
+        return r;
+    }
+    // The file of a removed clip is recovered unless the removal is in the journal, see compact.
+    for (auto id : removedClips) {
+        std::error_code ec;
+        std::filesystem::remove(clipPath(dir, id), ec);
+        if (ec) {
+            LOG(ERROR) << fmt::format("Can't remove {}: {}", clipPath(dir, id), ec.message());
+            clipFilesToRemove.push_back(id);
+        }
+    }
+    for (auto& item : items) {
+        if (auto* d = std::get_if<unique_ptr<LockedDir>>(&item)) {
+            removeDirectory(MOVE(*d));
+        }
+    }
+    return {};
+}
+
+// On failure the journal is truncated to its last complete record, the records appended after a partial one would be
+// ignored by replayJournal.
+expected<void, string> Autosave::appendToJournal(const vector<char>& bytes)
+{
+    const auto path = journalPath(dir);
+    std::error_code ec;
+    if (!journal) {
+        // The previous attempt couldn't reopen it or truncate it.
+        std::filesystem::resize_file(path, journalSize, ec);
+        if (ec) {
+            return unexpected(fmt::format("Can't truncate {}: {}", path, ec.message()));
+        }
+        journal = fopen(path.string().c_str(), "ab");
+        if (!journal) {
+            return unexpected(fmt::format("Can't open {} for appending", path));
+        }
+    }
+    if (bytes.empty()) {
+        return {};
+    }
+    if (fwrite(bytes.data(), 1, bytes.size(), journal) == bytes.size() && syncFile(journal)) {
+        journalSize += bytes.size();
+        return {};
+    }
+    // Closed first, an open file can't be resized on Windows.
+    fclose(journal);
+    journal = nullptr;
+    std::filesystem::resize_file(path, journalSize, ec);
+    if (!ec) {
+        journal = fopen(path.string().c_str(), "ab");
+    }
+    return unexpected(fmt::format("Can't write {}", path));
+}
+
+void Autosave::setWriteError(optional<string> error)
+{
+    if (error != writeError) {
+        writeError = error;
+        if (errorChanged) {
+            errorChanged(MOVE(error));
+        }
+    }
+}
+
+// Replaces the snapshot with one which has the journal applied, then replaces the journal with an empty one. Crashing
+// between the two leaves the new snapshot with the old journal behind, replaying it again yields the same document.
+void Autosave::compact()
+{
+    // The journal may hold the only record of a clip's removal.
+    std::erase_if(clipFilesToRemove, [this](Id<AudioClip> id) {
+        std::error_code ec;
+        std::filesystem::remove(clipPath(dir, id), ec);
+        return !ec;
+    });
+    if (!clipFilesToRemove.empty()) {
+        LOG(ERROR) << fmt::format(
+          "Autosave compaction postponed, can't remove {} clip files", clipFilesToRemove.size()
+        );
+        return;
+    }
+    // The clips are in their own files, only the rest of the document is read and written.
+    auto project = recoverFiles(dir, false);
+    if (!project) {
+        LOG(ERROR) << fmt::format("Autosave compaction failed: {}", project.error());
+        return;
+    }
+    const auto tmp = tmpPath(snapshotPath(dir));
+    auto r = saveProject(ProjectRef::of(*project), tmp, ProjectAudioStorage::embeddedCompressed);
+    if (r) {
+        r = syncFile(tmp);
+    }
+    if (!r) {
+        LOG(ERROR) << fmt::format("Autosave compaction failed: {}", r.error());
+        return;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, snapshotPath(dir), ec);
+    if (ec) {
+        LOG(ERROR) << fmt::format("Can't rename {} to {}: {}", tmp, snapshotPath(dir), ec.message());
+        return;
+    }
+    // The old journal is closed first, an open file can't be replaced on Windows.
+    fclose(journal);
+    auto newJournal = createJournal(journalPath(dir));
+    if (newJournal) {
+        journal = *newJournal;
+        journalSize = journalHeaderSize();
+    } else {
+        LOG(ERROR) << fmt::format("Autosave compaction failed: {}", newJournal.error());
+        journal = fopen(journalPath(dir).string().c_str(), "ab");
+        // The old journal, unless the new one has been renamed over it.
+        if (auto size = std::filesystem::file_size(journalPath(dir), ec); !ec) {
+            journalSize = size;
+        }
+    }
+}
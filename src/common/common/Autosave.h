@@ -0,0 +1,138 @@
+#pragma once
+
+#include "ProjectFile.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <unordered_set>
+
+// Crash recovery. Each running instance has its own directory in the base autosave directory, locked while it runs
+// (see LockedDir), so a second instance never takes the first one's files for a crashed session's. The directory holds
+// a snapshot (a project file) and a journal of the changes made since the snapshot, see startJournal. After each
+// message the App calls `commit`, which serializes the items of the document changed since the previous call. A
+// background thread appends them to the journal and fsyncs the file once per batch, and when the journal grows over
+// k_autosaveCompactionThreshold it writes a new snapshot with the journal applied and starts a new journal.
+//
+// The undo/redo closures recorded by the ReactiveStateEngine can't be serialized, the journal holds the values they
+// produced instead. The nodes' change timestamps tell which parts of the document changed, the changed sections,
+// tracks and clip links are found by comparing them with the copies journaled last. Clips are only ever added or
+// removed, an added clip is handed to the background thread sharing its audio (see AudioClip) and encoded there.
+//
+// The audio of each clip is written once, to a file of its own in the directory, and removed after the clip's removal
+// has been journaled. The snapshot and the journal hold the rest of the document, so compacting them doesn't read or
+// encode any audio. Recovering replays the clip files between the snapshot and the journal.
+//
+// A failed write is cut off the journal, since replayJournal stops at the first incomplete record, and retried with
+// the next batch or after k_autosaveRetryInterval. The `errorChanged` function passed to `make` is told when writing
+// starts failing and when it works again.
+//
+// Destroying the Autosave (a clean exit) deletes the files and the directory.
+class Autosave
+{
+public:
+    static constexpr size_t k_autosaveCompactionThreshold = size_t(64) << 20;
+    static constexpr auto k_autosaveRetryInterval = chr::seconds(5);
+
+    // Called on the worker thread with the error when writing the journal fails, with nullopt when it succeeds again.
+    using ErrorChangedFn = function<void(optional<string> error)>;
+
+    // An instance's directory, locked while this object lives so the other instances leave it alone. The OS releases
+    // the lock when the process exits, crashed or not, so an unlocked directory with files in it has been left behind by
+    // a crash.
+    class LockedDir
+    {
+    public:
+        // nullptr if another process holds the lock or the lock file can't be opened.
+        static unique_ptr<LockedDir> lock(std::filesystem::path dir);
+        ~LockedDir();
+
+        const std::filesystem::path& path() const
+        {
+            return dir;
+        }
+
+    private:
+        std::filesystem::path dir;
+        FILE* lockFile;
+
+        LockedDir(std::filesystem::path dirArg, FILE* lockFileArg);
+    };
+
+    // The base directory, holding the instances' directories.
+    static std::filesystem::path defaultDirectory();
+    // The directory in `baseDir` of an instance which exited without removing its files, locked, nullptr if there's
+    // none.
+    static unique_ptr<LockedDir> lockAbandonedDirectory(const std::filesystem::path& baseDir);
+    // Removes the files, then the directory.
+    static void removeDirectory(unique_ptr<LockedDir> toRemove);
+    // The snapshot with the clip files and the journal replayed.
+    static expected<Project, string> recover(const std::filesystem::path& dir);
+
+    // Starts a new journal with the current document, in a new directory in `baseDir`. The directory the document has
+    // been recovered from, if any, is removed once the document has been written to the new journal.
+    static expected<unique_ptr<Autosave>, string> make(
+      AppState& appState,
+      const std::filesystem::path& baseDir,
+      unique_ptr<LockedDir> recovered,
+      ErrorChangedFn errorChanged
+    );
+    ~Autosave();
+
+    void commit();
+
+private:
+    struct ClipToWrite {
+        Id<AudioClip> id;
+        AudioClip clip;
+    };
+    struct ClipRemoved {
+        Id<AudioClip> id;
+    };
+    // Serialized records, a clip to be encoded into its file on the worker thread, a clip whose removal is to be
+    // journaled and its file removed, or the directory of a recovered document to be removed once the items before it
+    // have been written.
+    using Item = variant<vector<char>, ClipToWrite, ClipRemoved, unique_ptr<LockedDir>>;
+
+    // The change timestamps of the nodes when they were journaled last.
+    struct JournaledTimestamps {
+        uint64_t metronome = 0, sections = 0, sectionOrder = 0, nextNewTrackId = 0;
+        uint64_t tracks = 0, trackOrder = 0, clipLinks = 0, clips = 0;
+    };
+
+    AppState& appState;
+    unique_ptr<LockedDir> lockedDir;
+    std::filesystem::path dir;
+    ErrorChangedFn errorChanged;
+    JournaledTimestamps journaledTimestamps;
+    SlotMap<Id<Section>, Section> journaledSections;
+    SlotMap<Id<Track>, Track> journaledTracks;
+    SlotMap<Id<ClipLink>, ClipLink> journaledClipLinks;
+    std::unordered_set<Id<AudioClip>> journaledClips;
+
+    // Shared with the worker thread.
+    std::mutex mutex;
+    std::condition_variable cv;
+    vector<Item> queue;
+    bool stopping = false;
+
+    // Owned by the worker thread.
+    FILE* journal = nullptr;
+    uintmax_t journalSize = 0; // Up to the end of the last complete record.
+    vector<Item> unwrittenItems; // Failed to be written, retried before the next ones.
+    vector<Id<AudioClip>> clipFilesToRemove; // Failed to be removed, compaction waits for them.
+    optional<string> writeError; // As last reported to `errorChanged`.
+    std::thread worker;
+
+    Autosave(
+      AppState& appStateArg, unique_ptr<LockedDir> lockedDirArg, FILE* journalArg, ErrorChangedFn errorChangedArg
+    );
+
+    void push(Item item);
+    void workerMain();
+    expected<void, string> writeBatch(vector<Item>& items);
+    expected<void, string> appendToJournal(const vector<char>& bytes);
+    void setWriteError(optional<string> error);
+    void compact();
+};
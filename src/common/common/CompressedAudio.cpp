@@ -0,0 +1,391 @@
+#include "CompressedAudio.h"
+
+#include "common.h"
+
+#include <bit>
+#include <cstring>
+
+bool decodeXorDelta(span<const char> in, span<float> samples)
+{
+    size_t pos = (samples.size() + 1) / 2;
+    if (in.size() < pos) {
+        return false;
+    }
+    uint32_t prev = 0;
+    for (size_t i : vi::iota(0u, samples.size())) {
+        const auto numBytes = size_t(uint8_t(in[i / 2]) >> (4 * (i % 2))) & 0xf;
+        if (numBytes > 4 || in.size() - pos < numBytes) {
+            return false;
+        }
+        uint32_t x = 0;
+        for (size_t b : vi::iota(0u, numBytes)) {
+            x |= uint32_t(uint8_t(in[pos++])) << (8 * b);
+        }
+        prev ^= x;
+        samples[i] = std::bit_cast<float>(prev);
+    }
+    return pos == in.size();
+}
+
+namespace
+{
+constexpr size_t k_ricePartitionSize = 1024;
+constexpr int k_riceParameterBits = 6;
+constexpr int k_maxRiceParameter = 40;
+// A quotient this large is written as this many zeros followed by the whole value in k_riceEscapeBits.
+constexpr int k_riceEscapeQuotient = 32;
+constexpr int k_riceEscapeBits = 40;
+constexpr int k_maxPredictorOrder = 3;
+
+enum class SampleMapping : uint8_t {
+    integers, // Integer multiples of a power of two, like the samples converted from 16 or 24-bit audio.
+    floatBits // The bits as an integer which grows with the value, for any other samples.
+};
+
+int64_t orderedFromFloatBits(uint32_t bits)
+{
+    return int64_t(bits & 0x80000000u ? ~bits : bits | 0x80000000u) - int64_t(0x80000000u);
+}
+
+uint32_t floatBitsFromOrdered(int64_t x)
+{
+    const auto u = uint32_t(x + int64_t(0x80000000u));
+    return u & 0x80000000u ? u & 0x7fffffffu : ~u;
+}
+
+// The exponent of the power of two the samples are all integer multiples of, if these integers fit in 31 bits and the
+// power of two is a normal float.
+optional<int> integerScaleExponent(span<const float> samples)
+{
+    int lowest = std::numeric_limits<int>::max();
+    int highest = std::numeric_limits<int>::min();
+    for (float x : samples) {
+        const auto bits = std::bit_cast<uint32_t>(x);
+        if (bits == 0) {
+            continue;
+        }
+        const auto biasedExponent = int(bits >> 23) & 0xff;
+        if (biasedExponent == 0 || biasedExponent == 0xff) {
+            return nullopt; // Negative zero, subnormal, infinite or NaN.
+        }
+        const auto mantissa = (bits & 0x7fffffu) | 0x800000u;
+        const auto exponent = biasedExponent - 150; // Of the mantissa's lowest bit.
+        lowest = std::min(lowest, exponent + std::countr_zero(mantissa));
+        highest = std::max(highest, exponent + 23);
+    }
+    if (lowest > highest) {
+        return 0; // Silence.
+    }
+    if (lowest < -126 || highest - lowest >= 31) {
+        return nullopt;
+    }
+    return lowest;
+}
+
+int64_t integerFromFloat(float x, int scaleExponent)
+{
+    const auto bits = std::bit_cast<uint32_t>(x);
+    if (bits == 0) {
+        return 0;
+    }
+    const auto shift = (int(bits >> 23) & 0xff) - 150 - scaleExponent;
+    const auto mantissa = int64_t((bits & 0x7fffffu) | 0x800000u);
+    const auto k = shift >= 0 ? mantissa << shift : mantissa >> -shift;
+    return bits & 0x80000000u ? -k : k;
+}
+
+// The fixed polynomial predictors of FLAC, from the previous samples.
+int64_t predict(int order, int64_t x1, int64_t x2, int64_t x3)
+{
+    switch (order) {
+    case 0:
+        return 0;
+    case 1:
+        return x1;
+    case 2:
+        return 2 * x1 - x2;
+    default:
+        return 3 * x1 - 3 * x2 + x3;
+    }
+}
+
+uint64_t zigzag(int64_t x)
+{
+    return x < 0 ? ~(uint64_t(x) << 1) : uint64_t(x) << 1;
+}
+
+int64_t unzigzag(uint64_t u)
+{
+    return u & 1 ? ~int64_t(u >> 1) : int64_t(u >> 1);
+}
+
+size_t riceCost(span<const uint64_t> residuals, int parameter)
+{
+    size_t bits = 0;
+    for (auto u : residuals) {
+        const auto q = u >> parameter;
+        bits += q < k_riceEscapeQuotient ? size_t(q) + 1 + size_t(parameter) : k_riceEscapeQuotient + k_riceEscapeBits;
+    }
+    return bits;
+}
+
+// Starting from the mean's number of bits, which is close to the best for the geometric distribution of residuals.
+int riceParameter(span<const uint64_t> residuals)
+{
+    uint64_t sum = 0;
+    for (auto u : residuals) {
+        sum += u;
+    }
+    const auto estimate = std::min(k_maxRiceParameter, std::max(0, int(std::bit_width(sum / residuals.size())) - 1));
+    auto best = estimate;
+    auto bestCost = riceCost(residuals, estimate);
+    for (int p : {estimate - 1, estimate + 1}) {
+        if (p < 0 || p > k_maxRiceParameter) {
+            continue;
+        }
+        if (auto cost = riceCost(residuals, p); cost < bestCost) {
+            best = p;
+            bestCost = cost;
+        }
+    }
+    return best;
+}
+
+// Least significant bit first.
+struct BitWriter {
+    vector<char>& out;
+    uint64_t buffer = 0;
+    int numBits = 0;
+
+    // At most 56 bits.
+    void write(uint64_t x, int n)
+    {
+        buffer |= x << numBits;
+        numBits += n;
+        while (numBits >= 8) {
+            out.push_back(char(uint8_t(buffer)));
+            buffer >>= 8;
+            numBits -= 8;
+        }
+    }
+    void flush()
+    {
+        if (numBits > 0) {
+            out.push_back(char(uint8_t(buffer)));
+        }
+        buffer = 0;
+        numBits = 0;
+    }
+};
+
+// Reading past the end sets `failed` and returns zeros.
+struct BitReader {
+    span<const char> in;
+    size_t pos = 0;
+    uint64_t buffer = 0;
+    int numBits = 0;
+    bool failed = false;
+
+    void refill()
+    {
+        while (numBits <= 56 && pos < in.size()) {
+            buffer |= uint64_t(uint8_t(in[pos++])) << numBits;
+            numBits += 8;
+        }
+    }
+    // At most 56 bits.
+    uint64_t read(int n)
+    {
+        refill();
+        if (numBits < n) {
+            failed = true;
+            return 0;
+        }
+        const auto x = buffer & ((uint64_t(1) << n) - 1);
+        buffer >>= n;
+        numBits -= n;
+        return x;
+    }
+    uint64_t readRice(int parameter)
+    {
+        refill();
+        const auto q = std::countr_zero(buffer);
+        if (q >= k_riceEscapeQuotient) {
+            read(k_riceEscapeQuotient);
+            return read(k_riceEscapeBits);
+        }
+        if (q >= numBits) {
+            failed = true;
+            return 0;
+        }
+        buffer >>= q + 1;
+        numBits -= q + 1;
+        return (uint64_t(q) << parameter) | read(parameter);
+    }
+};
+} // namespace
+
+void encodePredictiveRice(span<const float> samples, vector<char>& out)
+{
+    const auto scaleExponent = integerScaleExponent(samples);
+    vector<int64_t> values(samples.size());
+    for (size_t i : vi::iota(0u, samples.size())) {
+        values[i] = scaleExponent ? integerFromFloat(samples[i], *scaleExponent)
+                                  : orderedFromFloatBits(std::bit_cast<uint32_t>(samples[i]));
+    }
+
+    // The order with the smallest residuals, the samples before the block are taken as zeros.
+    array<uint64_t, k_maxPredictorOrder + 1> sums{};
+    int64_t x1 = 0, x2 = 0, x3 = 0;
+    for (auto x : values) {
+        for (int order : vi::iota(0, k_maxPredictorOrder + 1)) {
+            sums[size_t(order)] += zigzag(x - predict(order, x1, x2, x3));
+        }
+        x3 = x2;
+        x2 = x1;
+        x1 = x;
+    }
+    const auto order = int(ra::min_element(sums) - sums.begin());
+    vector<uint64_t> residuals(values.size());
+    x1 = x2 = x3 = 0;
+    for (size_t i : vi::iota(0u, values.size())) {
+        residuals[i] = zigzag(values[i] - predict(order, x1, x2, x3));
+        x3 = x2;
+        x2 = x1;
+        x1 = values[i];
+    }
+
+    out.clear();
+    out.push_back(char(scaleExponent ? SampleMapping::integers : SampleMapping::floatBits));
+    out.push_back(char(int8_t(scaleExponent.value_or(0))));
+    out.push_back(char(order));
+    BitWriter w{.out = out};
+    for (size_t begin = 0; begin < residuals.size(); begin += k_ricePartitionSize) {
+        const auto partition = span(residuals).subspan(begin, std::min(k_ricePartitionSize, residuals.size() - begin));
+        const auto parameter = riceParameter(partition);
+        w.write(uint64_t(parameter), k_riceParameterBits);
+        for (auto u : partition) {
+            const auto q = u >> parameter;
+            if (q < k_riceEscapeQuotient) {
+                w.write(uint64_t(1) << q, int(q) + 1);
+                w.write(u & ((uint64_t(1) << parameter) - 1), parameter);
+            } else {
+                w.write(0, k_riceEscapeQuotient);
+                w.write(u, k_riceEscapeBits);
+            }
+        }
+    }
+    w.flush();
+}
+
+bool decodePredictiveRice(span<const char> in, span<float> samples)
+{
+    if (in.size() < 3) {
+        return false;
+    }
+    const auto mapping = SampleMapping(in[0]);
+    const auto scaleExponent = int(int8_t(in[1]));
+    const auto order = int(in[2]);
+    if ((mapping != SampleMapping::integers && mapping != SampleMapping::floatBits) || scaleExponent < -126
+        || order < 0 || order > k_maxPredictorOrder) {
+        return false;
+    }
+    // Exact, the integers have at most 24 significant bits.
+    const auto scale = std::bit_cast<float>(uint32_t(scaleExponent + 127) << 23);
+    BitReader r{.in = in.subspan(3)};
+    int64_t x1 = 0, x2 = 0, x3 = 0;
+    int parameter = 0;
+    for (size_t i : vi::iota(0u, samples.size())) {
+        if (i % k_ricePartitionSize == 0) {
+            parameter = int(r.read(k_riceParameterBits));
+            if (parameter > k_maxRiceParameter) {
+                return false;
+            }
+        }
+        const auto x = predict(order, x1, x2, x3) + unzigzag(r.readRice(parameter));
+        if (r.failed || x < -int64_t(0x80000000u) || x >= int64_t(0x80000000u)) {
+            return false;
+        }
+        samples[i] = mapping == SampleMapping::integers ? float(x) * scale
+                                                          : std::bit_cast<float>(floatBitsFromOrdered(x));
+        x3 = x2;
+        x2 = x1;
+        x1 = x;
+    }
+    return r.pos == r.in.size() && r.numBits < 8;
+}
+
+CompressedAudio CompressedAudio::compress(span<const deque<float>> channels)
+{
+    CompressedAudio r{
+      .numFrames = channels.empty() ? 0 : channels[0].size(), .numChannels = channels.size(), .blocks = {}
+    };
+    vector<float> samples;
+    for (size_t chunkBegin = 0; chunkBegin < r.numFrames; chunkBegin += k_compressedAudioChunkSize) {
+        const auto n = std::min(k_compressedAudioChunkSize, r.numFrames - chunkBegin);
+        for (auto& channel : channels) {
+            CHECK(channel.size() == r.numFrames);
+            auto it = channel.begin() + ptrdiff_t(chunkBegin);
+            samples.assign(it, it + ptrdiff_t(n));
+            r.blocks.push_back(compressBlock(samples));
+        }
+    }
+    return r;
+}
+
+CompressedAudio::Block CompressedAudio::compressBlock(span<const float> samples)
+{
+    Block block{.codec = AudioCodec::predictiveRice, .bytes = {}};
+    encodePredictiveRice(samples, block.bytes);
+    if (block.bytes.size() >= samples.size_bytes()) {
+        block.codec = AudioCodec::raw;
+        block.bytes.resize(samples.size_bytes());
+        std::memcpy(block.bytes.data(), samples.data(), block.bytes.size());
+    }
+    block.bytes.shrink_to_fit();
+    return block;
+}
+
+vector<deque<float>> CompressedAudio::decompress() const
+{
+    vector<deque<float>> channels(numChannels);
+    vector<float> samples;
+    for (size_t chunkIx : vi::iota(0u, numChunks())) {
+        samples.resize(chunkSize(chunkIx));
+        for (size_t c : vi::iota(0u, numChannels)) {
+            decompressBlock(chunkIx, c, samples);
+            channels[c].insert(channels[c].end(), samples.begin(), samples.end());
+        }
+    }
+    return channels;
+}
+
+void CompressedAudio::decompressBlock(size_t chunkIx, size_t channel, span<float> samples) const
+{
+    const auto blockIx = chunkIx * numChannels + channel;
+    CHECK(channel < numChannels && blockIx < blocks.size());
+    const auto n = chunkSize(chunkIx);
+    CHECK(n <= samples.size());
+    auto& block = blocks[blockIx];
+    switch (block.codec) {
+    case AudioCodec::raw:
+        CHECK(block.bytes.size() == n * sizeof(float));
+        std::memcpy(samples.data(), block.bytes.data(), block.bytes.size());
+        break;
+    case AudioCodec::xorDelta:
+        CHECK(decodeXorDelta(block.bytes, samples.first(n)));
+        break;
+    case AudioCodec::predictiveRice:
+        CHECK(decodePredictiveRice(block.bytes, samples.first(n)));
+        break;
+    }
+}
+
+size_t CompressedAudio::memoryUsage() const
+{
+    size_t r = sizeof(*this) + blocks.capacity() * sizeof(Block);
+    for (auto& b : blocks) {
+        r += b.bytes.capacity();
+    }
+    return r;
+}
@@ -0,0 +1,159 @@
+#include "FrameProfiler.h"
+
+#include "common.h"
+
+namespace
+{
+constexpr array<string_view, FrameProfiler::k_numStages> k_stageNames =
+  {"pollEvents", "dispatchMessages", "rseUpdate", "imguiBuild", "glSubmit", "swap"};
+
+double toUs(FrameProfiler::Clock::duration d)
+{
+    return chr::duration<double, std::micro>(d).count();
+}
+} // namespace
+
+string_view FrameProfiler::stageName(Stage s)
+{
+    return k_stageNames[size_t(s)];
+}
+
+FrameProfiler::Clock::duration FrameProfiler::Frame::total() const
+{
+    auto d = Clock::duration::zero();
+    for (auto sd : stageDurations) {
+        d += sd;
+    }
+    return d;
+}
+
+void FrameProfiler::beginFrame()
+{
+    lastStageEnd = Clock::now();
+    currentFrame = Frame{.start = lastStageEnd, .stageDurations = {}};
+}
+
+void FrameProfiler::endStage(Stage s)
+{
+    auto now = Clock::now();
+    currentFrame.stageDurations[size_t(s)] += now - lastStageEnd;
+    lastStageEnd = now;
+}
+
+void FrameProfiler::endFrame()
+{
+    auto& slot = frames[numFramesEnded % k_numFramesKept];
+    if (numFramesEnded >= k_numFramesKept) {
+        for (size_t i : vi::iota(0u, k_numStages)) {
+            histograms[i].remove(slot.stageDurations[i]);
+        }
+        histograms.back().remove(slot.total());
+    }
+    slot = currentFrame;
+    for (size_t i : vi::iota(0u, k_numStages)) {
+        histograms[i].add(slot.stageDurations[i]);
+    }
+    histograms.back().add(slot.total());
+    ++numFramesEnded;
+}
+
+size_t FrameProfiler::numFrames() const
+{
+    return std::min(numFramesEnded, k_numFramesKept);
+}
+
+const FrameProfiler::Frame& FrameProfiler::frameFromOldest(size_t i) const
+{
+    return frames[(numFramesEnded - numFrames() + i) % k_numFramesKept];
+}
+
+FrameProfiler::Percentiles FrameProfiler::percentiles(optional<Stage> stage) const
+{
+    auto& h = histograms[stage ? size_t(*stage) : k_numStages];
+    auto n = numFrames();
+    return Percentiles{.p50 = h.percentile(0.5, n), .p95 = h.percentile(0.95, n), .p99 = h.percentile(0.99, n)};
+}
+
+double FrameProfiler::averageFrameRate() const
+{
+    auto n = numFrames();
+    if (n < 2) {
+        return NAN;
+    }
+    auto dt = chr::duration<double>(frameFromOldest(n - 1).start - frameFromOldest(0).start).count();
+    return dt > 0 ? double(n - 1) / dt : NAN;
+}
+
+string FrameProfiler::chromeTraceJson() const
+{
+    auto n = numFrames();
+    if (n == 0) {
+        return "{\"traceEvents\":[]}\n";
+    }
+    auto t0 = frameFromOldest(0).start;
+    string s = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto addEvent = [&](string_view name, Clock::time_point start, Clock::duration d) {
+        s += fmt::format(
+          "{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":{:.3f},\"dur\":{:.3f}}}",
+          first ? "" : ",\n",
+          name,
+          toUs(start - t0),
+          toUs(d)
+        );
+        first = false;
+    };
+    for (size_t i : vi::iota(0u, n)) {
+        auto& f = frameFromOldest(i);
+        addEvent("frame", f.start, f.total());
+        auto t = f.start;
+        for (size_t j : vi::iota(0u, k_numStages)) {
+            addEvent(k_stageNames[j], t, f.stageDurations[j]);
+            t += f.stageDurations[j];
+        }
+    }
+    s += "\n]}\n";
+    return s;
+}
+
+namespace
+{
+size_t bucketOf(FrameProfiler::Clock::duration d, size_t bucketsPerOctave, size_t numBuckets)
+{
+    auto us = toUs(d);
+    if (us < 1) {
+        return 0;
+    }
+    return std::min(numBuckets - 1, size_t(std::log2(us) * double(bucketsPerOctave)));
+}
+} // namespace
+
+void FrameProfiler::Histogram::add(Clock::duration d)
+{
+    ++counts[bucketOf(d, k_bucketsPerOctave, k_numBuckets)];
+}
+
+void FrameProfiler::Histogram::remove(Clock::duration d)
+{
+    auto& c = counts[bucketOf(d, k_bucketsPerOctave, k_numBuckets)];
+    CHECK(c > 0);
+    --c;
+}
+
+FrameProfiler::Clock::duration FrameProfiler::Histogram::percentile(double p, size_t total) const
+{
+    if (total == 0) {
+        return Clock::duration::zero();
+    }
+    // The smallest bucket for which at least p of the samples are not greater.
+    auto rank = size_t(std::ceil(p * double(total)));
+    size_t cumulative = 0;
+    for (size_t i : vi::iota(0u, k_numBuckets)) {
+        cumulative += counts[i];
+        if (cumulative >= rank) {
+            auto upperBoundUs = std::exp2(double(i + 1) / double(k_bucketsPerOctave));
+            return chr::duration_cast<Clock::duration>(chr::duration<double, std::micro>(upperBoundUs));
+        }
+    }
+    return Clock::duration::max();
+}
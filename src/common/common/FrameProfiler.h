@@ -0,0 +1,73 @@
+#pragma once
+
+#include "std.h"
+
+// Stage timings of the UI frames rendered by the main loop.
+//
+// The last k_numFramesKept frames are kept in a ring buffer, for exporting them as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev), and in log-scale histograms, one for each stage and one for the whole frame,
+// for rolling percentiles. Memory use is fixed.
+//
+// Usage: `beginFrame` at the start of a main loop iteration, `endStage` after each stage, `endFrame` if the iteration
+// has rendered a frame. Iterations without `endFrame` are discarded.
+class FrameProfiler
+{
+public:
+    using Clock = chr::steady_clock;
+
+    enum class Stage {
+        pollEvents,
+        dispatchMessages,
+        rseUpdate,
+        imguiBuild,
+        glSubmit,
+        swap
+    };
+    static constexpr size_t k_numStages = 6;
+    static constexpr size_t k_numFramesKept = 1024;
+
+    static string_view stageName(Stage s);
+
+    struct Frame {
+        Clock::time_point start;
+        array<Clock::duration, k_numStages> stageDurations{};
+
+        Clock::duration total() const;
+    };
+    struct Percentiles {
+        Clock::duration p50, p95, p99;
+    };
+
+    void beginFrame();
+    // Adds the time since the previous `endStage` or `beginFrame` to the stage.
+    void endStage(Stage s);
+    void endFrame();
+
+    size_t numFrames() const;
+    // Over the kept frames, the whole frame if `stage` is nullopt. The results are the upper bounds of histogram
+    // buckets, accurate to about 9%.
+    Percentiles percentiles(optional<Stage> stage) const;
+    // Frames per second over the kept frames.
+    double averageFrameRate() const;
+    string chromeTraceJson() const;
+
+private:
+    // Buckets of 1/8 octave starting at 1 us, the last one is open.
+    static constexpr size_t k_bucketsPerOctave = 8;
+    static constexpr size_t k_numBuckets = 24 * k_bucketsPerOctave;
+
+    struct Histogram {
+        array<uint16_t, k_numBuckets> counts{};
+        void add(Clock::duration d);
+        void remove(Clock::duration d);
+        Clock::duration percentile(double p, size_t total) const;
+    };
+
+    array<Frame, k_numFramesKept> frames;
+    size_t numFramesEnded = 0; // The next frame goes to `frames[numFramesEnded % k_numFramesKept]`.
+    Frame currentFrame;
+    Clock::time_point lastStageEnd;
+    array<Histogram, k_numStages + 1> histograms; // The last one is for the whole frame.
+
+    const Frame& frameFromOldest(size_t i) const;
+};
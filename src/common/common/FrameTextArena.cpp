@@ -0,0 +1,22 @@
+#include "FrameTextArena.h"
+
+char* FrameTextArena::allocateChunk(size_t minSize)
+{
+    chunks.emplace_back(std::max(minSize, 2 * chunks.back().size()));
+    used = 0;
+    return chunks.back().data();
+}
+
+void FrameTextArena::reset()
+{
+    if (chunks.size() > 1) {
+        // Replace all chunks with a single one which would have been large enough for the whole frame.
+        size_t totalSize = 0;
+        for (auto& c : chunks) {
+            totalSize += c.size();
+        }
+        chunks.clear();
+        chunks.emplace_back(totalSize);
+    }
+    used = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "std.h"
+
+#include "fmt/format.h"
+
+// Bump allocator for text needed only while a frame is being built, like "Playing 1.5 seconds". The strings stay valid
+// until the next `reset`, which reuses the memory, so in the steady state formatting doesn't allocate.
+//
+// Text derived from the state doesn't belong here, it should be formatted once by an rse::Computed node.
+class FrameTextArena
+{
+public:
+    // Returns a null-terminated string.
+    template<class... Args>
+    const char* format(fmt::format_string<Args...> f, Args&&... args)
+    {
+        auto* begin = chunks.back().data() + used;
+        const size_t available = chunks.back().size() - used;
+        auto r = fmt::format_to_n(begin, available, f, std::forward<Args>(args)...);
+        if (r.size >= available) {
+            begin = allocateChunk(r.size + 1);
+            fmt::format_to(begin, f, std::forward<Args>(args)...);
+        }
+        begin[r.size] = '\0';
+        used += r.size + 1;
+        return begin;
+    }
+
+    // Invalidates all strings returned since the previous `reset`.
+    void reset();
+
+private:
+    static constexpr size_t k_initialSize = 4096;
+
+    // Only the last chunk is being filled, the ones before it are merged into it at the next `reset`.
+    vector<vector<char>> chunks = {vector<char>(k_initialSize)};
+    size_t used = 0; // In the last chunk.
+
+    char* allocateChunk(size_t minSize);
+};
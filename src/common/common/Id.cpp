@@ -2,16 +2,25 @@
 
 #include "common.h"
 
-#include "boost/uuid/time_generator_v7.hpp"
+#include <random>
 
-uint64_t getNextUniqueU64()
+uint64_t idSessionPrefix()
+{
+    static const uint64_t prefix = [] {
+        std::random_device rd;
+        std::uniform_int_distribution<uint64_t> d(1, (uint64_t(1) << k_idSessionBits) - 1);
+        return d(rd) << (64 - k_idSessionBits);
+    }();
+    return prefix;
+}
+
+bool isIdCreationThread()
 {
-    static boost::uuids::time_generator_v7 g;
     static auto expectedThreadId = this_thread::get_id();
-    CHECK(this_thread::get_id() == expectedThreadId);
-    const auto uuid = g();
-    pair<uint64_t, uint64_t> u64pair;
-    static_assert(sizeof(u64pair) == 16);
-    std::copy(uuid.begin(), uuid.end(), reinterpret_cast<uint8_t*>(&u64pair));
-    return u64pair.first ^ u64pair.second ^ std::hash<std::thread::id>{}(expectedThreadId);
+    return this_thread::get_id() == expectedThreadId;
+}
+
+void failOutOfIds(uint64_t nextIndex, size_t n)
+{
+    LOG(FATAL) << fmt::format("Out of ids, next index: {}, requested: {}", nextIndex, n);
 }
@@ -1,18 +1,46 @@
 #pragma once
 
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <ranges>
 #include <vector> // for std::hash
 
+// The high k_idSessionBits bits of an id are a random prefix chosen at startup, the low bits an index allocated
+// monotonically for each Id type, from 0. The indices of the ids made in a session are dense so they can index
+// arrays. Ids loaded from a project have the prefix of the session they were made in, `noteExisting` makes sure new ids
+// don't collide with them even if the prefixes happen to match.
+//
 // Creation is single-threaded (main thread).
 
-uint64_t getNextUniqueU64();
+constexpr int k_idSessionBits = 24;
+constexpr uint64_t k_idIndexMask = (uint64_t(1) << (64 - k_idSessionBits)) - 1;
+
+// Nonzero, in the high bits.
+uint64_t idSessionPrefix();
+bool isIdCreationThread();
+void failOutOfIds(uint64_t nextIndex, size_t n);
 
 template<class T>
 struct Id {
     inline static Id make()
     {
-        return Id(getNextUniqueU64());
+        return Id(allocate(1));
+    }
+    // `n` consecutive ids with a single allocation, a random access range.
+    static auto makeN(size_t n)
+    {
+        const auto first = allocate(n);
+        return std::views::iota(first, first + n) | std::views::transform([](uint64_t v) {
+                   return Id(v);
+               });
+    }
+    // Call for the ids which haven't been made in this session, e.g. the ones loaded from a project.
+    static void noteExisting(Id id)
+    {
+        if ((id.v & ~k_idIndexMask) == idSessionPrefix() && (id.v & k_idIndexMask) >= nextIndex) {
+            nextIndex = (id.v & k_idIndexMask) + 1;
+        }
     }
 
     using type = T;
@@ -25,12 +53,42 @@ struct Id {
     {
     }
     bool operator==(const Id&) const = default;
+
+    bool isFromThisSession() const
+    {
+        return (v & ~k_idIndexMask) == idSessionPrefix();
+    }
+    // Dense for the ids of this session.
+    size_t index() const
+    {
+        return size_t(v & k_idIndexMask);
+    }
+
+private:
+    inline static uint64_t nextIndex = 0;
+
+    static uint64_t allocate(size_t n)
+    {
+        assert(isIdCreationThread());
+        if (n > k_idIndexMask - nextIndex) [[unlikely]] {
+            failOutOfIds(nextIndex, n);
+        }
+        const auto first = idSessionPrefix() | nextIndex;
+        nextIndex += n;
+        return first;
+    }
 };
 
+// The ids of a session differ only in the low bits, these are mixed into all bits (half of MurmurHash3's finalizer)
+// so hash tables using the high bits of the hash get a good distribution, too.
 template<class T>
 struct std::hash<Id<T>> {
     std::size_t operator()(const Id<T>& x) const noexcept
     {
-        return std::hash<uint64_t>{}(x.v);
+        auto h = x.v;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdu;
+        h ^= h >> 33;
+        return std::size_t(h);
     }
 };
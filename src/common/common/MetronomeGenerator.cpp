@@ -14,17 +14,37 @@ constexpr double f6 = 1484.75;
 constexpr double f7 = 573.69;
 } // namespace
 
-void MetronomeGenerator::generate(double fs, double bpm, span<float> buf)
+void MetronomeGenerator::reset()
 {
-    double beatInSec = 60.0 / bpm;
-    double secPerSample = 1.0 / fs;
+    *this = MetronomeGenerator{};
+}
+
+void MetronomeGenerator::generate(int64_t sampleRateArg, const Rational& tempoArg, Ticks beatArg, span<float> buf)
+{
+    if (sampleRateArg != sampleRate || tempoArg != tempo || beatArg != beat) {
+        sample -= beatStartSample;
+        sampleRate = sampleRateArg;
+        tempo = tempoArg;
+        beat = beatArg;
+        samplesPerTick = Ticks::samplesPerTick(tempo, sampleRate);
+        beatIx = 0;
+        beatStartSample = 0;
+        nextBeatStartSample = beat.toSamples(samplesPerTick);
+    }
+    const double secPerSample = 1.0 / double(sampleRate);
     for (size_t i : vi::iota(0u, buf.size())) {
+        while (sample >= nextBeatStartSample) {
+            beatStartSample = nextBeatStartSample;
+            ++beatIx;
+            nextBeatStartSample = (beat * (beatIx + 1)).toSamples(samplesPerTick);
+        }
+        const double timeSinceLastStart = double(sample - beatStartSample) * secPerSample;
         double envelope = exp(-timeSinceLastStart * lambda);
         double _2pit = 2.0 * std::numbers::pi * timeSinceLastStart;
         buf[i] = float(tanh(
           volume * envelope
           * (cos(_2pit * f1) + cos(_2pit * f2) + cos(_2pit * f3) + cos(_2pit * f4) + cos(_2pit * f5) + cos(_2pit * f6) + cos(_2pit * f7))
         ));
-        timeSinceLastStart = fmod(timeSinceLastStart + secPerSample, beatInSec);
+        ++sample;
     }
 }
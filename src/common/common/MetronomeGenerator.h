@@ -1,9 +1,23 @@
 #pragma once
 
+#include "Ticks.h"
 #include "std.h"
 
+// Clicks on the beats of a constant tempo. Beat n starts at the first sample at or after n * beat (see Ticks), so the
+// beats don't drift from the exact tempo however long it runs. A tempo change keeps the time since the last click.
 struct MetronomeGenerator {
-    double timeSinceLastStart = 0;
+    // The next `generate` starts with a click.
+    void reset();
+    // `tempo` is in whole notes per minute, `beat` is the length of a beat, e.g. a quarter note.
+    void generate(int64_t sampleRate, const Rational& tempo, Ticks beat, span<float> buf);
 
-    void generate(double fs, double bpm, span<float> buf);
+private:
+    int64_t sampleRate = 0;
+    Rational tempo;
+    Ticks beat;
+    Rational samplesPerTick;
+    // Counted from the start of the first beat since the last reset or tempo change.
+    int64_t sample = 0;
+    int64_t beatIx = 0;
+    int64_t beatStartSample = 0, nextBeatStartSample = 0;
 };
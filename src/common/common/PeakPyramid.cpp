@@ -0,0 +1,127 @@
+#include "PeakPyramid.h"
+
+#include "common.h"
+
+namespace
+{
+PeakPyramid::Peak mergeEqualSized(const PeakPyramid::Peak& x, const PeakPyramid::Peak& y)
+{
+    return PeakPyramid::Peak{
+      .min = std::min(x.min, y.min), .max = std::max(x.max, y.max), .meanSquare = (x.meanSquare + y.meanSquare) / 2
+    };
+}
+
+// Accumulates entries of different sizes into a single Peak.
+struct PeakAccumulator {
+    float min = INFINITY;
+    float max = -INFINITY;
+    double sumSquares = 0;
+    size_t count = 0;
+
+    void add(const PeakPyramid::Peak& p, size_t numSamples)
+    {
+        min = std::min(min, p.min);
+        max = std::max(max, p.max);
+        sumSquares += double(p.meanSquare) * double(numSamples);
+        count += numSamples;
+    }
+    PeakPyramid::Peak peak() const
+    {
+        if (count == 0) {
+            return PeakPyramid::Peak{};
+        }
+        return PeakPyramid::Peak{.min = min, .max = max, .meanSquare = float(sumSquares / double(count))};
+    }
+};
+} // namespace
+
+PeakPyramid::Peak PeakPyramid::summarize(span<const float> samples)
+{
+    if (samples.empty()) {
+        return Peak{};
+    }
+    Peak p{.min = samples[0], .max = samples[0], .meanSquare = 0};
+    for (float x : samples) {
+        p.min = std::min(p.min, x);
+        p.max = std::max(p.max, x);
+        p.meanSquare += x * x;
+    }
+    p.meanSquare /= float(samples.size());
+    return p;
+}
+
+PeakPyramid::Peak PeakPyramid::merge(const Peak& x, size_t xNumSamples, const Peak& y, size_t yNumSamples)
+{
+    PeakAccumulator acc;
+    acc.add(x, xNumSamples);
+    acc.add(y, yNumSamples);
+    return acc.peak();
+}
+
+void PeakPyramid::append(span<const float> samples)
+{
+    for (float x : samples) {
+        if (pendingCount == 0) {
+            pending = Peak{.min = x, .max = x, .meanSquare = 0};
+        } else {
+            pending.min = std::min(pending.min, x);
+            pending.max = std::max(pending.max, x);
+        }
+        // meanSquare holds the sum of squares until the block is complete.
+        pending.meanSquare += x * x;
+        if (++pendingCount == k_level0BlockSize) {
+            pending.meanSquare /= float(k_level0BlockSize);
+            pushLevel0Entry(pending);
+            pendingCount = 0;
+        }
+    }
+}
+
+void PeakPyramid::pushLevel0Entry(Peak p)
+{
+    for (size_t level = 0;; ++level) {
+        if (levels.size() <= level) {
+            levels.emplace_back();
+        }
+        auto& l = levels[level];
+        l.push_back(p);
+        if (l.size() % 2 != 0) {
+            break;
+        }
+        p = mergeEqualSized(l[l.size() - 2], l.back());
+    }
+}
+
+void PeakPyramid::query(size_t sampleBegin, size_t sampleEnd, span<Peak> pixels) const
+{
+    if (pixels.empty()) {
+        return;
+    }
+    const size_t numCompleteBlocks = levels.empty() ? 0 : levels[0].size();
+    const size_t numBlocks = numCompleteBlocks + (pendingCount > 0 ? 1 : 0);
+    const double samplesPerPixel = double(sampleEnd - sampleBegin) / double(pixels.size());
+    for (size_t px : vi::iota(0u, pixels.size())) {
+        auto s0 = sampleBegin + size_t(double(px) * samplesPerPixel);
+        auto s1 = std::max(s0 + 1, sampleBegin + size_t(double(px + 1) * samplesPerPixel));
+        auto b0 = s0 / k_level0BlockSize;
+        auto b1 = std::min(numBlocks, (s1 + k_level0BlockSize - 1) / k_level0BlockSize);
+        PeakAccumulator acc;
+        // Cover [b0, b1) with the largest aligned entries available, like a segment tree query.
+        for (size_t b = b0; b < b1;) {
+            if (b == numCompleteBlocks) {
+                auto p = pending;
+                p.meanSquare /= float(pendingCount);
+                acc.add(p, pendingCount);
+                break;
+            }
+            size_t level = 0;
+            while (level + 1 < levels.size() && b % (size_t(2) << level) == 0 && b + (size_t(2) << level) <= b1
+                   && (b >> (level + 1)) < levels[level + 1].size()) {
+                ++level;
+            }
+            acc.add(levels[level][b >> level], k_level0BlockSize << level);
+            b += size_t(1) << level;
+        }
+        pixels[px] = acc.peak();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "std.h"
+
+// Min/max/RMS summary of a single channel for drawing waveforms at any zoom level in time proportional to the number
+// of pixels instead of the number of samples.
+//
+// Level 0 has an entry for every k_level0BlockSize samples, each further level merges pairs of entries of the level
+// below. It's built incrementally as samples are appended, the samples of the last, incomplete level 0 block are kept
+// in a pending entry.
+class PeakPyramid
+{
+public:
+    static constexpr size_t k_level0BlockSize = 64;
+
+    struct Peak {
+        float min = 0;
+        float max = 0;
+        float meanSquare = 0;
+        bool operator==(const Peak&) const = default;
+    };
+
+    void append(span<const float> samples);
+
+    size_t numSamples() const
+    {
+        return levels.empty() ? pendingCount : levels[0].size() * k_level0BlockSize + pendingCount;
+    }
+
+    // Summarize [sampleBegin, sampleEnd) split evenly into `pixels.size()` ranges. The ranges are extended to level 0
+    // block boundaries so this is only exact if there are at least k_level0BlockSize samples per pixel.
+    void query(size_t sampleBegin, size_t sampleEnd, span<Peak> pixels) const;
+
+    bool operator==(const PeakPyramid&) const = default;
+
+    // Summary of all the samples as a single Peak.
+    static Peak summarize(span<const float> samples);
+    // Summary of two Peaks of the given number of samples.
+    static Peak merge(const Peak& x, size_t xNumSamples, const Peak& y, size_t yNumSamples);
+
+private:
+    vector<vector<Peak>> levels;
+    Peak pending;
+    size_t pendingCount = 0;
+
+    void pushLevel0Entry(Peak p);
+};
@@ -0,0 +1,1040 @@
+#include "ProjectFile.h"
+
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+constexpr array<char, 4> k_fileMagic = {'D', 'T', 'P', 'J'};
+constexpr uint32_t k_fileVersion = 1;
+constexpr size_t k_trailerSize = 2 * sizeof(uint64_t) + k_fileMagic.size();
+
+enum class ClipStorage : uint8_t {
+    external,
+    embedded
+};
+
+// The metadata is serialized into memory, then written at once.
+struct ByteWriter {
+    vector<char> bytes;
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    void pod(const T& x)
+    {
+        auto* p = reinterpret_cast<const char*>(&x);
+        bytes.insert(bytes.end(), p, p + sizeof(T));
+    }
+    void str(string_view s)
+    {
+        pod(intCast<uint64_t>(s.size()));
+        bytes.insert(bytes.end(), s.begin(), s.end());
+    }
+    void rational(const Rational& r)
+    {
+        pod(r.numerator());
+        pod(r.denominator());
+    }
+    template<class T>
+    void id(Id<T> x)
+    {
+        pod(x.v);
+    }
+    // Same as std::ostream::write, for writeEmbeddedAudio.
+    void write(const char* p, std::streamsize n)
+    {
+        bytes.insert(bytes.end(), p, p + n);
+    }
+};
+
+// Reading past the end or reading invalid values sets `failed` and returns default values, so the parser can be
+// written without checking each read.
+struct ByteReader {
+    span<const char> bytes;
+    size_t pos = 0;
+    bool failed = false;
+
+    template<class T>
+        requires std::is_trivially_copyable_v<T>
+    T pod()
+    {
+        T x{};
+        if (bytes.size() - pos < sizeof(T)) {
+            failed = true;
+            return x;
+        }
+        std::memcpy(&x, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return x;
+    }
+    string str()
+    {
+        const auto size = pod<uint64_t>();
+        if (bytes.size() - pos < size) {
+            failed = true;
+            return {};
+        }
+        string s(bytes.data() + pos, size_t(size));
+        pos += size_t(size);
+        return s;
+    }
+    Rational rational()
+    {
+        const auto numerator = pod<int64_t>();
+        const auto denominator = pod<int64_t>();
+        if (denominator <= 0) {
+            failed = true;
+            return Rational(0);
+        }
+        return Rational(numerator, denominator);
+    }
+    template<class T>
+    Id<T> id()
+    {
+        return Id<T>(pod<uint64_t>());
+    }
+    // Number of items of a container, with a sanity check so a corrupt size doesn't trigger a huge allocation.
+    size_t count(size_t minItemSize)
+    {
+        const auto n = pod<uint64_t>();
+        if (n > (bytes.size() - pos) / minItemSize) {
+            failed = true;
+            return 0;
+        }
+        return size_t(n);
+    }
+    template<class E>
+    E enumValue(E maxValue)
+    {
+        const auto x = pod<uint8_t>();
+        if (x > uint8_t(maxValue)) {
+            failed = true;
+            return E{};
+        }
+        return E(x);
+    }
+    // Same as std::istream::read and operator bool, for readEmbeddedAudio.
+    void read(char* p, std::streamsize n)
+    {
+        if (failed || bytes.size() - pos < size_t(n)) {
+            failed = true;
+            return;
+        }
+        std::memcpy(p, bytes.data() + pos, size_t(n));
+        pos += size_t(n);
+    }
+    explicit operator bool() const
+    {
+        return !failed;
+    }
+};
+
+void writeClipLink(ByteWriter& w, const ClipLink& cl)
+{
+    w.id(cl.sectionId);
+    w.id(cl.audioClipId);
+    w.pod(uint8_t(cl.timeUnit));
+    w.rational(cl.clipOriginToSectionStart);
+}
+
+ClipLink readClipLink(ByteReader& r)
+{
+    auto sectionId = r.id<Section>();
+    auto audioClipId = r.id<AudioClip>();
+    auto timeUnit = r.enumValue(TimeUnit::seconds);
+    return ClipLink{
+      .sectionId = sectionId,
+      .audioClipId = audioClipId,
+      .timeUnit = timeUnit,
+      .clipOriginToSectionStart = r.rational()
+    };
+}
+
+void writeSection(ByteWriter& w, const Section& s)
+{
+    w.str(s.name);
+    w.pod(uint8_t(s.tempo.has_value()));
+    w.rational(s.tempo.value_or(Rational(0)));
+    w.pod(uint8_t(s.structure.index()));
+    switch_variant(
+      s.structure,
+      [&](const Bars& x) {
+          w.pod(intCast<uint64_t>(x.bars.size()));
+          for (auto& b : x.bars) {
+              w.pod(int32_t(b.timeSignature.upper));
+              w.pod(int32_t(b.timeSignature.lower));
+          }
+      },
+      [&](const Period& x) {
+          w.rational(x.wholeNotes);
+      },
+      [&](const Duration& x) {
+          w.rational(x.seconds);
+      }
+    );
+    for (auto* cls : {&s.clipLinksAnchored, &s.clipLinksOverlapping}) {
+        w.pod(intCast<uint64_t>(cls->size()));
+        for (auto& cl : *cls) {
+            writeClipLink(w, cl);
+        }
+    }
+}
+
+TimeSignature readTimeSignature(ByteReader& r)
+{
+    auto upper = r.pod<int32_t>();
+    auto lower = r.pod<int32_t>();
+    // The beats must be a whole number of ticks.
+    if (upper <= 0 || lower <= 0 || Ticks::k_perWholeNote % lower != 0) {
+        r.failed = true;
+    }
+    return TimeSignature{upper, lower};
+}
+
+Section readSection(ByteReader& r)
+{
+    Section s{.name = r.str(), .tempo = {}, .structure = Bars{}, .clipLinksAnchored = {}, .clipLinksOverlapping = {}};
+    const bool hasTempo = r.pod<uint8_t>() != 0;
+    const auto tempo = r.rational();
+    if (hasTempo) {
+        if (tempo <= 0) {
+            r.failed = true;
+        }
+        s.tempo = tempo;
+    }
+    switch (r.pod<uint8_t>()) {
+    case 0: {
+        Bars bars;
+        bars.bars.resize(r.count(2 * sizeof(int32_t)));
+        for (auto& b : bars.bars) {
+            b.timeSignature = readTimeSignature(r);
+        }
+        s.structure = MOVE(bars);
+    } break;
+    case 1:
+        s.structure = Period{.wholeNotes = r.rational()};
+        break;
+    case 2:
+        s.structure = Duration{.seconds = r.rational()};
+        break;
+    default:
+        r.failed = true;
+    }
+    for (auto* cls : {&s.clipLinksAnchored, &s.clipLinksOverlapping}) {
+        const auto n = r.count(2 * sizeof(uint64_t));
+        for (UNUSED size_t i : vi::iota(0u, n)) {
+            cls->push_back(readClipLink(r));
+        }
+    }
+    return s;
+}
+
+std::filesystem::path audioDirectoryName(const std::filesystem::path& projectPath)
+{
+    return projectPath.stem().string() + "_audio";
+}
+
+// The stream functions are templates so they can also write to a ByteWriter and read from a ByteReader.
+template<class T, class Out>
+void writePod(Out& f, const T& x)
+{
+    f.write(reinterpret_cast<const char*>(&x), sizeof(T));
+}
+template<class T, class In>
+T readPod(In& f)
+{
+    T x{};
+    f.read(reinterpret_cast<char*>(&x), sizeof(T));
+    return x;
+}
+
+// Canonical 44-byte header, 32-bit float samples.
+expected<void, string> writeWavFile(const AudioClip& clip, const std::filesystem::path& path)
+{
+    if (clip.compressed) {
+        return writeWavFile(clip.decompressed(), path);
+    }
+    std::ofstream f(path, std::ios::binary);
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for writing", path));
+    }
+    const auto numChannels = intCast<uint16_t>(clip.numChannels());
+    const auto dataSize = intCast<uint32_t>(clip.size() * numChannels * sizeof(float));
+    const auto sampleRate = intFromFloat<uint32_t>(std::round(clip.sampleRate));
+    f.write("RIFF", 4);
+    writePod(f, 36 + dataSize);
+    f.write("WAVEfmt ", 8);
+    writePod(f, uint32_t(16));
+    writePod(f, uint16_t(3)); // WAVE_FORMAT_IEEE_FLOAT
+    writePod(f, numChannels);
+    writePod(f, sampleRate);
+    writePod(f, uint32_t(sampleRate * numChannels * sizeof(float)));
+    writePod(f, uint16_t(numChannels * sizeof(float)));
+    writePod(f, uint16_t(32));
+    f.write("data", 4);
+    writePod(f, dataSize);
+    vector<float> interleaved;
+    for (size_t chunkBegin = 0; chunkBegin < clip.size(); chunkBegin += k_projectAudioChunkSize) {
+        const auto n = std::min(k_projectAudioChunkSize, clip.size() - chunkBegin);
+        interleaved.resize(n * numChannels);
+        for (size_t c : vi::iota(0u, size_t(numChannels))) {
+            auto it = clip.channels()[c].begin() + ptrdiff_t(chunkBegin);
+            for (size_t i : vi::iota(0u, n)) {
+                interleaved[i * numChannels + c] = *it++;
+            }
+        }
+        f.write(reinterpret_cast<const char*>(interleaved.data()), std::streamsize(interleaved.size() * sizeof(float)));
+    }
+    if (!f) {
+        return unexpected(fmt::format("Failed to write {}", path));
+    }
+    return {};
+}
+
+// Reads the files written by `writeWavFile`. Other sample formats are not supported.
+expected<void, string> readWavFile(AudioClip& clip, size_t numFrames, const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for reading", path));
+    }
+    array<char, 4> id{};
+    f.read(id.data(), 4);
+    readPod<uint32_t>(f);
+    array<char, 4> wave{};
+    f.read(wave.data(), 4);
+    if (!f || id != array{'R', 'I', 'F', 'F'} || wave != array{'W', 'A', 'V', 'E'}) {
+        return unexpected(fmt::format("Not a WAV file: {}", path));
+    }
+    const auto numChannels = clip.numChannels();
+    bool formatOk = false;
+    while (f.read(id.data(), 4)) {
+        auto size = readPod<uint32_t>(f);
+        if (id == array{'f', 'm', 't', ' '}) {
+            if (size < 16) {
+                return unexpected(fmt::format("Invalid WAV format chunk: {}", path));
+            }
+            auto format = readPod<uint16_t>(f);
+            auto channels = readPod<uint16_t>(f);
+            readPod<uint32_t>(f); // Sample rate, the clip table's is used.
+            readPod<uint32_t>(f);
+            readPod<uint16_t>(f);
+            auto bits = readPod<uint16_t>(f);
+            formatOk = format == 3 && bits == 32 && channels == numChannels;
+            f.seekg(std::streamoff(size - 16 + size % 2), std::ios::cur);
+        } else if (id == array{'d', 'a', 't', 'a'}) {
+            if (!formatOk) {
+                return unexpected(
+                  fmt::format("Unsupported WAV format, expected {}-channel 32-bit float: {}", numChannels, path)
+                );
+            }
+            if (size / (numChannels * sizeof(float)) < numFrames) {
+                return unexpected(fmt::format("WAV file is shorter than the clip: {}", path));
+            }
+            vector<float> interleaved;
+            vector<vector<float>> channels(numChannels);
+            for (size_t chunkBegin = 0; chunkBegin < numFrames; chunkBegin += k_projectAudioChunkSize) {
+                const auto n = std::min(k_projectAudioChunkSize, numFrames - chunkBegin);
+                interleaved.resize(n * numChannels);
+                f.read(
+                  reinterpret_cast<char*>(interleaved.data()), std::streamsize(interleaved.size() * sizeof(float))
+                );
+                if (!f) {
+                    return unexpected(fmt::format("Truncated WAV file: {}", path));
+                }
+                for (size_t c : vi::iota(0u, numChannels)) {
+                    channels[c].resize(n);
+                    for (size_t i : vi::iota(0u, n)) {
+                        channels[c][i] = interleaved[i * numChannels + c];
+                    }
+                }
+                clip.append(channels);
+            }
+            return {};
+        } else {
+            f.seekg(std::streamoff(size + size % 2), std::ios::cur);
+        }
+    }
+    return unexpected(fmt::format("No audio data in WAV file: {}", path));
+}
+
+template<class Out>
+void writeEmbeddedAudio(Out& f, const AudioClip& clip, bool compress)
+{
+    if (clip.compressed) {
+        if (!compress) {
+            writeEmbeddedAudio(f, clip.decompressed(), compress);
+            return;
+        }
+        // The in-memory blocks are already in this format.
+        static_assert(CompressedAudio::k_compressedAudioChunkSize == k_projectAudioChunkSize);
+        for (auto& block : clip.compressed->blocks) {
+            writePod(f, block.codec);
+            writePod(f, intCast<uint32_t>(block.bytes.size()));
+            f.write(block.bytes.data(), std::streamsize(block.bytes.size()));
+        }
+        return;
+    }
+    vector<float> samples;
+    for (size_t chunkBegin = 0; chunkBegin < clip.size(); chunkBegin += k_projectAudioChunkSize) {
+        const auto n = std::min(k_projectAudioChunkSize, clip.size() - chunkBegin);
+        for (auto& channel : clip.channels()) {
+            auto it = channel.begin() + ptrdiff_t(chunkBegin);
+            samples.assign(it, it + ptrdiff_t(n));
+            const auto rawSize = n * sizeof(float);
+            if (compress) {
+                auto block = CompressedAudio::compressBlock(samples);
+                writePod(f, block.codec);
+                writePod(f, intCast<uint32_t>(block.bytes.size()));
+                f.write(block.bytes.data(), std::streamsize(block.bytes.size()));
+            } else {
+                writePod(f, AudioCodec::raw);
+                writePod(f, intCast<uint32_t>(rawSize));
+                f.write(reinterpret_cast<const char*>(samples.data()), std::streamsize(rawSize));
+            }
+        }
+    }
+}
+
+template<class In>
+expected<void, string> readEmbeddedAudio(In& f, AudioClip& clip, size_t numFrames)
+{
+    vector<vector<float>> channels(clip.numChannels());
+    vector<char> encoded;
+    for (size_t chunkBegin = 0; chunkBegin < numFrames; chunkBegin += k_projectAudioChunkSize) {
+        const auto n = std::min(k_projectAudioChunkSize, numFrames - chunkBegin);
+        for (auto& channel : channels) {
+            channel.resize(n);
+            const auto codec = readPod<AudioCodec>(f);
+            const auto numBytes = readPod<uint32_t>(f);
+            if (!f || numBytes > n * sizeof(float)) {
+                return unexpected("Invalid audio chunk");
+            }
+            switch (codec) {
+            case AudioCodec::raw:
+                if (numBytes != n * sizeof(float)) {
+                    return unexpected("Invalid audio chunk size");
+                }
+                f.read(reinterpret_cast<char*>(channel.data()), std::streamsize(numBytes));
+                break;
+            case AudioCodec::xorDelta:
+                encoded.resize(numBytes);
+                f.read(encoded.data(), std::streamsize(numBytes));
+                if (f && !decodeXorDelta(encoded, channel)) {
+                    return unexpected("Corrupt compressed audio chunk");
+                }
+                break;
+            case AudioCodec::predictiveRice:
+                encoded.resize(numBytes);
+                f.read(encoded.data(), std::streamsize(numBytes));
+                if (f && !decodePredictiveRice(encoded, channel)) {
+                    return unexpected("Corrupt compressed audio chunk");
+                }
+                break;
+            default:
+                return unexpected(fmt::format("Unknown audio codec {}", int(codec)));
+            }
+            if (!f) {
+                return unexpected("Truncated audio chunk");
+            }
+        }
+        clip.append(channels);
+    }
+    return {};
+}
+
+void writeMetronome(ByteWriter& w, const AppState::Metronome& m)
+{
+    w.pod(uint8_t(m.on));
+    w.rational(m.tempo);
+    w.pod(int32_t(m.timeSignature.upper));
+    w.pod(int32_t(m.timeSignature.lower));
+}
+
+AppState::Metronome readMetronome(ByteReader& r)
+{
+    AppState::Metronome m;
+    m.on = r.pod<uint8_t>() != 0;
+    m.tempo = r.rational();
+    m.timeSignature = readTimeSignature(r);
+    return m;
+}
+
+void writeTrack(ByteWriter& w, const Track& t)
+{
+    w.str(t.name);
+}
+
+Track readTrack(ByteReader& r)
+{
+    return Track{.name = r.str()};
+}
+
+template<class T>
+void writeIds(ByteWriter& w, span<const Id<T>> ids)
+{
+    w.pod(intCast<uint64_t>(ids.size()));
+    for (auto id : ids) {
+        w.id(id);
+    }
+}
+
+// The order of the items of a SlotMap, fails if an id is not in `items`.
+template<class T>
+vector<Id<T>> readOrder(ByteReader& r, const SlotMap<Id<T>, T>& items)
+{
+    const auto n = r.count(sizeof(uint64_t));
+    vector<Id<T>> ids;
+    ids.reserve(n);
+    for (UNUSED size_t i : vi::iota(0u, n)) {
+        ids.push_back(r.id<T>());
+        r.failed = r.failed || !items.contains(ids.back());
+    }
+    return ids;
+}
+
+template<class T>
+void writeItems(ByteWriter& w, const SlotMap<Id<T>, T>& items, void (*writeItem)(ByteWriter&, const T&))
+{
+    w.pod(intCast<uint64_t>(items.size()));
+    for (auto& [id, x] : items) {
+        w.id(id);
+        writeItem(w, x);
+    }
+}
+
+template<class T>
+void readItems(ByteReader& r, SlotMap<Id<T>, T>& items, T (*readItem)(ByteReader&))
+{
+    const auto n = r.count(sizeof(uint64_t));
+    items.clear();
+    items.reserve(n);
+    for (UNUSED size_t i : vi::iota(0u, n)) {
+        auto id = r.id<T>();
+        items.insert(pair(id, readItem(r)));
+    }
+}
+
+// Everything but the clips.
+void writeDocument(ByteWriter& w, const ProjectRef& project)
+{
+    writeMetronome(w, project.metronome);
+    writeItems(w, project.sections, writeSection);
+    writeIds(w, span(project.sectionOrder));
+    w.pod(int32_t(project.nextNewTrackId));
+    writeItems(w, project.tracks, writeTrack);
+    writeIds(w, span(project.trackOrder));
+    writeItems(w, project.clipLinks, writeClipLink);
+}
+
+// Replaces everything but the clips in `p`.
+void readDocument(ByteReader& r, Project& p)
+{
+    p.metronome = readMetronome(r);
+    readItems(r, p.sections, readSection);
+    p.sectionOrder = readOrder(r, p.sections);
+    p.nextNewTrackId = r.pod<int32_t>();
+    readItems(r, p.tracks, readTrack);
+    p.trackOrder = readOrder(r, p.tracks);
+    readItems(r, p.clipLinks, readClipLink);
+}
+
+// The clip table entry up to the storage.
+void writeClipHeader(ByteWriter& w, Id<AudioClip> id, const AudioClip& clip)
+{
+    w.id(id);
+    w.pod(clip.sampleRate);
+    w.pod(uint32_t(clip.numChannels()));
+    w.pod(intCast<uint64_t>(clip.size()));
+}
+
+struct ClipHeader {
+    Id<AudioClip> id;
+    double sampleRate;
+    uint32_t numChannels;
+    size_t numFrames;
+};
+
+ClipHeader readClipHeader(ByteReader& r)
+{
+    auto id = r.id<AudioClip>();
+    const auto sampleRate = r.pod<double>();
+    const auto numChannels = r.pod<uint32_t>();
+    const auto numFrames = r.pod<uint64_t>();
+    if (!(sampleRate > 0) || numChannels == 0 || numChannels > 1024 || !std::in_range<size_t>(numFrames)) {
+        r.failed = true;
+    }
+    return ClipHeader{
+      .id = id,
+      .sampleRate = sampleRate,
+      .numChannels = numChannels,
+      .numFrames = r.failed ? 0 : intCast<size_t>(numFrames)
+    };
+}
+
+constexpr array<char, 4> k_journalMagic = {'D', 'T', 'J', 'L'};
+constexpr uint32_t k_journalVersion = 2; // Version 1 journaled the document as a whole only.
+constexpr size_t k_journalHeaderSize = k_journalMagic.size() + sizeof(uint32_t);
+constexpr size_t k_journalRecordHeaderSize = 2 * sizeof(uint32_t) + sizeof(uint8_t);
+
+enum class JournalRecord : uint8_t {
+    document, // Everything but the clips, see writeDocument. Only in version 1.
+    clipAdded, // Clip header and embedded audio.
+    clipRemoved, // Clip id.
+    metronome,
+    sectionOrder, // The ids, each in the sections.
+    trackOrder, // nextNewTrackId, the ids, each in the tracks.
+    sectionSet, // Id and section, added or changed.
+    sectionRemoved, // Id, not in the sectionOrder.
+    trackSet,
+    trackRemoved,
+    clipLinkSet,
+    clipLinkRemoved
+};
+
+// FNV-1a, to detect a record which was only partially written to the disk before a crash.
+uint32_t journalChecksum(JournalRecord type, span<const char> payload)
+{
+    uint32_t h = 2166136261u;
+    auto add = [&h](char c) {
+        h = (h ^ uint8_t(c)) * 16777619u;
+    };
+    add(char(type));
+    for (char c : payload) {
+        add(c);
+    }
+    return h;
+}
+
+void appendJournalRecord(vector<char>& journal, JournalRecord type, span<const char> payload)
+{
+    ByteWriter w{.bytes = MOVE(journal)};
+    w.pod(intCast<uint32_t>(payload.size()));
+    w.pod(journalChecksum(type, payload));
+    w.pod(type);
+    w.write(payload.data(), std::streamsize(payload.size()));
+    journal = MOVE(w.bytes);
+}
+
+template<class T>
+void appendJournalItemRecord(
+  vector<char>& journal, JournalRecord type, Id<T> id, const T& x, void (*writeItem)(ByteWriter&, const T&)
+)
+{
+    ByteWriter w;
+    w.id(id);
+    writeItem(w, x);
+    appendJournalRecord(journal, type, w.bytes);
+}
+
+template<class T>
+void appendJournalItemRemovedRecord(vector<char>& journal, JournalRecord type, Id<T> id)
+{
+    ByteWriter w;
+    w.id(id);
+    appendJournalRecord(journal, type, w.bytes);
+}
+
+// The payload of a record which sets an item, false if it's corrupt.
+template<class T>
+bool replayItemSet(ByteReader& r, SlotMap<Id<T>, T>& items, T (*readItem)(ByteReader&))
+{
+    auto id = r.id<T>();
+    auto x = readItem(r);
+    if (r.failed || r.pos != r.bytes.size()) {
+        return false;
+    }
+    items.insert_or_assign(id, MOVE(x));
+    return true;
+}
+
+// The payload of a record which removes an item, false if it's corrupt or the item is still in `order`.
+template<class T>
+bool replayItemRemoved(ByteReader& r, SlotMap<Id<T>, T>& items, span<const Id<T>> order)
+{
+    auto id = r.id<T>();
+    if (r.failed || r.pos != r.bytes.size() || ra::find(order, id) != order.end()) {
+        return false;
+    }
+    items.erase(id);
+    return true;
+}
+} // namespace
+
+ProjectRef ProjectRef::of(AppState& appState)
+{
+    auto& rse = appState.rse;
+    return ProjectRef{
+      .metronome = rse.get(appState.metronome),
+      .sections = rse.get(appState.sections),
+      .sectionOrder = rse.get(appState.sectionOrder),
+      .nextNewTrackId = rse.get(appState.nextNewTrackId),
+      .tracks = rse.get(appState.tracks),
+      .trackOrder = rse.get(appState.trackOrder),
+      .clipLinks = rse.get(appState.clipLinks),
+      .clips = rse.get(appState.clips)
+    };
+}
+
+ProjectRef ProjectRef::of(const Project& project)
+{
+    return ProjectRef{
+      .metronome = project.metronome,
+      .sections = project.sections,
+      .sectionOrder = project.sectionOrder,
+      .nextNewTrackId = project.nextNewTrackId,
+      .tracks = project.tracks,
+      .trackOrder = project.trackOrder,
+      .clipLinks = project.clipLinks,
+      .clips = project.clips
+    };
+}
+
+expected<void, string>
+saveProject(AppState& appState, const std::filesystem::path& path, ProjectAudioStorage audioStorage)
+{
+    return saveProject(ProjectRef::of(appState), path, audioStorage);
+}
+
+expected<void, string>
+saveProject(const ProjectRef& project, const std::filesystem::path& path, ProjectAudioStorage audioStorage)
+{
+    std::ofstream f(path, std::ios::binary);
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for writing", path));
+    }
+    f.write(k_fileMagic.data(), k_fileMagic.size());
+    writePod(f, k_fileVersion);
+
+    ByteWriter w;
+    writeDocument(w, project);
+
+    // The audio is written while the clip table is being built.
+    const auto audioDirName = audioDirectoryName(path);
+    if (audioStorage == ProjectAudioStorage::external) {
+        std::error_code ec;
+        std::filesystem::create_directories(path.parent_path() / audioDirName, ec);
+        if (ec) {
+            return unexpected(fmt::format("Can't create {}: {}", path.parent_path() / audioDirName, ec.message()));
+        }
+    }
+    w.pod(intCast<uint64_t>(project.clips.size()));
+    for (auto& [id, clip] : project.clips) {
+        writeClipHeader(w, id, clip);
+        switch (audioStorage) {
+        case ProjectAudioStorage::external: {
+            const auto relativePath = audioDirName / fmt::format("{:016x}.wav", id.v);
+            if (auto r = writeWavFile(clip, path.parent_path() / relativePath); !r) {
+                return r;
+            }
+            w.pod(ClipStorage::external);
+            w.str(relativePath.generic_string());
+        } break;
+        case ProjectAudioStorage::embedded:
+        case ProjectAudioStorage::embeddedCompressed:
+            w.pod(ClipStorage::embedded);
+            w.pod(uint64_t(f.tellp()));
+            writeEmbeddedAudio(f, clip, audioStorage == ProjectAudioStorage::embeddedCompressed);
+            break;
+        }
+    }
+
+    const auto metadataOffset = uint64_t(f.tellp());
+    f.write(w.bytes.data(), std::streamsize(w.bytes.size()));
+    writePod(f, metadataOffset);
+    writePod(f, intCast<uint64_t>(w.bytes.size()));
+    f.write(k_fileMagic.data(), k_fileMagic.size());
+    if (!f) {
+        return unexpected(fmt::format("Failed to write {}", path));
+    }
+    return {};
+}
+
+expected<Project, string> loadProject(const std::filesystem::path& path)
+{
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        return unexpected(fmt::format("Can't open {} for reading", path));
+    }
+    array<char, 4> magic{};
+    f.read(magic.data(), magic.size());
+    const auto version = readPod<uint32_t>(f);
+    if (!f || magic != k_fileMagic) {
+        return unexpected(fmt::format("Not a project file: {}", path));
+    }
+    if (version != k_fileVersion) {
+        return unexpected(fmt::format("Unsupported project file version {}: {}", version, path));
+    }
+    f.seekg(0, std::ios::end);
+    const auto fileSize = uint64_t(f.tellg());
+    if (fileSize < k_fileMagic.size() + sizeof(uint32_t) + k_trailerSize) {
+        return unexpected(fmt::format("Truncated project file: {}", path));
+    }
+    f.seekg(std::streamoff(fileSize - k_trailerSize));
+    const auto metadataOffset = readPod<uint64_t>(f);
+    const auto metadataSize = readPod<uint64_t>(f);
+    f.read(magic.data(), magic.size());
+    if (!f || magic != k_fileMagic || metadataOffset > fileSize - k_trailerSize
+        || metadataSize != fileSize - k_trailerSize - metadataOffset) {
+        return unexpected(fmt::format("Truncated or corrupt project file: {}", path));
+    }
+    vector<char> metadata(metadataSize);
+    f.seekg(std::streamoff(metadataOffset));
+    f.read(metadata.data(), std::streamsize(metadata.size()));
+
+    ByteReader r{.bytes = metadata};
+    Project p;
+    readDocument(r, p);
+
+    const auto numClips = r.count(sizeof(uint64_t));
+    p.clips.reserve(numClips);
+    for (UNUSED size_t i : vi::iota(0u, numClips)) {
+        const auto ch = readClipHeader(r);
+        const auto storage = r.enumValue(ClipStorage::embedded);
+        if (r.failed) {
+            break;
+        }
+        AudioClip clip(ch.sampleRate, ch.numChannels);
+        expected<void, string> audioResult;
+        switch (storage) {
+        case ClipStorage::external: {
+            auto relativePath = r.str();
+            if (!r.failed) {
+                audioResult = readWavFile(clip, ch.numFrames, path.parent_path() / relativePath);
+            }
+        } break;
+        case ClipStorage::embedded: {
+            const auto offset = r.pod<uint64_t>();
+            if (!r.failed) {
+                f.seekg(std::streamoff(offset));
+                audioResult = readEmbeddedAudio(f, clip, ch.numFrames);
+            }
+        } break;
+        }
+        if (!audioResult) {
+            return unexpected(fmt::format("Failed to load clip #{} of {}: {}", ch.id.v, path, audioResult.error()));
+        }
+        p.clips.insert(pair(ch.id, MOVE(clip)));
+    }
+    if (r.failed || r.pos != metadata.size()) {
+        return unexpected(fmt::format("Corrupt project file: {}", path));
+    }
+    return p;
+}
+
+void setProject(AppState& appState, Project project)
+{
+    for (auto id : project.sections | vi::keys) {
+        Id<Section>::noteExisting(id);
+    }
+    for (auto id : project.tracks | vi::keys) {
+        Id<Track>::noteExisting(id);
+    }
+    for (auto id : project.clipLinks | vi::keys) {
+        Id<ClipLink>::noteExisting(id);
+    }
+    for (auto id : project.clips | vi::keys) {
+        Id<AudioClip>::noteExisting(id);
+    }
+    auto& rse = appState.rse;
+    rse.clearUndoHistory();
+    rse.set(appState.metronome, project.metronome);
+    rse.setAsDifferent(appState.sections, MOVE(project.sections));
+    rse.setAsDifferent(appState.sectionOrder, MOVE(project.sectionOrder));
+    rse.setWithoutUndo(appState.nextNewTrackId, project.nextNewTrackId);
+    rse.setWithoutUndo(appState.tracks, MOVE(project.tracks));
+    rse.setWithoutUndo(appState.trackOrder, MOVE(project.trackOrder));
+    rse.setAsDifferent(appState.clipLinks, MOVE(project.clipLinks));
+    rse.setAsDifferent(appState.clips, MOVE(project.clips));
+}
+
+void startJournal(vector<char>& journal)
+{
+    journal.insert(journal.end(), k_journalMagic.begin(), k_journalMagic.end());
+    ByteWriter w{.bytes = MOVE(journal)};
+    w.pod(k_journalVersion);
+    journal = MOVE(w.bytes);
+}
+
+void appendJournalMetronome(vector<char>& journal, const AppState::Metronome& metronome)
+{
+    ByteWriter w;
+    writeMetronome(w, metronome);
+    appendJournalRecord(journal, JournalRecord::metronome, w.bytes);
+}
+
+void appendJournalSectionOrder(vector<char>& journal, span<const Id<Section>> sectionOrder)
+{
+    ByteWriter w;
+    writeIds(w, sectionOrder);
+    appendJournalRecord(journal, JournalRecord::sectionOrder, w.bytes);
+}
+
+void appendJournalTrackOrder(vector<char>& journal, int nextNewTrackId, span<const Id<Track>> trackOrder)
+{
+    ByteWriter w;
+    w.pod(intCast<int32_t>(nextNewTrackId));
+    writeIds(w, trackOrder);
+    appendJournalRecord(journal, JournalRecord::trackOrder, w.bytes);
+}
+
+void appendJournalItem(vector<char>& journal, Id<Section> id, const Section& section)
+{
+    appendJournalItemRecord(journal, JournalRecord::sectionSet, id, section, writeSection);
+}
+
+void appendJournalItem(vector<char>& journal, Id<Track> id, const Track& track)
+{
+    appendJournalItemRecord(journal, JournalRecord::trackSet, id, track, writeTrack);
+}
+
+void appendJournalItem(vector<char>& journal, Id<ClipLink> id, const ClipLink& clipLink)
+{
+    appendJournalItemRecord(journal, JournalRecord::clipLinkSet, id, clipLink, writeClipLink);
+}
+
+void appendJournalItemRemoved(vector<char>& journal, Id<Section> id)
+{
+    appendJournalItemRemovedRecord(journal, JournalRecord::sectionRemoved, id);
+}
+
+void appendJournalItemRemoved(vector<char>& journal, Id<Track> id)
+{
+    appendJournalItemRemovedRecord(journal, JournalRecord::trackRemoved, id);
+}
+
+void appendJournalItemRemoved(vector<char>& journal, Id<ClipLink> id)
+{
+    appendJournalItemRemovedRecord(journal, JournalRecord::clipLinkRemoved, id);
+}
+
+void appendJournalClipAdded(vector<char>& journal, Id<AudioClip> id, const AudioClip& clip)
+{
+    ByteWriter w;
+    writeClipHeader(w, id, clip);
+    writeEmbeddedAudio(w, clip, true);
+    appendJournalRecord(journal, JournalRecord::clipAdded, w.bytes);
+}
+
+void appendJournalClipRemoved(vector<char>& journal, Id<AudioClip> id)
+{
+    ByteWriter w;
+    w.id(id);
+    appendJournalRecord(journal, JournalRecord::clipRemoved, w.bytes);
+}
+
+expected<size_t, string> replayJournal(span<const char> journal, Project& project)
+{
+    ByteReader header{.bytes = journal};
+    array<char, 4> magic{};
+    header.read(magic.data(), magic.size());
+    const auto version = header.pod<uint32_t>();
+    if (header.failed || magic != k_journalMagic) {
+        return unexpected("Not a journal");
+    }
+    if (version == 0 || version > k_journalVersion) {
+        return unexpected(fmt::format("Unsupported journal version {}", version));
+    }
+    size_t pos = k_journalHeaderSize;
+    while (journal.size() - pos >= k_journalRecordHeaderSize) {
+        ByteReader rh{.bytes = journal.subspan(pos, k_journalRecordHeaderSize)};
+        const auto payloadSize = rh.pod<uint32_t>();
+        const auto checksum = rh.pod<uint32_t>();
+        const auto type = rh.pod<JournalRecord>();
+        if (journal.size() - pos - k_journalRecordHeaderSize < payloadSize) {
+            break;
+        }
+        const auto payload = journal.subspan(pos + k_journalRecordHeaderSize, payloadSize);
+        if (checksum != journalChecksum(type, payload)) {
+            break;
+        }
+        // Parse into temporaries so a record which passed the checksum but fails to parse leaves `project` as it was.
+        ByteReader r{.bytes = payload};
+        switch (type) {
+        case JournalRecord::document: {
+            Project p;
+            readDocument(r, p);
+            if (r.failed || r.pos != payload.size()) {
+                return pos;
+            }
+            p.clips = MOVE(project.clips);
+            project = MOVE(p);
+        } break;
+        case JournalRecord::clipAdded: {
+            const auto ch = readClipHeader(r);
+            if (r.failed) {
+                return pos;
+            }
+            AudioClip clip(ch.sampleRate, ch.numChannels);
+            if (!readEmbeddedAudio(r, clip, ch.numFrames) || r.pos != payload.size()) {
+                return pos;
+            }
+            project.clips.insert_or_assign(ch.id, MOVE(clip));
+        } break;
+        case JournalRecord::clipRemoved: {
+            auto id = r.id<AudioClip>();
+            if (r.failed || r.pos != payload.size()) {
+                return pos;
+            }
+            project.clips.erase(id);
+        } break;
+        case JournalRecord::metronome: {
+            auto metronome = readMetronome(r);
+            if (r.failed || r.pos != payload.size()) {
+                return pos;
+            }
+            project.metronome = metronome;
+        } break;
+        case JournalRecord::sectionOrder: {
+            auto order = readOrder(r, project.sections);
+            if (r.failed || r.pos != payload.size()) {
+                return pos;
+            }
+            project.sectionOrder = MOVE(order);
+        } break;
+        case JournalRecord::trackOrder: {
+            const auto nextNewTrackId = r.pod<int32_t>();
+            auto order = readOrder(r, project.tracks);
+            if (r.failed || r.pos != payload.size()) {
+                return pos;
+            }
+            project.nextNewTrackId = nextNewTrackId;
+            project.trackOrder = MOVE(order);
+        } break;
+        case JournalRecord::sectionSet:
+            if (!replayItemSet(r, project.sections, readSection)) {
+                return pos;
+            }
+            break;
+        case JournalRecord::sectionRemoved:
+            if (!replayItemRemoved(r, project.sections, span<const Id<Section>>(project.sectionOrder))) {
+                return pos;
+            }
+            break;
+        case JournalRecord::trackSet:
+            if (!replayItemSet(r, project.tracks, readTrack)) {
+                return pos;
+            }
+            break;
+        case JournalRecord::trackRemoved:
+            if (!replayItemRemoved(r, project.tracks, span<const Id<Track>>(project.trackOrder))) {
+                return pos;
+            }
+            break;
+        case JournalRecord::clipLinkSet:
+            if (!replayItemSet(r, project.clipLinks, readClipLink)) {
+                return pos;
+            }
+            break;
+        case JournalRecord::clipLinkRemoved:
+            if (!replayItemRemoved(r, project.clipLinks, span<const Id<ClipLink>>())) {
+                return pos;
+            }
+            break;
+        default:
+            return pos;
+        }
+        pos += k_journalRecordHeaderSize + payloadSize;
+    }
+    return pos;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "AppState.h"
+
+#include <filesystem>
+
+// Binary, versioned project file:
+//
+//     "DTPJ" u32:version
+//     audio of the embedded clips
+//     metadata
+//     u64:metadataOffset u64:metadataSize "DTPJ"
+//
+// The metadata (metronome, sections, tracks, clip links and the clip table) is written last, so the audio can be
+// streamed to the file while it's being encoded. Each entry of the clip table refers either to an audio file, relative
+// to the directory of the project, or to the offset of the clip's first chunk in this file.
+//
+// Embedded audio is split into chunks of k_projectAudioChunkSize frames, each chunk holds one block per channel:
+//
+//     u8:codec u32:numBytes bytes
+//
+// Integers and floats are in native byte order, like in the peak files.
+
+constexpr size_t k_projectAudioChunkSize = 65536;
+
+enum class ProjectAudioStorage {
+    external, // 32-bit float WAV files in the "<project name>_audio" directory next to the project.
+    embedded,
+    embeddedCompressed // Lossless, a chunk is stored uncompressed if it wouldn't get smaller.
+};
+
+// The document part of AppState, as read from a project file.
+struct Project {
+    AppState::Metronome metronome;
+    SlotMap<Id<Section>, Section> sections;
+    vector<Id<Section>> sectionOrder;
+    int nextNewTrackId = 1;
+    SlotMap<Id<Track>, Track> tracks;
+    vector<Id<Track>> trackOrder;
+    SlotMap<Id<ClipLink>, ClipLink> clipLinks;
+    SlotMap<Id<AudioClip>, AudioClip> clips;
+};
+
+// The document of an AppState or a Project, for writing it without copying.
+struct ProjectRef {
+    const AppState::Metronome& metronome;
+    const SlotMap<Id<Section>, Section>& sections;
+    const vector<Id<Section>>& sectionOrder;
+    int nextNewTrackId;
+    const SlotMap<Id<Track>, Track>& tracks;
+    const vector<Id<Track>>& trackOrder;
+    const SlotMap<Id<ClipLink>, ClipLink>& clipLinks;
+    const SlotMap<Id<AudioClip>, AudioClip>& clips;
+
+    static ProjectRef of(AppState& appState);
+    static ProjectRef of(const Project& project);
+};
+
+expected<void, string>
+saveProject(AppState& appState, const std::filesystem::path& path, ProjectAudioStorage audioStorage);
+expected<void, string>
+saveProject(const ProjectRef& project, const std::filesystem::path& path, ProjectAudioStorage audioStorage);
+expected<Project, string> loadProject(const std::filesystem::path& path);
+
+// Replace the document in the AppState, setting each node once instead of inserting the items one by one. Clears the
+// undo history. The ids of the project are noted so new ids won't collide with them.
+void setProject(AppState& appState, Project project);
+
+// Journal of document changes, for the autosave:
+//
+//     "DTJL" u32:version
+//     records: u32:payloadSize u32:checksum u8:type payload
+//
+// Each record replaces the metronome or an order of items, or adds, replaces or removes a single item (section, track,
+// clip link or clip), so a journal can be replayed over a snapshot which already contains some of its records. An item
+// is added before the order referring to it and removed after it. The clips' audio is stored like in the project file,
+// compressed.
+void startJournal(vector<char>& journal); // Appends the header.
+void appendJournalMetronome(vector<char>& journal, const AppState::Metronome& metronome);
+void appendJournalSectionOrder(vector<char>& journal, span<const Id<Section>> sectionOrder);
+void appendJournalTrackOrder(vector<char>& journal, int nextNewTrackId, span<const Id<Track>> trackOrder);
+// Added or changed.
+void appendJournalItem(vector<char>& journal, Id<Section> id, const Section& section);
+void appendJournalItem(vector<char>& journal, Id<Track> id, const Track& track);
+void appendJournalItem(vector<char>& journal, Id<ClipLink> id, const ClipLink& clipLink);
+void appendJournalItemRemoved(vector<char>& journal, Id<Section> id);
+void appendJournalItemRemoved(vector<char>& journal, Id<Track> id);
+void appendJournalItemRemoved(vector<char>& journal, Id<ClipLink> id);
+void appendJournalClipAdded(vector<char>& journal, Id<AudioClip> id, const AudioClip& clip);
+void appendJournalClipRemoved(vector<char>& journal, Id<AudioClip> id);
+
+// Applies the records of the journal to `project`. Replaying stops at the first incomplete or corrupt record, which is
+// what a crash while appending leaves behind. Returns the number of bytes replayed.
+expected<size_t, string> replayJournal(span<const char> journal, Project& project);
@@ -1,55 +1,180 @@
 #include "ReactiveStateEngine.h"
 
-void rse::NodeBase::setTimestampAndMarkDownstreamNodesOutOfDate(uint64_t newTimestamp)
+namespace
 {
-    timestamp = newTimestamp;
-    for (auto* d : downstreamNodes) {
-        d->markThisAndDownstreamNodesOutOfDate();
+string escapeForJsonOrDot(string_view s)
+{
+    string r;
+    r.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            r += '\\';
+        }
+        r += c;
     }
+    return r;
 }
+double toMs(chr::steady_clock::duration d)
+{
+    return chr::duration<double, std::milli>(d).count();
+}
+} // namespace
 
-void rse::ComputedNodeBase::markThisAndDownstreamNodesOutOfDate()
+rse::ScopedUndoables::~ScopedUndoables()
 {
-    // We assume that if this is not up-to-date then no downstream nodes will up-to-date since no node can be up-to-date
-    // without first makeing sure its upstream nodes are up-to-date.
-    if (upToDate) {
-        upToDate = false;
-        for (auto* d : downstreamNodes) {
-            d->markThisAndDownstreamNodesOutOfDate();
+    if (that) {
+        that->finishUndoables();
+    }
+}
+
+rse::NodeId ReactiveStateEngine::nodeIdOf(const rse::NodeBase& nb, rse::ComputedNodeBase* cnb)
+{
+    if (nb.id == 0) {
+        nb.id = intCast<rse::NodeId>(nodeTable.size());
+        nodeTable.push_back(NodeTableEntry{.node = const_cast<rse::NodeBase*>(&nb), .computed = cnb});
+        if (profilingEnabled) {
+            nodeProfiles.resize(nodeTable.size());
+        }
+    }
+    return nb.id;
+}
+
+void ReactiveStateEngine::rebuildDownstreamEdgesIfNeeded()
+{
+    if (!downstreamEdgesOutOfDate) {
+        return;
+    }
+    downstreamEdgesOutOfDate = false;
+    // Count the downstream edges of each node, then turn the counts into offsets and fill the arena. Iterating the
+    // downstream nodes in id order makes each node's downstream edges sorted.
+    downstreamEdgeOffsets.assign(nodeTable.size() + 1, 0);
+    for (auto& e : nodeTable) {
+        if (e.computed) {
+            for (auto u : upstreamEdges(*e.computed)) {
+                ++downstreamEdgeOffsets[u + 1];
+            }
+        }
+    }
+    for (size_t i = 1; i < downstreamEdgeOffsets.size(); ++i) {
+        downstreamEdgeOffsets[i] += downstreamEdgeOffsets[i - 1];
+    }
+    downstreamEdgeArena.resize(downstreamEdgeOffsets.back());
+    auto nextSlot = downstreamEdgeOffsets;
+    for (rse::NodeId d : vi::iota(rse::NodeId(1), intCast<rse::NodeId>(nodeTable.size()))) {
+        if (auto* cnb = nodeTable[d].computed) {
+            for (auto u : upstreamEdges(*cnb)) {
+                downstreamEdgeArena[nextSlot[u]++] = d;
+            }
         }
     }
 }
 
-void rse::NodeBase::addDownstreamNode(rse::ComputedNodeBase* cnb)
+span<const rse::NodeId> ReactiveStateEngine::upstreamEdges(const rse::ComputedNodeBase& cnb) const
 {
-    auto it = ra::lower_bound(downstreamNodes, cnb);
-    CHECK(it == downstreamNodes.end() || *it != cnb);
-    downstreamNodes.insert(it, cnb);
+    return span(upstreamEdgeArena).subspan(cnb.upstreamEdgesBegin, cnb.upstreamEdgesEnd - cnb.upstreamEdgesBegin);
 }
 
-rse::ScopedUndoables::~ScopedUndoables()
+span<const rse::NodeId> ReactiveStateEngine::downstreamEdges(rse::NodeId id) const
 {
-    if (that) {
-        that->finishUndoables();
+    assert(!downstreamEdgesOutOfDate);
+    if (id == 0 || downstreamEdgeOffsets.size() <= id + 1) {
+        return {};
+    }
+    return span(downstreamEdgeArena)
+      .subspan(downstreamEdgeOffsets[id], downstreamEdgeOffsets[id + 1] - downstreamEdgeOffsets[id]);
+}
+
+void ReactiveStateEngine::setTimestampAndMarkDownstreamNodesOutOfDate(rse::NodeBase& nb)
+{
+    nb.timestamp = nextTimestamp++;
+    if (nb.id != 0) {
+        rebuildDownstreamEdgesIfNeeded();
+        markDownstreamNodesOutOfDate(nb.id);
+    }
+}
+
+void ReactiveStateEngine::markDownstreamNodesOutOfDate(rse::NodeId id)
+{
+    for (auto d : downstreamEdges(id)) {
+        // We assume that if a node is not up-to-date then no downstream nodes will be up-to-date since no node can be
+        // up-to-date without first making sure its upstream nodes are up-to-date.
+        auto* cnb = nodeTable[d].computed;
+        if (cnb->upToDate) {
+            cnb->upToDate = false;
+            markDownstreamNodesOutOfDate(d);
+        }
     }
 }
 
 void ReactiveStateEngine::addToInputCollectorIfNeeded(const rse::NodeBase& nb)
 {
     if (inputCollectorDuringRegistration) {
-        inputCollectorDuringRegistration->push_back(&nb);
+        inputCollectorDuringRegistration->push_back(nodeIdOf(nb, nullptr));
+    } else if (readsBeingRecorded) {
+        readsBeingRecorded->nodes.push_back(nodeIdOf(nb, nullptr));
     }
 }
 
 bool ReactiveStateEngine::updateIfNeededCore(const rse::ComputedNodeBase& cnb)
 {
     if (inputCollectorDuringRegistration) {
-        inputCollectorDuringRegistration->push_back(&cnb);
+        inputCollectorDuringRegistration->push_back(nodeIdOf(cnb, const_cast<rse::ComputedNodeBase*>(&cnb)));
         return false;
     }
+    if (readsBeingRecorded) {
+        readsBeingRecorded->nodes.push_back(nodeIdOf(cnb, const_cast<rse::ComputedNodeBase*>(&cnb)));
+        // The reads of the updater functions are not recorded, this node covers them.
+        auto suspendedReads = std::exchange(readsBeingRecorded, nullopt);
+        bool changed = updateIfNeededCore2(cnb);
+        readsBeingRecorded = MOVE(suspendedReads);
+        return changed;
+    }
     return updateIfNeededCore2(cnb);
 }
 
+void ReactiveStateEngine::beginRecordingReads()
+{
+    CHECK(!readsBeingRecorded);
+    readsBeingRecorded.emplace();
+}
+
+rse::ReadSet ReactiveStateEngine::endRecordingReads()
+{
+    CHECK(readsBeingRecorded);
+    auto rs = MOVE(*readsBeingRecorded);
+    readsBeingRecorded.reset();
+    sortUniqueInplace(rs.nodes);
+    rs.endTimestamp = nextTimestamp;
+    return rs;
+}
+
+bool ReactiveStateEngine::hasAnyChangedSince(const rse::ReadSet& rs)
+{
+    if (nextTimestamp == rs.endTimestamp) {
+        // Nothing has been changed or recomputed since.
+        return false;
+    }
+    for (auto id : rs.nodes) {
+        auto& e = nodeTable[id];
+        if (e.computed) {
+            updateIfNeededCore2(*e.computed);
+        }
+        if (rs.endTimestamp <= e.node->timestamp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReactiveStateEngine::updateAllIfNeeded(const rse::ReadSet& rs)
+{
+    for (auto id : rs.nodes) {
+        if (auto* cnb = nodeTable[id].computed) {
+            updateIfNeededCore2(*cnb);
+        }
+    }
+}
+
 bool ReactiveStateEngine::updateIfNeededCore2(const rse::ComputedNodeBase& vk)
 {
     if (vk.upToDate) {
@@ -59,16 +184,9 @@ bool ReactiveStateEngine::updateIfNeededCore2(const rse::ComputedNodeBase& vk)
         // If this is up-to-date, the upstream variables
         // - must be all up-to-date
         // - they must not have a timestamp greater than upstreamProcessedUntilTimestamp.
-        for (auto& uv : vk.upstreamNodes) {
-            switch_variant(
-              uv,
-              [&](const rse::NodeBase* x) {
-                  CHECK(x->timestamp <= vk.upstreamProcessedUntilTimestamp);
-              },
-              [&](const rse::ComputedNodeBase* x) {
-                  CHECK(x->upToDate && x->timestamp <= vk.upstreamProcessedUntilTimestamp);
-              }
-            );
+        for (auto u : upstreamEdges(vk)) {
+            auto& e = nodeTable[u];
+            CHECK((!e.computed || e.computed->upToDate) && e.node->timestamp <= vk.upstreamProcessedUntilTimestamp);
         }
 #endif
         return false;
@@ -78,31 +196,33 @@ bool ReactiveStateEngine::updateIfNeededCore2(const rse::ComputedNodeBase& vk)
 
 #ifndef NDEBUG
     // If this is not up-to-date, the downstream variables must be out-of-date, too.
-    for (auto* dv : vk.downstreamNodes) {
-        CHECK(!dv->upToDate);
+    rebuildDownstreamEdgesIfNeeded();
+    for (auto d : downstreamEdges(vk.id)) {
+        CHECK(!nodeTable[d].computed->upToDate);
     }
 #endif
 
     // Make sure all upstream dependencies are up-to-date.
     auto maxUpstreamTimestamp = vk.upstreamProcessedUntilTimestamp;
-    for (auto& uv : vk.upstreamNodes) {
-        switch_variant(
-          uv,
-          [&](const rse::NodeBase* x) {
-              if (maxUpstreamTimestamp < x->timestamp) {
-                  maxUpstreamTimestamp = x->timestamp;
-              }
-          },
-          [&](const rse::ComputedNodeBase* x) {
-              if (updateIfNeededCore2(*x) || maxUpstreamTimestamp < x->timestamp) {
-                  assert(maxUpstreamTimestamp < x->timestamp);
-                  maxUpstreamTimestamp = x->timestamp;
-              }
-          }
-        );
-    }
-    bool changed = vk.upstreamProcessedUntilTimestamp < maxUpstreamTimestamp && vk.computeAndUpdateIfDifferentFn();
+    for (auto i = vk.upstreamEdgesBegin; i < vk.upstreamEdgesEnd; ++i) {
+        auto& e = nodeTable[upstreamEdgeArena[i]];
+        if (e.computed) {
+            if (updateIfNeededCore2(*e.computed) || maxUpstreamTimestamp < e.node->timestamp) {
+                assert(maxUpstreamTimestamp < e.node->timestamp);
+                maxUpstreamTimestamp = e.node->timestamp;
+            }
+        } else if (maxUpstreamTimestamp < e.node->timestamp) {
+            maxUpstreamTimestamp = e.node->timestamp;
+        }
+    }
     auto& vkMutable = const_cast<rse::ComputedNodeBase&>(vk);
+    bool changed = false;
+    if (vk.upstreamProcessedUntilTimestamp < maxUpstreamTimestamp) {
+        changed = profilingEnabled ? computeAndUpdateIfDifferentProfiled(vkMutable)
+                                   : vkMutable.computeAndUpdateIfDifferentFn(vkMutable);
+    } else if (profilingEnabled) {
+        ++nodeProfiles[vk.id].numSkipped;
+    }
     if (changed) {
         vkMutable.timestamp = nextTimestamp++;
     }
@@ -115,26 +235,19 @@ void ReactiveStateEngine::registerUpdaterCore_prepare(rse::ComputedNodeBase& v)
 {
     CHECK(!v.computeAndUpdateIfDifferentFn);
     CHECK(!inputCollectorDuringRegistration);
+    nodeIdOf(v, &v);
     inputCollectorDuringRegistration.emplace();
 }
 
 void ReactiveStateEngine::registerUpdaterCore_finalize(rse::ComputedNodeBase& v)
 {
-    v.upstreamNodes = MOVE(inputCollectorDuringRegistration.value());
+    auto upstreamNodes = MOVE(inputCollectorDuringRegistration.value());
     inputCollectorDuringRegistration.reset();
-    sortUniqueInplace(v.upstreamNodes);
-    for (auto& uv : v.upstreamNodes) {
-        const_cast<rse::NodeBase*>(switch_variant(
-                                     uv,
-                                     [](const rse::NodeBase* x) {
-                                         return x;
-                                     },
-                                     [](const rse::ComputedNodeBase* x) -> const rse::NodeBase* {
-                                         return x;
-                                     }
-                                   )
-        )->addDownstreamNode(&v);
-    }
+    sortUniqueInplace(upstreamNodes);
+    v.upstreamEdgesBegin = intCast<uint32_t>(upstreamEdgeArena.size());
+    upstreamEdgeArena.insert(upstreamEdgeArena.end(), upstreamNodes.begin(), upstreamNodes.end());
+    v.upstreamEdgesEnd = intCast<uint32_t>(upstreamEdgeArena.size());
+    downstreamEdgesOutOfDate = true;
 }
 
 rse::ScopedUndoables ReactiveStateEngine::beginUndoables()
@@ -149,31 +262,32 @@ void ReactiveStateEngine::finishUndoables()
     CHECK(undoablesCollector);
     undoablesCollector->executeRedo();
     if (!undoablesCollector->undoRedoOps.empty()) {
-        undoRedoHistory.push_back(UndoRedoNode(MOVE(*undoablesCollector)));
+        pushToUndoRedoHistory(UndoRedoNode(MOVE(*undoablesCollector)));
     }
     undoablesCollector.reset();
 }
 
-ReactiveStateEngine::UndoRedoNodeBase::UndoRedoNodeBase(function<void()> undoFn, function<void()> redoFn)
-    : undoRedoOps({pair(MOVE(undoFn), MOVE(redoFn))})
+ReactiveStateEngine::UndoRedoNodeBase::UndoRedoNodeBase(UndoRedoOp op)
 {
+    pushBack(MOVE(op));
 }
 
-void ReactiveStateEngine::UndoRedoNodeBase::pushBack(function<void()> undoFn, function<void()> redoFn)
+void ReactiveStateEngine::UndoRedoNodeBase::pushBack(UndoRedoOp op)
 {
-    undoRedoOps.push_back(pair(MOVE(undoFn), MOVE(redoFn)));
+    memoryUsage += sizeof(UndoRedoOp) + op.memoryUsage;
+    undoRedoOps.push_back(MOVE(op));
 }
 
 void ReactiveStateEngine::UndoRedoNodeBase::executeUndo()
 {
     for (auto it = undoRedoOps.rbegin(); it != undoRedoOps.rend(); ++it) {
-        it->first();
+        it->fn(UndoOrRedo::undo);
     }
 }
 void ReactiveStateEngine::UndoRedoNodeBase::executeRedo()
 {
     for (auto& op : undoRedoOps) {
-        op.second();
+        op.fn(UndoOrRedo::redo);
     }
 }
 
@@ -184,21 +298,215 @@ ReactiveStateEngine::UndoRedoNode::UndoRedoNode(UndoRedoNodeBase base)
 {
 }
 
-ReactiveStateEngine::UndoRedoNode::UndoRedoNode(function<void()> undoFn, function<void()> redoFn)
-    : UndoRedoNodeBase(MOVE(undoFn), MOVE(redoFn))
-    , systemTimePoint(chr::system_clock::now())
-    , steadyTimePoint(chr::steady_clock::now())
+void ReactiveStateEngine::undoableOpReceived(UndoRedoOp op)
 {
+    if (undoablesCollector) {
+        undoablesCollector->pushBack(MOVE(op));
+    } else {
+        op.fn(UndoOrRedo::redo);
+        pushToUndoRedoHistory(UndoRedoNode(UndoRedoNodeBase(MOVE(op))));
+    }
 }
 
-void ReactiveStateEngine::undoableOpReceived(function<void()> undoFn, function<void()> redoFn)
+void ReactiveStateEngine::pushToUndoRedoHistory(UndoRedoNode node)
 {
-    if (undoablesCollector) {
-        undoablesCollector->pushBack(MOVE(undoFn), MOVE(redoFn));
-    } else {
-        redoFn();
-        undoRedoHistory.erase(nextNodeToRedo, undoRedoHistory.end());
-        undoRedoHistory.push_back(UndoRedoNode(MOVE(undoFn), MOVE(redoFn)));
-        nextNodeToRedo = undoRedoHistory.end();
+    // Pushing a new node discards the redoable nodes.
+    for (size_t i = nextNodeToRedoIx; i < undoRedoHistory.size(); ++i) {
+        undoRedoHistoryMemoryUsage -= undoRedoHistory[i].memoryUsage;
+    }
+    undoRedoHistory.erase(undoRedoHistory.begin() + intCast<ptrdiff_t>(nextNodeToRedoIx), undoRedoHistory.end());
+
+    // The new node has already been executed. If it's a lone `setWithUndo` on the same node as the previous lone
+    // `setWithUndo`, the previous one still holds the value before both of them, so the new one can be dropped. Once
+    // undone the previous one holds the new value instead, so its estimate must cover the larger of the two.
+    if (undoCoalescingInterval > chr::steady_clock::duration::zero() && !undoRedoHistory.empty()) {
+        auto& last = undoRedoHistory.back();
+        if (last.undoRedoOps.size() == 1 && node.undoRedoOps.size() == 1 && last.undoRedoOps[0].coalescable
+            && node.undoRedoOps[0].coalescable && last.undoRedoOps[0].node == node.undoRedoOps[0].node
+            && node.steadyTimePoint - last.steadyTimePoint < undoCoalescingInterval) {
+            auto& lastOp = last.undoRedoOps[0];
+            auto memoryUsage = std::max(lastOp.memoryUsage, node.undoRedoOps[0].memoryUsage);
+            undoRedoHistoryMemoryUsage += memoryUsage - lastOp.memoryUsage;
+            last.memoryUsage += memoryUsage - lastOp.memoryUsage;
+            lastOp.memoryUsage = memoryUsage;
+            last.steadyTimePoint = node.steadyTimePoint;
+            ++numCoalescedUndoRedoNodes;
+            evictUndoRedoHistoryOverBudget();
+            return;
+        }
+    }
+
+    undoRedoHistoryMemoryUsage += node.memoryUsage;
+    undoRedoHistory.push_back(MOVE(node));
+    nextNodeToRedoIx = undoRedoHistory.size();
+    evictUndoRedoHistoryOverBudget();
+}
+
+void ReactiveStateEngine::evictUndoRedoHistoryOverBudget()
+{
+    // Only undoable nodes can be evicted, a redoable node can't be executed without the ones before it.
+    while (nextNodeToRedoIx > 0 && undoRedoHistory.size() > 1
+           && undoRedoHistoryMemoryUsage > undoRedoHistoryMemoryBudget) {
+        undoRedoHistoryMemoryUsage -= undoRedoHistory.front().memoryUsage;
+        undoRedoHistory.pop_front();
+        --nextNodeToRedoIx;
+        ++numEvictedUndoRedoNodes;
+    }
+}
+
+bool ReactiveStateEngine::canUndo() const
+{
+    return !undoablesCollector && nextNodeToRedoIx > 0;
+}
+
+bool ReactiveStateEngine::canRedo() const
+{
+    return !undoablesCollector && nextNodeToRedoIx < undoRedoHistory.size();
+}
+
+void ReactiveStateEngine::undo()
+{
+    CHECK_OR_RETURN(canUndo());
+    undoRedoHistory[--nextNodeToRedoIx].executeUndo();
+}
+
+void ReactiveStateEngine::redo()
+{
+    CHECK_OR_RETURN(canRedo());
+    undoRedoHistory[nextNodeToRedoIx++].executeRedo();
+}
+
+void ReactiveStateEngine::clearUndoHistory()
+{
+    CHECK(!undoablesCollector);
+    undoRedoHistory.clear();
+    nextNodeToRedoIx = 0;
+    undoRedoHistoryMemoryUsage = 0;
+}
+
+void ReactiveStateEngine::setUndoHistoryMemoryBudget(size_t bytes)
+{
+    undoRedoHistoryMemoryBudget = bytes;
+    evictUndoRedoHistoryOverBudget();
+}
+
+void ReactiveStateEngine::setUndoCoalescingInterval(chr::steady_clock::duration d)
+{
+    undoCoalescingInterval = d;
+}
+
+ReactiveStateEngine::UndoHistoryStats ReactiveStateEngine::undoHistoryStats() const
+{
+    return UndoHistoryStats{
+      .numEntries = undoRedoHistory.size(),
+      .numRedoableEntries = undoRedoHistory.size() - nextNodeToRedoIx,
+      .memoryUsage = undoRedoHistoryMemoryUsage,
+      .memoryBudget = undoRedoHistoryMemoryBudget,
+      .numEvictedEntries = numEvictedUndoRedoNodes,
+      .numCoalescedEntries = numCoalescedUndoRedoNodes
+    };
+}
+
+bool ReactiveStateEngine::computeAndUpdateIfDifferentProfiled(rse::ComputedNodeBase& cnb)
+{
+    auto t0 = chr::steady_clock::now();
+    bool changed = cnb.computeAndUpdateIfDifferentFn(cnb);
+    auto dt = chr::steady_clock::now() - t0;
+    auto& p = nodeProfiles[cnb.id];
+    ++p.numRecomputes;
+    if (changed) {
+        ++p.numChanged;
+    }
+    p.totalTime += dt;
+    p.maxTime = std::max(p.maxTime, dt);
+    return changed;
+}
+
+void ReactiveStateEngine::setNodeName(const rse::NodeBase& nb, string name)
+{
+    nodeNames[&nb] = MOVE(name);
+}
+
+void ReactiveStateEngine::enableProfiling(bool b)
+{
+    profilingEnabled = b;
+    if (profilingEnabled) {
+        nodeProfiles.resize(nodeTable.size());
+    }
+}
+
+void ReactiveStateEngine::resetProfile()
+{
+    nodeProfiles.assign(profilingEnabled ? nodeTable.size() : 0, NodeProfile{});
+}
+
+const ReactiveStateEngine::NodeProfile* ReactiveStateEngine::nodeProfile(const rse::NodeBase& nb) const
+{
+    if (nb.id == 0 || nodeProfiles.size() <= nb.id || !nodeTable[nb.id].computed) {
+        return nullptr;
+    }
+    return &nodeProfiles[nb.id];
+}
+
+string ReactiveStateEngine::nodeNameForDump(const rse::NodeBase* nb) const
+{
+    auto it = nodeNames.find(nb);
+    return escapeForJsonOrDot(it == nodeNames.end() ? fmt::format("{}", fmt::ptr(nb)) : it->second);
+}
+
+string ReactiveStateEngine::dumpGraphAsGraphviz() const
+{
+    const_cast<ReactiveStateEngine*>(this)->rebuildDownstreamEdgesIfNeeded();
+    string r = "digraph rse {\n";
+    for (rse::NodeId id : vi::iota(rse::NodeId(1), intCast<rse::NodeId>(nodeTable.size()))) {
+        auto& e = nodeTable[id];
+        string label = nodeNameForDump(e.node);
+        if (auto* p = nodeProfile(*e.node)) {
+            label += fmt::format(
+              "\\nrecomputed: {}, changed: {}, skipped: {}\\ntotal: {:.3f} ms, max: {:.3f} ms",
+              p->numRecomputes,
+              p->numChanged,
+              p->numSkipped,
+              toMs(p->totalTime),
+              toMs(p->maxTime)
+            );
+        }
+        r += fmt::format("  n{} [shape={}, label=\"{}\"];\n", id, e.computed ? "ellipse" : "box", label);
+    }
+    for (rse::NodeId id : vi::iota(rse::NodeId(1), intCast<rse::NodeId>(nodeTable.size()))) {
+        for (auto d : downstreamEdges(id)) {
+            r += fmt::format("  n{} -> n{};\n", id, d);
+        }
+    }
+    r += "}\n";
+    return r;
+}
+
+string ReactiveStateEngine::dumpGraphAsJson() const
+{
+    const_cast<ReactiveStateEngine*>(this)->rebuildDownstreamEdgesIfNeeded();
+    vector<string> nodeJsons;
+    for (rse::NodeId id : vi::iota(rse::NodeId(1), intCast<rse::NodeId>(nodeTable.size()))) {
+        auto& e = nodeTable[id];
+        string profile = "null";
+        if (auto* p = nodeProfile(*e.node)) {
+            profile = fmt::format(
+              R"({{"recomputes": {}, "changed": {}, "skipped": {}, "totalMs": {}, "maxMs": {}}})",
+              p->numRecomputes,
+              p->numChanged,
+              p->numSkipped,
+              toMs(p->totalTime),
+              toMs(p->maxTime)
+            );
+        }
+        nodeJsons.push_back(fmt::format(
+          R"({{"id": {}, "name": "{}", "computed": {}, "downstream": [{}], "profile": {}}})",
+          id,
+          nodeNameForDump(e.node),
+          e.computed != nullptr,
+          fmt::join(downstreamEdges(id), ", "),
+          profile
+        ));
     }
+    return fmt::format("{{\"nodes\": [\n  {}\n]}}\n", fmt::join(nodeJsons, ",\n  "));
 }
@@ -31,7 +31,8 @@ class ReactiveStateEngine;
 namespace rse
 {
 
-class ComputedNodeBase;
+// Index of a node in the engine's node table. 0 means the engine hasn't seen the node yet.
+using NodeId = uint32_t;
 
 class NodeBase
 {
@@ -39,32 +40,109 @@ class NodeBase
 
 protected:
     NodeBase() = default;
-    // One node can only be added only once.
-    void addDownstreamNode(ComputedNodeBase* downstreamNode);
-    void setTimestampAndMarkDownstreamNodesOutOfDate(uint64_t newTimestamp);
 
-    uint64_t timestamp = 1;
-    vector<ComputedNodeBase*> downstreamNodes; // Variables dependending on this variable.
+    // The timestamp of the nodes which haven't been changed yet, the engine's timestamps start after it.
+    static constexpr uint64_t k_initialTimestamp = 1;
+
+    uint64_t timestamp = k_initialTimestamp;
+    mutable NodeId id = 0;
 };
 
 class ComputedNodeBase;
-using UpstreamNode = variant<const rse::NodeBase*, rse::ComputedNodeBase*>;
+
+template<class V, class Fn>
+struct UpdaterFnOps;
+
+// Type-erased updater of a `Computed<V>` node: calls the compute function and stores the result in the node if it's
+// different. It's a single indirect call and the compute function is stored inline if it fits (a `[this]` lambda does),
+// otherwise on the heap.
+class UpdaterFn
+{
+public:
+    static constexpr size_t k_inlineSize = 3 * sizeof(void*);
+
+    struct Ops {
+        bool (*invoke)(void* storage, ComputedNodeBase& node);
+        void (*moveAndDestroy)(void* from, void* to) noexcept;
+        void (*destroy)(void* storage) noexcept;
+    };
+
+    UpdaterFn() = default;
+    UpdaterFn(const UpdaterFn&) = delete;
+    void operator=(const UpdaterFn&) = delete;
+    UpdaterFn(UpdaterFn&& y) noexcept
+    {
+        *this = MOVE(y);
+    }
+    UpdaterFn& operator=(UpdaterFn&& y) noexcept
+    {
+        if (this != &y) {
+            reset();
+            if (y.ops) {
+                ops = std::exchange(y.ops, nullptr);
+                ops->moveAndDestroy(y.storage, storage);
+            }
+        }
+        return *this;
+    }
+    ~UpdaterFn()
+    {
+        reset();
+    }
+
+    template<class V, class Fn>
+    static UpdaterFn make(Fn fn)
+    {
+        using FnOps = UpdaterFnOps<V, Fn>;
+        UpdaterFn r;
+        if constexpr (FnOps::k_isInline) {
+            new (r.storage) Fn(MOVE(fn));
+        } else {
+            new (r.storage) Fn*(new Fn(MOVE(fn)));
+        }
+        r.ops = &FnOps::k_ops;
+        return r;
+    }
+
+    explicit operator bool() const
+    {
+        return ops != nullptr;
+    }
+
+    // Return true if the value of the node has changed.
+    bool operator()(ComputedNodeBase& node)
+    {
+        return ops->invoke(storage, node);
+    }
+
+private:
+    alignas(void*) std::byte storage[k_inlineSize];
+    const Ops* ops = nullptr;
+
+    void reset()
+    {
+        if (ops) {
+            ops->destroy(storage);
+            ops = nullptr;
+        }
+    }
+};
 
 class ComputedNodeBase : public NodeBase
 {
     friend class ::ReactiveStateEngine;
-    friend class NodeBase;
 
 protected:
     ComputedNodeBase() = default;
-    void markThisAndDownstreamNodesOutOfDate();
 
     bool upToDate = false;
+    // Range in the engine's upstream edge arena: the nodes which this node's computeAndUpdateIfDifferentFn uses as
+    // input.
+    uint32_t upstreamEdgesBegin = 0, upstreamEdgesEnd = 0;
     // If the input nodes' timestamps are not greater than this value, this node doesn't need to be recomputed and
     // can be marked up to date.
     uint64_t upstreamProcessedUntilTimestamp = 0;
-    vector<UpstreamNode> upstreamNodes; // Nodes which this nodes's computeAndUpdateIfDifferentFn uses as input.
-    function<bool()> computeAndUpdateIfDifferentFn; // Return true if changed.
+    UpdaterFn computeAndUpdateIfDifferentFn; // Return true if changed.
 };
 
 // An inner node in the graph, it holds a value which can only be changed through a registered updater function which is
@@ -74,9 +152,55 @@ class Computed : public ComputedNodeBase
 {
 private:
     friend class ::ReactiveStateEngine;
+    template<class, class>
+    friend struct UpdaterFnOps;
     V v;
 };
 
+template<class V, class Fn>
+struct UpdaterFnOps {
+    static constexpr bool k_isInline = sizeof(Fn) <= UpdaterFn::k_inlineSize && alignof(Fn) <= alignof(void*)
+                                    && std::is_nothrow_move_constructible_v<Fn>;
+
+    static Fn& fn(void* storage)
+    {
+        if constexpr (k_isInline) {
+            return *std::launder(static_cast<Fn*>(storage));
+        } else {
+            return **static_cast<Fn**>(storage);
+        }
+    }
+    static bool invoke(void* storage, ComputedNodeBase& node)
+    {
+        auto& k = static_cast<Computed<V>&>(node);
+        V newValue = fn(storage)();
+        if (newValue == k.v) {
+            return false;
+        }
+        k.v = MOVE(newValue);
+        return true;
+    }
+    static void moveAndDestroy(void* from, void* to) noexcept
+    {
+        if constexpr (k_isInline) {
+            new (to) Fn(MOVE(fn(from)));
+            fn(from).~Fn();
+        } else {
+            new (to) Fn*(*static_cast<Fn**>(from));
+        }
+    }
+    static void destroy(void* storage) noexcept
+    {
+        if constexpr (k_isInline) {
+            fn(storage).~Fn();
+        } else {
+            delete *static_cast<Fn**>(storage);
+        }
+    }
+
+    static constexpr UpdaterFn::Ops k_ops{.invoke = &invoke, .moveAndDestroy = &moveAndDestroy, .destroy = &destroy};
+};
+
 // A node whose value is set from the outside. It has simple value semantics, can be set (through ReactiveStateEngine)
 // as a whole.
 template<class V>
@@ -110,15 +234,21 @@ private:
     V v;
 };
 
+// The nodes read through `ReactiveStateEngine::get` between `beginRecordingReads` and `endRecordingReads`.
+struct ReadSet {
+    vector<NodeId> nodes;
+    uint64_t endTimestamp = 0; // Nodes changed after the recording have a timestamp not less than this.
+};
+
+// Rough estimate of the memory held by a value: its own size plus the elements of a sized range, not recursing into
+// the elements. Used for budgeting the undo history.
 template<class T>
-UpstreamNode asUpstreamNodePointer(T& x)
+size_t approximateMemoryUsage(const T& x)
 {
-    static_assert(std::is_base_of_v<NodeBase, T>, "Only types derived from NodeBase are allowed.");
-    if constexpr (std::is_base_of_v<ComputedNodeBase, T>) {
-        auto* nonConstXPointer = const_cast<std::remove_const_t<T>*>(&x);
-        return static_cast<ComputedNodeBase*>(nonConstXPointer);
+    if constexpr (ra::sized_range<const T>) {
+        return sizeof(T) + ra::size(x) * sizeof(ra::range_value_t<const T>);
     } else {
-        return static_cast<const NodeBase*>(&x);
+        return sizeof(T);
     }
 }
 
@@ -152,17 +282,19 @@ public:
     template<class V, class Fn>
     void registerUpdater(rse::Computed<V>& k, Fn computeFn)
     {
-        registerUpdaterCore(k, function<V()>(MOVE(computeFn)), nullopt);
+        registerUpdaterCore_prepare(k);
+        computeFn();
+        k.computeAndUpdateIfDifferentFn = rse::UpdaterFn::make<V>(MOVE(computeFn));
+        registerUpdaterCore_finalize(k);
     }
 
     template<class V, class Fn, class... UpstreamNodes>
     void registerUpdater(rse::Computed<V>& k, Fn computeFn, const UpstreamNodes&... upstreamNodes)
     {
-        registerUpdaterCore(
-          k,
-          function<V()>(MOVE(computeFn)),
-          initializer_list<rse::UpstreamNode>{rse::asUpstreamNodePointer(upstreamNodes)...}
-        );
+        registerUpdaterCore_prepare(k);
+        (addToInputCollector(upstreamNodes), ...);
+        k.computeAndUpdateIfDifferentFn = rse::UpdaterFn::make<V>(MOVE(computeFn));
+        registerUpdaterCore_finalize(k);
     }
 
     // Return true if it had to be updated (the value has changed during the update).
@@ -192,11 +324,27 @@ public:
         return k.v;
     }
 
+    // Record which nodes are read with `get` (but not the ones read by the updater functions invoked meanwhile), for
+    // example by a UI frame, then use `hasAnyChangedSince` to find out if any of them has changed since.
+    void beginRecordingReads();
+    rse::ReadSet endRecordingReads();
+    // Brings the computed nodes of the read set up-to-date, until the first changed one.
+    bool hasAnyChangedSince(const rse::ReadSet& rs);
+    // Brings all computed nodes of the read set up-to-date.
+    void updateAllIfNeeded(const rse::ReadSet& rs);
+
     bool isUpToDate(const rse::ComputedNodeBase& k)
     {
         return k.upToDate;
     }
 
+    // Changes whenever the value of the node changes. Cheaper than recording reads when data derived from a single node
+    // needs to be rebuilt. Computed nodes must be brought up-to-date first, with `get`.
+    uint64_t changeTimestamp(const rse::NodeBase& k) const
+    {
+        return k.timestamp;
+    }
+
     // Assign new value to the variable, and mark all transitive dependencies outdated if the new value is different
     // from the current one.
     template<class K, class V>
@@ -206,7 +354,7 @@ public:
             return false;
         }
         k.v = std::forward<V>(newValue);
-        k.setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
         return true;
     }
     // Like `set` but do not compare new value to the existing value, always assume that it has changed.
@@ -216,7 +364,7 @@ public:
     void setAsDifferent(rse::Value<K>& k, V&& newValue)
     {
         k.v = std::forward<V>(newValue);
-        k.setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
     }
     // Set new value and return old value.
     template<class K, class V>
@@ -227,7 +375,7 @@ public:
         }
         auto oldValue = MOVE(k.v);
         k.v = std::forward<V>(newValue);
-        k.setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
         return oldValue;
     }
     // Assume K is a map with std interface. Return the return value of K::insert()
@@ -236,16 +384,39 @@ public:
     {
         auto itb = k.v.insert(MOVE(newValue));
         if (itb.second) {
-            k.setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+            setTimestampAndMarkDownstreamNodesOutOfDate(k);
         }
         return itb;
     }
+    // Assume K is a map with std interface. Insert the new entries as a single change. Return the number inserted.
+    template<class K, class Key, class Value>
+    size_t insertAll(rse::Value<K>& k, vector<pair<Key, Value>> newValues)
+    {
+        size_t n = 0;
+        for (auto& x : newValues) {
+            if (k.v.insert(MOVE(x)).second) {
+                ++n;
+            }
+        }
+        if (n > 0) {
+            setTimestampAndMarkDownstreamNodesOutOfDate(k);
+        }
+        return n;
+    }
+    // Assume K is a map with std interface. Modify the value at an existing key in place, for values which are
+    // expensive to copy or compare.
+    template<class K, class Key, class Fn>
+    void modifyAt(rse::Value<K>& k, const Key& key, Fn&& fn)
+    {
+        fn(k.v.at(key));
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
+    }
     // Assume K is a container with push_back.
     template<class K, class Value>
     void pushBack(rse::Value<K>& k, Value&& newValue)
     {
         k.v.push_back(std::forward<Value>(newValue));
-        k.setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
     }
     // Assume K is a map with std interface.
     template<class K, class Key, class Value>
@@ -254,29 +425,46 @@ public:
         if (k.v.contains(newValue.first)) {
             return;
         }
-        auto undoFn = [this, kInUndo = &k, newValueFirst = newValue.first]() mutable {
-            kInUndo->v.erase(newValueFirst);
-            kInUndo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
-        };
-        auto redoFn = [this, kInRedo = &k, newValueInRedo = MOVE(newValue)]() mutable {
-            kInRedo->v.insert(newValueInRedo);
-            kInRedo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        auto memoryUsage = rse::approximateMemoryUsage(newValue);
+        // Copied before the lambda: the init-captures are initialized in unspecified order.
+        auto key = newValue.first;
+        // The op owns the inserted pair only while it's undone, otherwise it lives in the map.
+        auto undoRedoFn = [this, &k, key = MOVE(key), removedValue = optional(MOVE(newValue))](
+                            UndoOrRedo d
+                          ) mutable {
+            switch (d) {
+            case UndoOrRedo::undo: {
+                auto nh = k.v.extract(key);
+                removedValue.emplace(key, MOVE(nh.mapped()));
+            } break;
+            case UndoOrRedo::redo:
+                k.v.insert(MOVE(*removedValue));
+                removedValue.reset();
+                break;
+            }
+            setTimestampAndMarkDownstreamNodesOutOfDate(k);
         };
-        undoableOpReceived(MOVE(undoFn), MOVE(redoFn));
+        undoableOpReceived(UndoRedoOp{.fn = MOVE(undoRedoFn), .node = &k, .memoryUsage = memoryUsage});
     }
     // Assume K is a container with push_back.
     template<class K, class Value>
     void pushBackWithUndo(rse::UndoableValue<K>& k, Value newValue)
     {
-        auto undoFn = [this, kInUndo = &k]() mutable {
-            kInUndo->v.pop_back();
-            kInUndo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
-        };
-        auto redoFn = [this, kInRedo = &k, newValueInRedo = MOVE(newValue)]() mutable {
-            kInRedo->v.push_back(newValueInRedo);
-            kInRedo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        auto memoryUsage = rse::approximateMemoryUsage(newValue);
+        auto undoRedoFn = [this, &k, removedValue = optional(MOVE(newValue))](UndoOrRedo d) mutable {
+            switch (d) {
+            case UndoOrRedo::undo:
+                removedValue.emplace(MOVE(k.v.back()));
+                k.v.pop_back();
+                break;
+            case UndoOrRedo::redo:
+                k.v.push_back(MOVE(*removedValue));
+                removedValue.reset();
+                break;
+            }
+            setTimestampAndMarkDownstreamNodesOutOfDate(k);
         };
-        undoableOpReceived(MOVE(undoFn), MOVE(redoFn));
+        undoableOpReceived(UndoRedoOp{.fn = MOVE(undoRedoFn), .node = &k, .memoryUsage = memoryUsage});
     }
     template<class K, class Value>
     void setWithUndo(rse::UndoableValue<K>& k, Value newValue)
@@ -284,30 +472,94 @@ public:
         if (newValue == k.v) {
             return;
         }
-        auto undoFn = [this, kInUndo = &k, oldValue = k.v]() mutable {
-            kInUndo->v = oldValue;
-            kInUndo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
-        };
-        auto redoFn = [this, kInRedo = &k, newValueInRedo = MOVE(newValue)]() mutable {
-            kInRedo->v = newValueInRedo;
-            kInRedo->setTimestampAndMarkDownstreamNodesOutOfDate(nextTimestamp++);
+        auto memoryUsage = std::max(rse::approximateMemoryUsage(k.v), rse::approximateMemoryUsage(newValue));
+        // Undo and redo are both a swap between the node and the op, so the op holds a single value: the new one
+        // before it's applied, the old one after.
+        auto undoRedoFn = [this, &k, otherValue = K(MOVE(newValue))](UndoOrRedo) mutable {
+            std::swap(k.v, otherValue);
+            setTimestampAndMarkDownstreamNodesOutOfDate(k);
         };
-        undoableOpReceived(MOVE(undoFn), MOVE(redoFn));
+        undoableOpReceived(
+          UndoRedoOp{.fn = MOVE(undoRedoFn), .node = &k, .memoryUsage = memoryUsage, .coalescable = true}
+        );
     }
 
+    // Replace the value of an undoable node without recording it, e.g. when loading a document. The history may refer
+    // to the old value so it must have been cleared with `clearUndoHistory`.
+    template<class K, class V>
+    void setWithoutUndo(rse::UndoableValue<K>& k, V&& newValue)
+    {
+        CHECK(undoRedoHistory.empty() && !undoablesCollector);
+        k.v = std::forward<V>(newValue);
+        setTimestampAndMarkDownstreamNodesOutOfDate(k);
+    }
+
+    bool canUndo() const;
+    bool canRedo() const;
+    void undo();
+    void redo();
+    void clearUndoHistory();
+
+    // The oldest undo history entries are evicted when the estimated memory usage of the history exceeds the budget.
+    // The most recent entry is always kept.
+    void setUndoHistoryMemoryBudget(size_t bytes);
+    // Consecutive `setWithUndo` calls (outside of `beginUndoables`) on the same node within this interval are merged
+    // into a single history entry. Zero disables coalescing.
+    void setUndoCoalescingInterval(chr::steady_clock::duration d);
+
+    struct UndoHistoryStats {
+        size_t numEntries = 0;
+        size_t numRedoableEntries = 0;
+        size_t memoryUsage = 0; // Estimated, see rse::approximateMemoryUsage.
+        size_t memoryBudget = 0;
+        size_t numEvictedEntries = 0;
+        size_t numCoalescedEntries = 0;
+    };
+    UndoHistoryStats undoHistoryStats() const;
+
     rse::ScopedUndoables beginUndoables();
 
+    // Optional instrumentation of the updater functions, for finding slow or needlessly recomputed nodes.
+    struct NodeProfile {
+        size_t numRecomputes = 0; // The updater function was called.
+        size_t numChanged = 0; // The updater function returned a value different from the previous one.
+        size_t numSkipped = 0; // The node was out-of-date but none of its upstream nodes have changed.
+        chr::steady_clock::duration totalTime{};
+        chr::steady_clock::duration maxTime{};
+    };
+    // Names are only used in the graph dumps.
+    void setNodeName(const rse::NodeBase& nb, string name);
+    void enableProfiling(bool b);
+    void resetProfile();
+    // Return nullptr if there's no profile recorded for the node.
+    const NodeProfile* nodeProfile(const rse::NodeBase& nb) const;
+    // Dump the nodes known to the engine (registered computed nodes and their upstream nodes) and the profile.
+    string dumpGraphAsGraphviz() const;
+    string dumpGraphAsJson() const;
+
 private:
     friend class rse::ScopedUndoables;
 
+    enum class UndoOrRedo {
+        undo,
+        redo
+    };
+    struct UndoRedoOp {
+        function<void(UndoOrRedo)> fn;
+        const rse::NodeBase* node;
+        size_t memoryUsage;
+        bool coalescable = false;
+    };
+
     struct UndoRedoNodeBase {
         // Not sure if it'll ever matter but execute undoOps in reverse order.
-        vector<pair<function<void()>, function<void()>>> undoRedoOps;
+        vector<UndoRedoOp> undoRedoOps;
+        size_t memoryUsage = 0;
 
         UndoRedoNodeBase() = default;
-        UndoRedoNodeBase(function<void()> undoFn, function<void()> redoFn);
+        explicit UndoRedoNodeBase(UndoRedoOp op);
 
-        void pushBack(function<void()> undoFn, function<void()> redoFn);
+        void pushBack(UndoRedoOp op);
 
         void executeUndo();
         void executeRedo();
@@ -316,47 +568,71 @@ private:
         chr::system_clock::time_point systemTimePoint;
         chr::steady_clock::time_point steadyTimePoint;
         explicit UndoRedoNode(UndoRedoNodeBase base);
-        UndoRedoNode(function<void()> undoFn, function<void()> redoFn);
     };
 
-    optional<vector<rse::UpstreamNode>> inputCollectorDuringRegistration;
-    uint64_t nextTimestamp = 1; // timestamp = 0 means uninitialized
+    struct NodeTableEntry {
+        rse::NodeBase* node;
+        rse::ComputedNodeBase* computed; // nullptr for Value and UndoableValue nodes.
+    };
+    vector<NodeTableEntry> nodeTable{NodeTableEntry{nullptr, nullptr}}; // Indexed by NodeId, 0 is unused.
+    vector<rse::NodeId> upstreamEdgeArena; // See ComputedNodeBase::upstreamEdgesBegin/End.
+    // The downstream edges of node `id` are
+    // downstreamEdgeArena[downstreamEdgeOffsets[id], downstreamEdgeOffsets[id+1]).
+    // Rebuilt from the upstream edges on the first use after a registration.
+    vector<uint32_t> downstreamEdgeOffsets;
+    vector<rse::NodeId> downstreamEdgeArena;
+    bool downstreamEdgesOutOfDate = false;
+
+    optional<vector<rse::NodeId>> inputCollectorDuringRegistration;
+    optional<rse::ReadSet> readsBeingRecorded;
+    unordered_map<const rse::NodeBase*, string> nodeNames;
+    bool profilingEnabled = false;
+    vector<NodeProfile> nodeProfiles; // Indexed by NodeId.
+    // A node changed or recomputed for the first time must be newer than the nodes still having the initial
+    // timestamp. The upstreamProcessedUntilTimestamp = 0 of a new computed node is older than all of them.
+    uint64_t nextTimestamp = rse::NodeBase::k_initialTimestamp + 1;
     optional<UndoRedoNodeBase> undoablesCollector;
     deque<UndoRedoNode> undoRedoHistory;
-    deque<UndoRedoNode>::iterator nextNodeToRedo = undoRedoHistory.end();
+    size_t nextNodeToRedoIx = 0; // Entries before this index are undoable, from this index are redoable.
+    size_t undoRedoHistoryMemoryUsage = 0;
+    size_t undoRedoHistoryMemoryBudget = size_t(256) << 20;
+    chr::steady_clock::duration undoCoalescingInterval = chr::steady_clock::duration::zero();
+    size_t numEvictedUndoRedoNodes = 0;
+    size_t numCoalescedUndoRedoNodes = 0;
+
+    rse::NodeId nodeIdOf(const rse::NodeBase& nb, rse::ComputedNodeBase* cnb);
+    void rebuildDownstreamEdgesIfNeeded();
+    span<const rse::NodeId> upstreamEdges(const rse::ComputedNodeBase& cnb) const;
+    span<const rse::NodeId> downstreamEdges(rse::NodeId id) const;
+    void setTimestampAndMarkDownstreamNodesOutOfDate(rse::NodeBase& nb);
+    void markDownstreamNodesOutOfDate(rse::NodeId id);
 
     void addToInputCollectorIfNeeded(const rse::NodeBase& nb);
     bool updateIfNeededCore(const rse::ComputedNodeBase& cnb);
     bool updateIfNeededCore2(const rse::ComputedNodeBase& cnb);
+    bool computeAndUpdateIfDifferentProfiled(rse::ComputedNodeBase& cnb);
+    string nodeNameForDump(const rse::NodeBase* nb) const;
 
     void registerUpdaterCore_prepare(rse::ComputedNodeBase& cnb);
     void registerUpdaterCore_finalize(rse::ComputedNodeBase& cnb);
 
     void finishUndoables();
 
-    void undoableOpReceived(function<void()> undoFn, function<void()> redoFn);
+    void undoableOpReceived(UndoRedoOp op);
+    void pushToUndoRedoHistory(UndoRedoNode node);
+    void evictUndoRedoHistoryOverBudget();
 
-    template<class V>
-    void registerUpdaterCore(
-      rse::Computed<V>& k, function<V()> computeFnArg, optional<initializer_list<rse::UpstreamNode>> upstreamNodes
-    )
+    template<class T>
+    void addToInputCollector(const T& x)
     {
-        registerUpdaterCore_prepare(k);
-
-        if (upstreamNodes) {
-            inputCollectorDuringRegistration.value().assign(*upstreamNodes);
+        static_assert(std::is_base_of_v<rse::NodeBase, T>, "Only types derived from NodeBase are allowed.");
+        if constexpr (std::is_base_of_v<rse::ComputedNodeBase, T>) {
+            inputCollectorDuringRegistration->push_back(nodeIdOf(x, &const_cast<T&>(x)));
         } else {
-            computeFnArg();
+            inputCollectorDuringRegistration->push_back(nodeIdOf(x, nullptr));
         }
-        k.computeAndUpdateIfDifferentFn = [&k, computeFn = MOVE(computeFnArg)]() -> bool {
-            auto newValue = computeFn();
-            if (newValue == k.v) {
-                return false;
-            }
-            k.v = MOVE(newValue);
-            return true;
-        };
-
-        registerUpdaterCore_finalize(k);
     }
 };
+
+// Name a node after the expression referring to it, e.g. `RSE_SET_NODE_NAME(rse, appState.tracks)`.
+#define RSE_SET_NODE_NAME(RSE, NODE) (RSE).setNodeName((NODE), #NODE)
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "Id.h"
+#include "common.h"
+
+#include <stdexcept>
+
+// Map from ids to values, with the std::unordered_map interface used in the app. The entries are stored contiguously
+// (iteration is a walk over a vector) and looked up through the dense index of the ids made in this session (see Id).
+// Ids loaded from a project made in another session are looked up in a hash map instead.
+//
+// Ids are never reused, so a stale id (one that has been erased) is never mistaken for a new entry, the id itself acts
+// as the generation. Erasing moves the last entry into the erased one's place, which invalidates iterators and
+// references; iteration order is unspecified, as with std::unordered_map.
+template<class K, class V>
+class SlotMap
+{
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = pair<K, V>;
+    using iterator = typename vector<value_type>::iterator;
+    using const_iterator = typename vector<value_type>::const_iterator;
+
+    // Same as std::unordered_map's node handle, used by ReactiveStateEngine::insertWithUndo.
+    struct node_type {
+        optional<value_type> entry;
+        bool empty() const
+        {
+            return !entry;
+        }
+        const K& key() const
+        {
+            return entry->first;
+        }
+        V& mapped()
+        {
+            return entry->second;
+        }
+    };
+
+    iterator begin()
+    {
+        return entries.begin();
+    }
+    iterator end()
+    {
+        return entries.end();
+    }
+    const_iterator begin() const
+    {
+        return entries.begin();
+    }
+    const_iterator end() const
+    {
+        return entries.end();
+    }
+    size_t size() const
+    {
+        return entries.size();
+    }
+    bool empty() const
+    {
+        return entries.empty();
+    }
+    void reserve(size_t n)
+    {
+        entries.reserve(n);
+    }
+    void clear()
+    {
+        entries.clear();
+        slotOfIndex.clear();
+        slotOfForeignId.clear();
+    }
+
+    iterator find(K k)
+    {
+        auto s = slot(k);
+        return s == k_noSlot ? entries.end() : entries.begin() + ptrdiff_t(s);
+    }
+    const_iterator find(K k) const
+    {
+        auto s = slot(k);
+        return s == k_noSlot ? entries.end() : entries.begin() + ptrdiff_t(s);
+    }
+    bool contains(K k) const
+    {
+        return slot(k) != k_noSlot;
+    }
+    V& at(K k)
+    {
+        return entries[checkedSlot(k)].second;
+    }
+    const V& at(K k) const
+    {
+        return entries[checkedSlot(k)].second;
+    }
+
+    pair<iterator, bool> insert(value_type x)
+    {
+        if (auto s = slot(x.first); s != k_noSlot) {
+            return pair(entries.begin() + ptrdiff_t(s), false);
+        }
+        setSlot(x.first, uint32_t(entries.size()));
+        entries.push_back(MOVE(x));
+        return pair(entries.end() - 1, true);
+    }
+    template<class W>
+    pair<iterator, bool> insert_or_assign(K k, W&& v)
+    {
+        if (auto s = slot(k); s != k_noSlot) {
+            entries[s].second = std::forward<W>(v);
+            return pair(entries.begin() + ptrdiff_t(s), false);
+        }
+        return insert(value_type(k, std::forward<W>(v)));
+    }
+
+    size_t erase(K k)
+    {
+        auto nh = extract(k);
+        return nh.empty() ? 0 : 1;
+    }
+    node_type extract(K k)
+    {
+        const auto s = slot(k);
+        if (s == k_noSlot) {
+            return {};
+        }
+        node_type nh{.entry = MOVE(entries[s])};
+        setSlot(k, k_noSlot);
+        if (s + 1 != entries.size()) {
+            entries[s] = MOVE(entries.back());
+            setSlot(entries[s].first, s);
+        }
+        entries.pop_back();
+        return nh;
+    }
+
+    // Equal if they have the same entries, in any order.
+    bool operator==(const SlotMap& y) const
+    {
+        if (size() != y.size()) {
+            return false;
+        }
+        for (auto& [k, v] : entries) {
+            auto it = y.find(k);
+            if (it == y.end() || !(it->second == v)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static constexpr uint32_t k_noSlot = UINT32_MAX;
+
+    vector<value_type> entries;
+    vector<uint32_t> slotOfIndex; // Indexed by K::index() of the ids of this session.
+    unordered_map<K, uint32_t> slotOfForeignId;
+
+    uint32_t slot(K k) const
+    {
+        if (k.isFromThisSession()) {
+            return k.index() < slotOfIndex.size() ? slotOfIndex[k.index()] : k_noSlot;
+        }
+        auto it = slotOfForeignId.find(k);
+        return it == slotOfForeignId.end() ? k_noSlot : it->second;
+    }
+    uint32_t checkedSlot(K k) const
+    {
+        const auto s = slot(k);
+        if (s == k_noSlot) {
+            throw std::out_of_range("SlotMap::at");
+        }
+        return s;
+    }
+    void setSlot(K k, uint32_t s)
+    {
+        if (k.isFromThisSession()) {
+            if (k.index() >= slotOfIndex.size()) {
+                slotOfIndex.resize(std::max(k.index() + 1, 2 * slotOfIndex.size()), k_noSlot);
+            }
+            slotOfIndex[k.index()] = s;
+        } else if (s == k_noSlot) {
+            slotOfForeignId.erase(k);
+        } else {
+            slotOfForeignId.insert_or_assign(k, s);
+        }
+    }
+};
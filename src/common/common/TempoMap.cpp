@@ -0,0 +1,153 @@
+#include "TempoMap.h"
+
+#include "AppState.h"
+
+namespace
+{
+// ceil(a / b) for b > 0.
+int64_t ceilDiv(int64_t a, int64_t b)
+{
+    return a / b + (a % b > 0 ? 1 : 0);
+}
+
+// The last element of the sorted `xs` whose `proj` is at most `x`, clamped to the first one.
+template<class T, class X, class Proj>
+const T* lastAtOrBefore(span<const T> xs, const X& x, Proj proj)
+{
+    if (xs.empty()) {
+        return nullptr;
+    }
+    auto it = ra::upper_bound(xs, x, {}, proj);
+    return it == xs.begin() ? &xs.front() : &*(it - 1);
+}
+} // namespace
+
+TempoMap::TempoMap(
+  const SlotMap<Id<Section>, Section>& sections,
+  const vector<Id<Section>>& sectionOrder,
+  Rational defaultTempo,
+  int defaultBeatUnit,
+  int64_t sampleRate
+)
+    : sampleRateValue(sampleRate)
+{
+    CHECK(sampleRate > 0);
+    end.tempo = defaultTempo;
+    end.samplesPerTick = Ticks::samplesPerTick(defaultTempo, sampleRate);
+    sectionStarts.reserve(sectionOrder.size());
+    for (auto& sectionId : sectionOrder) {
+        auto& section = sections.at(sectionId);
+        const auto tempo = section.tempo.value_or(defaultTempo);
+        auto& ss = sectionStarts.emplace_back(SectionStart{
+          .id = sectionId,
+          .tempo = tempo,
+          .samplesPerTick = Ticks::samplesPerTick(tempo, sampleRate),
+          .ticks = end.ticks,
+          .seconds = end.seconds,
+          .sample = samplesFromSeconds(end.seconds),
+          .beatsBegin = beatList.size(),
+          .beatsEnd = 0
+        });
+        auto addBeat = [&](Ticks ticksInSection, bool barStart) {
+            beatList.push_back(Beat{
+              .ticks = ss.ticks + ticksInSection,
+              .sample = ss.sample + ticksInSection.toSamples(ss.samplesPerTick),
+              .barStart = barStart
+            });
+        };
+        const auto durationTicks = switch_variant(
+          section.structure,
+          [&](const Bars& x) {
+              Ticks t;
+              for (auto& b : x.bars) {
+                  const auto beat = Ticks::noteValue(b.timeSignature.lower);
+                  for (auto beatIxInBar : vi::iota(0, b.timeSignature.upper)) {
+                      addBeat(t, beatIxInBar == 0);
+                      t += beat;
+                  }
+              }
+              return t;
+          },
+          [&](const Period& x) {
+              const auto beat = Ticks::noteValue(defaultBeatUnit);
+              const auto length = Ticks::fromWholeNotes(x.wholeNotes);
+              for (Ticks t; t < length; t += beat) {
+                  addBeat(t, false);
+              }
+              return length;
+          },
+          [&](const Duration& x) {
+              return Ticks::fromWholeNotes(x.seconds * tempo / 60);
+          }
+        );
+        ss.beatsEnd = beatList.size();
+        end.tempo = tempo;
+        end.samplesPerTick = ss.samplesPerTick;
+        end.ticks += durationTicks;
+        if (auto* d = std::get_if<Duration>(&section.structure)) {
+            end.seconds += d->seconds;
+        } else {
+            end.seconds += durationTicks.toWholeNotes() / tempo * 60;
+        }
+    }
+}
+
+const TempoMap::SectionStart* TempoMap::sectionAtTicks(Ticks ticks) const
+{
+    return lastAtOrBefore(span(sectionStarts), ticks, &SectionStart::ticks);
+}
+
+const TempoMap::SectionStart* TempoMap::sectionAtSeconds(const Rational& seconds) const
+{
+    return lastAtOrBefore(span(sectionStarts), seconds, &SectionStart::seconds);
+}
+
+int64_t TempoMap::samplesFromTicks(Ticks ticks) const
+{
+    if (auto* ss = sectionAtTicks(ticks)) {
+        return ss->sample + (ticks - ss->ticks).toSamples(ss->samplesPerTick);
+    }
+    return ticks.toSamples(end.samplesPerTick);
+}
+
+Ticks TempoMap::ticksFromSamples(int64_t samples) const
+{
+    if (auto* ss = sectionAt(samples)) {
+        return ss->ticks + Ticks::fromSamples(samples - ss->sample, ss->samplesPerTick);
+    }
+    return Ticks::fromSamples(samples, end.samplesPerTick);
+}
+
+Rational TempoMap::secondsFromTicks(Ticks ticks) const
+{
+    if (auto* ss = sectionAtTicks(ticks)) {
+        return ss->seconds + (ticks - ss->ticks).toWholeNotes() / ss->tempo * 60;
+    }
+    return ticks.toWholeNotes() / end.tempo * 60;
+}
+
+Ticks TempoMap::ticksFromSeconds(Rational seconds) const
+{
+    if (auto* ss = sectionAtSeconds(seconds)) {
+        return ss->ticks + Ticks::fromWholeNotes((seconds - ss->seconds) * ss->tempo / 60);
+    }
+    return Ticks::fromWholeNotes(seconds * end.tempo / 60);
+}
+
+int64_t TempoMap::samplesFromSeconds(Rational seconds) const
+{
+    // seconds * sampleRate without forming the product of the numerator and the sample rate.
+    const auto n = seconds.numerator(), d = seconds.denominator();
+    return n / d * sampleRateValue + ceilDiv(n % d * sampleRateValue, d);
+}
+
+const TempoMap::SectionStart* TempoMap::sectionAt(int64_t sample) const
+{
+    return lastAtOrBefore(span(sectionStarts), sample, &SectionStart::sample);
+}
+
+const TempoMap::Beat* TempoMap::beatAt(int64_t sample) const
+{
+    auto it = ra::upper_bound(beatList, sample, {}, &Beat::sample);
+    return it == beatList.begin() ? nullptr : &*(it - 1);
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Id.h"
+#include "SlotMap.h"
+#include "Ticks.h"
+#include "common.h"
+
+struct Section;
+
+// The arrangement's musical time compiled from the sections in `sectionOrder`: where each section and each beat
+// starts in ticks and in samples. Sections start at the first sample at or after their exact time in seconds (which
+// is accumulated as a Rational), positions within a section are converted relative to it, both in both directions.
+//
+// Conversions between ticks, seconds and samples find the section by binary search, O(log n). Positions before the
+// arrangement use the first section's tempo, positions after it the last one's.
+//
+// The arrangement layout and the timeline index place the sections and the clips with it, so the playback and the
+// mixdown start them at the same samples.
+class TempoMap
+{
+public:
+    // Used when there is no output device to take the sample rate from.
+    static constexpr int64_t k_defaultSampleRate = 48000;
+
+    struct SectionStart {
+        Id<Section> id;
+        Rational tempo; // Whole notes per minute.
+        Rational samplesPerTick; // See Ticks::samplesPerTick.
+        Ticks ticks;
+        Rational seconds;
+        int64_t sample;
+        size_t beatsBegin, beatsEnd; // Range in `beats()`.
+        bool operator==(const SectionStart&) const = default;
+    };
+    struct Beat {
+        Ticks ticks;
+        int64_t sample;
+        bool barStart;
+        bool operator==(const Beat&) const = default;
+    };
+
+    TempoMap() = default;
+    // `defaultTempo` and `defaultBeatUnit` are the metronome's, for the sections without their own.
+    TempoMap(
+      const SlotMap<Id<Section>, Section>& sections,
+      const vector<Id<Section>>& sectionOrder,
+      Rational defaultTempo,
+      int defaultBeatUnit,
+      int64_t sampleRate
+    );
+
+    int64_t sampleRate() const
+    {
+        return sampleRateValue;
+    }
+    span<const SectionStart> sections() const
+    {
+        return sectionStarts;
+    }
+    span<const Beat> beats() const
+    {
+        return beatList;
+    }
+    Ticks durationTicks() const
+    {
+        return end.ticks;
+    }
+    Rational durationSeconds() const
+    {
+        return end.seconds;
+    }
+
+    // First sample at or after the position.
+    int64_t samplesFromTicks(Ticks ticks) const;
+    // Last tick at or before the sample.
+    Ticks ticksFromSamples(int64_t samples) const;
+    Rational secondsFromTicks(Ticks ticks) const;
+    // Rounded to the nearest tick.
+    Ticks ticksFromSeconds(Rational seconds) const;
+    // First sample at or after `seconds`.
+    int64_t samplesFromSeconds(Rational seconds) const;
+    Rational secondsFromSamples(int64_t samples) const
+    {
+        return Rational(samples, sampleRateValue);
+    }
+
+    // The section containing `sample` (clamped to the first and last ones), nullptr if there are no sections.
+    const SectionStart* sectionAt(int64_t sample) const;
+    // The last beat starting at or before `sample`, nullptr if there is none.
+    const Beat* beatAt(int64_t sample) const;
+
+    bool operator==(const TempoMap&) const = default;
+
+private:
+    struct End {
+        Rational tempo{120, 4};
+        Rational samplesPerTick = Ticks::samplesPerTick(Rational(120, 4), k_defaultSampleRate);
+        Ticks ticks;
+        Rational seconds;
+        bool operator==(const End&) const = default;
+    };
+
+    vector<SectionStart> sectionStarts;
+    vector<Beat> beatList;
+    End end; // The tempo of the last section (the default tempo if none) and where the arrangement ends.
+    int64_t sampleRateValue = k_defaultSampleRate;
+
+    // The section whose tempo applies at the position, nullptr if there are no sections.
+    const SectionStart* sectionAtTicks(Ticks ticks) const;
+    const SectionStart* sectionAtSeconds(const Rational& seconds) const;
+};
@@ -0,0 +1,77 @@
+#include "Ticks.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <__msvc_int128.hpp>
+#endif
+
+namespace
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+using Int128 = std::_Signed128;
+#else
+__extension__ typedef __int128 Int128;
+#endif
+
+enum class Rounding {
+    down,
+    up,
+    nearest
+};
+
+// x * num / den, den > 0.
+int64_t mulDiv(int64_t x, int64_t num, int64_t den, Rounding rounding, const char* op)
+{
+    auto p = Int128(x) * Int128(num);
+    if (rounding == Rounding::nearest) {
+        p = p * 2 + den;
+        den *= 2;
+    }
+    auto q = p / den;
+    const auto r = p % den;
+    if (rounding == Rounding::up ? r > 0 : r < 0) {
+        q += rounding == Rounding::up ? 1 : -1;
+    }
+    if (q > Int128(INT64_MAX) || q < Int128(INT64_MIN)) [[unlikely]] {
+        LOG(FATAL) << fmt::format("Ticks overflow: {} * {} / {} ({})", x, num, den, op);
+    }
+    return int64_t(q);
+}
+} // namespace
+
+Ticks Ticks::fromWholeNotes(const Rational& wholeNotes)
+{
+    return Ticks(mulDiv(wholeNotes.numerator(), k_perWholeNote, wholeNotes.denominator(), Rounding::nearest, "round"));
+}
+
+Rational Ticks::samplesPerTick(const Rational& tempo, int64_t sampleRate)
+{
+    CHECK(tempo > 0 && sampleRate > 0);
+    return Rational(60 * sampleRate, k_perWholeNote) / tempo;
+}
+
+double Ticks::secondsPerTick(const Rational& tempo)
+{
+    return 60.0 / (boost::rational_cast<double>(tempo) * double(k_perWholeNote));
+}
+
+int64_t Ticks::toSamples(const Rational& samplesPerTickArg) const
+{
+    return mulDiv(v, samplesPerTickArg.numerator(), samplesPerTickArg.denominator(), Rounding::up, "toSamples");
+}
+
+Ticks Ticks::fromSamples(int64_t samples, const Rational& samplesPerTickArg)
+{
+    return Ticks(
+      mulDiv(samples, samplesPerTickArg.denominator(), samplesPerTickArg.numerator(), Rounding::down, "fromSamples")
+    );
+}
+
+void Ticks::failTicksOverflow(const char* op, int64_t x, int64_t y)
+{
+    LOG(FATAL) << fmt::format("Ticks overflow: {} {} {}", x, op, y);
+}
+
+void Ticks::failTicksNotRepresentable(int64_t numerator, int64_t denominator)
+{
+    LOG(FATAL) << fmt::format("{}/{} whole notes is not a whole number of ticks", numerator, denominator);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "common.h"
+
+// Musical time as an integer number of ticks of a whole note, for the arithmetic on positions and lengths which would
+// otherwise be done in Rational. Adding ticks is an integer addition instead of a gcd-normalizing Rational one, and
+// all arithmetic is checked: overflow is a fatal error at run time and a compile error in constant expressions.
+//
+// k_perWholeNote divides every note value down to 1/256 and the tuplets of 3, 5, 7, 9, 11 and 13 so the positions of
+// the time signatures and the note values in a project are exact. The range is about 8e11 whole notes.
+//
+// The conversions to and from samples use 128-bit intermediates and are exact: `toSamples` rounds up (the first
+// sample at or after the position), `fromSamples` rounds down.
+class Ticks
+{
+public:
+    static constexpr int64_t k_perWholeNote = 256 * 9 * 5 * 7 * 11 * 13;
+
+    constexpr Ticks() = default;
+    constexpr explicit Ticks(int64_t countArg)
+        : v(countArg)
+    {
+    }
+    static constexpr Ticks wholeNotes(int64_t n)
+    {
+        return Ticks(checkedMul(n, k_perWholeNote));
+    }
+    // 1/denominator of a whole note, e.g. the beat of a time signature.
+    static constexpr Ticks noteValue(int64_t denominator)
+    {
+        if (denominator <= 0 || k_perWholeNote % denominator != 0) [[unlikely]] {
+            failTicksNotRepresentable(1, denominator);
+        }
+        return Ticks(k_perWholeNote / denominator);
+    }
+    // Rounded to the nearest tick.
+    static Ticks fromWholeNotes(const Rational& wholeNotes);
+
+    constexpr int64_t count() const
+    {
+        return v;
+    }
+    Rational toWholeNotes() const
+    {
+        return Rational(v, k_perWholeNote);
+    }
+
+    // `tempo` is in whole notes per minute, as AppState::Metronome::tempo. Compute these once per tempo and pass them
+    // to the conversions, so the loops over positions don't do Rational arithmetic.
+    static Rational samplesPerTick(const Rational& tempo, int64_t sampleRate);
+    static double secondsPerTick(const Rational& tempo);
+
+    int64_t toSamples(const Rational& samplesPerTickArg) const;
+    static Ticks fromSamples(int64_t samples, const Rational& samplesPerTickArg);
+    double toSeconds(double secondsPerTickArg) const
+    {
+        return double(v) * secondsPerTickArg;
+    }
+
+    constexpr Ticks operator-() const
+    {
+        return Ticks(checkedSub(0, v));
+    }
+    constexpr Ticks& operator+=(Ticks y)
+    {
+        v = checkedAdd(v, y.v);
+        return *this;
+    }
+    constexpr Ticks& operator-=(Ticks y)
+    {
+        v = checkedSub(v, y.v);
+        return *this;
+    }
+    friend constexpr Ticks operator+(Ticks x, Ticks y)
+    {
+        return x += y;
+    }
+    friend constexpr Ticks operator-(Ticks x, Ticks y)
+    {
+        return x -= y;
+    }
+    friend constexpr Ticks operator*(Ticks x, int64_t n)
+    {
+        return Ticks(checkedMul(x.v, n));
+    }
+    friend constexpr Ticks operator*(int64_t n, Ticks x)
+    {
+        return x * n;
+    }
+    // The number of whole `y`s in `x`, rounded down.
+    friend constexpr int64_t floorDiv(Ticks x, Ticks y)
+    {
+        const auto q = x.v / y.v;
+        return q * y.v != x.v && (x.v < 0) != (y.v < 0) ? q - 1 : q;
+    }
+
+    constexpr auto operator<=>(const Ticks&) const = default;
+
+private:
+    int64_t v = 0;
+
+    // Not constexpr, so reaching them in a constant expression doesn't compile.
+    static void failTicksOverflow(const char* op, int64_t x, int64_t y);
+    static void failTicksNotRepresentable(int64_t numerator, int64_t denominator);
+
+    static constexpr int64_t checkedAdd(int64_t x, int64_t y)
+    {
+        if (y > 0 ? x > INT64_MAX - y : x < INT64_MIN - y) [[unlikely]] {
+            failTicksOverflow("+", x, y);
+        }
+        return x + y;
+    }
+    static constexpr int64_t checkedSub(int64_t x, int64_t y)
+    {
+        if (y < 0 ? x > INT64_MAX + y : x < INT64_MIN + y) [[unlikely]] {
+            failTicksOverflow("-", x, y);
+        }
+        return x - y;
+    }
+    static constexpr int64_t checkedMul(int64_t x, int64_t y)
+    {
+        const bool overflow = x > 0 ? (y > 0 ? x > INT64_MAX / y : y < INT64_MIN / x)
+                                    : (y > 0 ? x < INT64_MIN / y : x != 0 && y < INT64_MAX / x);
+        if (overflow) [[unlikely]] {
+            failTicksOverflow("*", x, y);
+        }
+        return x * y;
+    }
+};
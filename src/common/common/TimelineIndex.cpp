@@ -0,0 +1,31 @@
+#include "TimelineIndex.h"
+
+#include "common.h"
+
+TimelineIndex::TimelineIndex(vector<Interval> intervalsArg, double sampleRate)
+    : intervals(MOVE(intervalsArg))
+    , maxEnd(intervals.size())
+    , sampleRateValue(sampleRate)
+{
+    ra::sort(intervals, [](const Interval& x, const Interval& y) {
+        return pair(x.begin, x.clipLinkId.v) < pair(y.begin, y.clipLinkId.v);
+    });
+    buildMaxEnd(0, intervals.size());
+}
+
+int64_t TimelineIndex::buildMaxEnd(size_t lo, size_t hi)
+{
+    if (lo >= hi) {
+        return INT64_MIN;
+    }
+    const auto mid = lo + (hi - lo) / 2;
+    maxEnd[mid] = std::max({intervals[mid].end, buildMaxEnd(lo, mid), buildMaxEnd(mid + 1, hi)});
+    return maxEnd[mid];
+}
+
+void TimelineIndex::overlapping(int64_t begin, int64_t end, vector<Interval>& out) const
+{
+    forEachOverlapping(begin, end, [&out](const Interval& x) {
+        out.push_back(x);
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Id.h"
+#include "std.h"
+
+struct AudioClip;
+struct ClipLink;
+
+// Interval index of the linked clips over the arrangement, in samples from the start of the arrangement, for the
+// "what plays in [begin, end)" queries of the playback scheduler and the UI.
+//
+// The intervals are sorted by begin and form an implicit balanced binary tree: the node of a range of the array is its
+// middle element and it stores the largest end in the range. A query skips the subtrees which end before it or begin
+// after it, so it visits O(log n) nodes besides the k reported ones (degrading towards O(k log n) for long, nested
+// intervals, which don't happen in arrangements). Built in O(n log n).
+class TimelineIndex
+{
+public:
+    // Used when there is no output device to take the sample rate from.
+    static constexpr double k_defaultSampleRate = 48000;
+
+    struct Interval {
+        int64_t begin, end; // Samples, [begin, end).
+        Id<ClipLink> clipLinkId;
+        Id<AudioClip> audioClipId;
+        bool operator==(const Interval&) const = default;
+    };
+
+    TimelineIndex() = default;
+    TimelineIndex(vector<Interval> intervals, double sampleRate);
+
+    double sampleRate() const
+    {
+        return sampleRateValue;
+    }
+    int64_t toSamples(double seconds) const
+    {
+        return int64_t(std::llround(seconds * sampleRateValue));
+    }
+    size_t size() const
+    {
+        return intervals.size();
+    }
+    // All intervals, sorted by begin.
+    span<const Interval> all() const
+    {
+        return intervals;
+    }
+
+    // Call `fn(const Interval&)` for the intervals overlapping [begin, end), in the order of their begin.
+    template<class Fn>
+    void forEachOverlapping(int64_t begin, int64_t end, Fn&& fn) const
+    {
+        if (begin < end) {
+            forEachOverlapping(0, intervals.size(), begin, end, fn);
+        }
+    }
+    // Append the intervals overlapping [begin, end) to `out`, in the order of their begin.
+    void overlapping(int64_t begin, int64_t end, vector<Interval>& out) const;
+    // Append the intervals playing at sample `t` to `out`.
+    void at(int64_t t, vector<Interval>& out) const
+    {
+        overlapping(t, t + 1, out);
+    }
+
+    bool operator==(const TimelineIndex&) const = default;
+
+private:
+    vector<Interval> intervals;
+    vector<int64_t> maxEnd; // Largest end of the subtree whose root is the same index in `intervals`.
+    double sampleRateValue = k_defaultSampleRate;
+
+    int64_t buildMaxEnd(size_t lo, size_t hi);
+
+    template<class Fn>
+    void forEachOverlapping(size_t lo, size_t hi, int64_t begin, int64_t end, Fn& fn) const
+    {
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            if (maxEnd[mid] <= begin) {
+                return;
+            }
+            forEachOverlapping(lo, mid, begin, end, fn);
+            auto& x = intervals[mid];
+            if (x.begin >= end) {
+                return; // The right subtree begins even later.
+            }
+            if (x.end > begin) {
+                fn(x);
+            }
+            lo = mid + 1;
+        }
+    }
+};
@@ -1,19 +1,27 @@
 #pragma once
 
+#include "AudioClip.h"
+#include "CompressedAudio.h"
 #include "RecordingBuffer.h"
 #include "common/Id.h"
 
-struct AudioClip;
-
 namespace msg
 {
 enum class MainMenu {
     quit,
     settings,
-    hideSettings
+    hideSettings,
+    dumpStateGraph,
+    saveProject,
+    openProject,
+    importAudioFiles
 };
 struct AddTrack {
 };
+// Sent by the Autosave when writing its journal starts failing (with the error) or works again.
+struct AutosaveStatus {
+    optional<string> error;
+};
 
 namespace AudioSettings
 {
@@ -37,7 +45,10 @@ struct AudioCallbacksAboutToStart {
 };
 struct AudioCallbacksStopped {
 };
-using V = variant<Changed, AudioCallbacksAboutToStart, AudioCallbacksStopped>;
+// JUCE messages are waiting to be dispatched, see AudioIO::dispatchPendingMessages.
+struct MessagesPending {
+};
+using V = variant<Changed, AudioCallbacksAboutToStart, AudioCallbacksStopped, MessagesPending>;
 } // namespace AudioIO
 
 namespace Metronome
@@ -68,6 +79,55 @@ struct OutputChanged {
 struct PlayClip {
     Id<AudioClip> id;
 };
+// The clip is likely to be played soon.
+struct PrefetchClip {
+    Id<AudioClip> id;
+};
+namespace ClipStorage
+{
+// Results of the ClipTiering's background jobs.
+struct Compressed {
+    Id<AudioClip> id;
+    CompressedAudio audio;
+    chr::duration<double> duration;
+};
+struct Decompressed {
+    Id<AudioClip> id;
+    vector<deque<float>> channels;
+    chr::duration<double> duration;
+};
+using V = variant<Compressed, Decompressed>;
+} // namespace ClipStorage
+// Result of an AudioFileImporter batch.
+struct AudioFilesImported {
+    vector<AudioClip> clips; // In the order of the files, the ones which failed are skipped.
+    vector<string> errors;
+    size_t numBytes; // Size of the imported files.
+    chr::duration<double> duration;
+};
+namespace Mixdown
+{
+enum class Format {
+    wav,
+    flac
+};
+struct Export {
+    Format format;
+};
+struct Cancel {
+};
+// From the MixdownExporter.
+struct Progress {
+    double fraction;
+};
+struct Finished {
+    string path;
+    optional<string> error;
+    bool cancelled;
+    chr::duration<double> duration;
+};
+using V = variant<Export, Cancel, Progress, Finished>;
+} // namespace Mixdown
 namespace AudioEngine
 {
 struct NoFreeRecordingBuffer {
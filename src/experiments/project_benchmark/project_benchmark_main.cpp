@@ -0,0 +1,145 @@
+#include "common/AppState.h"
+#include "common/ProjectFile.h"
+#include "common/RecordingBuffer.h"
+#include "common/common.h"
+
+#include "benchmark/benchmark.h"
+
+#include <filesystem>
+
+// Save and open times of project files with many clips, for each audio storage. Each clip is linked into a section and
+// holds k_clipLength frames of synthetic audio. Reports the file size and the throughput of the audio. The files are
+// written to the temp directory. For regression tracking, emit JSON with:
+//
+//     project_benchmark --benchmark_format=json --benchmark_out=project_benchmark.json
+//
+
+namespace
+{
+constexpr double k_clipSampleRate = 48000;
+constexpr size_t k_clipLength = 4096;
+constexpr size_t k_clipsPerSection = 10;
+
+void fillAppState(AppState& appState, size_t numClips)
+{
+    auto& rse = appState.rse;
+    RecordingBuffer rb;
+    rb.channels.resize(1);
+    for (size_t i : vi::iota(0u, k_clipLength)) {
+        rb.channels[0].push_back(float(std::sin(double(i) * 0.05) * std::exp(-double(i) / double(k_clipLength))));
+    }
+    SlotMap<Id<Section>, Section> sections;
+    vector<Id<Section>> sectionOrder;
+    SlotMap<Id<AudioClip>, AudioClip> clips;
+    SlotMap<Id<ClipLink>, ClipLink> clipLinks;
+    const auto sectionIds = Id<Section>::makeN((numClips + k_clipsPerSection - 1) / k_clipsPerSection);
+    const auto clipIds = Id<AudioClip>::makeN(numClips);
+    const auto clipLinkIds = Id<ClipLink>::makeN(numClips);
+    for (size_t i : vi::iota(0u, numClips)) {
+        if (i % k_clipsPerSection == 0) {
+            auto id = sectionIds[i / k_clipsPerSection];
+            sections.insert(pair(
+              id,
+              Section{
+                .name = fmt::format("Section {}", sectionOrder.size()),
+                .tempo = {},
+                .structure = Bars{.bars = vector(4, Bar{.timeSignature = TimeSignature{4, 4}})},
+                .clipLinksAnchored = {},
+                .clipLinksOverlapping = {}
+              }
+            ));
+            sectionOrder.push_back(id);
+        }
+        AudioClip clip(k_clipSampleRate, 1);
+        clip.append(rb);
+        auto clipId = clipIds[i];
+        clips.insert(pair(clipId, MOVE(clip)));
+        clipLinks.insert(pair(
+          clipLinkIds[i],
+          ClipLink{
+            .sectionId = sectionOrder.back(),
+            .audioClipId = clipId,
+            .timeUnit = TimeUnit::wholeNotes,
+            .clipOriginToSectionStart = Rational(intCast<int64_t>(i % k_clipsPerSection), 4)
+          }
+        ));
+    }
+    rse.setAsDifferent(appState.sections, MOVE(sections));
+    rse.setAsDifferent(appState.sectionOrder, MOVE(sectionOrder));
+    rse.setAsDifferent(appState.clips, MOVE(clips));
+    rse.setAsDifferent(appState.clipLinks, MOVE(clipLinks));
+}
+
+std::filesystem::path benchmarkProjectPath()
+{
+    return std::filesystem::temp_directory_path() / "dawtracker_project_benchmark.dtproj";
+}
+
+void setCounters(benchmark::State& state, size_t numClips)
+{
+    state.counters["fileSize"] = benchmark::Counter(double(std::filesystem::file_size(benchmarkProjectPath())));
+    state.SetBytesProcessed(state.iterations() * int64_t(numClips * k_clipLength * sizeof(float)));
+}
+
+// Args: number of clips, ProjectAudioStorage.
+void BM_SaveProject(benchmark::State& state)
+{
+    const auto numClips = size_t(state.range(0));
+    const auto audioStorage = ProjectAudioStorage(state.range(1));
+    AppState appState;
+    fillAppState(appState, numClips);
+    for (auto _ : state) {
+        auto r = saveProject(appState, benchmarkProjectPath(), audioStorage);
+        if (!r) {
+            state.SkipWithError(r.error().c_str());
+            return;
+        }
+    }
+    setCounters(state, numClips);
+}
+
+// Args: number of clips, ProjectAudioStorage. Includes replacing the document in the AppState and recomputing the
+// arrangement layout.
+void BM_OpenProject(benchmark::State& state)
+{
+    const auto numClips = size_t(state.range(0));
+    const auto audioStorage = ProjectAudioStorage(state.range(1));
+    {
+        AppState appState;
+        fillAppState(appState, numClips);
+        auto r = saveProject(appState, benchmarkProjectPath(), audioStorage);
+        if (!r) {
+            state.SkipWithError(r.error().c_str());
+            return;
+        }
+    }
+    AppState appState;
+    appState.registerUpdaters();
+    for (auto _ : state) {
+        auto project = loadProject(benchmarkProjectPath());
+        if (!project) {
+            state.SkipWithError(project.error().c_str());
+            return;
+        }
+        setProject(appState, MOVE(*project));
+        benchmark::DoNotOptimize(appState.rse.get(appState.arrangementLayout));
+    }
+    setCounters(state, numClips);
+}
+
+void applyArgs(benchmark::internal::Benchmark* b)
+{
+    for (auto numClips : {100, 1000, 10000}) {
+        for (auto audioStorage :
+             {ProjectAudioStorage::external, ProjectAudioStorage::embedded, ProjectAudioStorage::embeddedCompressed}) {
+            b->Args({numClips, int64_t(audioStorage)});
+        }
+    }
+    b->Unit(benchmark::kMillisecond);
+}
+} // namespace
+
+BENCHMARK(BM_SaveProject)->Apply(applyArgs);
+BENCHMARK(BM_OpenProject)->Apply(applyArgs);
+
+BENCHMARK_MAIN();
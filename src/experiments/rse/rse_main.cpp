@@ -1,15 +1,106 @@
 #include "common/ReactiveStateEngine.h"
 #include "common/common.h"
 
-struct State {
-    int a, b;
-    int c;
+// A small ReactiveStateEngine demo followed by a comparison of the engine's node representation (single inline updater
+// callable, edges in shared arenas indexed by node id) with the previous one (std::function<bool()> wrapping a
+// std::function<V()>, per-node upstream and downstream vectors), on a layered graph where each node depends on two
+// nodes of the previous layer.
+
+namespace
+{
+std::atomic<size_t> s_allocatedBytes;
+
+constexpr size_t k_width = 10000;
+constexpr size_t k_depth = 10;
+constexpr size_t k_numIterations = 20;
+
+// The previous node representation with the same update algorithm, reduced to Computed<int> nodes.
+struct LegacyNode {
+    uint64_t timestamp = 1;
+    vector<LegacyNode*> downstreamNodes;
+    bool upToDate = false;
+    uint64_t upstreamProcessedUntilTimestamp = 0;
+    vector<variant<const LegacyNode*, LegacyNode*>> upstreamNodes;
+    function<bool()> computeAndUpdateIfDifferentFn;
+    int v = 0;
+
+    void markThisAndDownstreamNodesOutOfDate()
+    {
+        if (upToDate) {
+            upToDate = false;
+            for (auto* d : downstreamNodes) {
+                d->markThisAndDownstreamNodesOutOfDate();
+            }
+        }
+    }
 };
 
-int main()
+struct LegacyEngine {
+    uint64_t nextTimestamp = 1;
+
+    void set(LegacyNode& k, int v)
+    {
+        k.v = v;
+        k.timestamp = nextTimestamp++;
+        for (auto* d : k.downstreamNodes) {
+            d->markThisAndDownstreamNodesOutOfDate();
+        }
+    }
+    bool updateIfNeeded(LegacyNode& k)
+    {
+        if (k.upToDate) {
+            return false;
+        }
+        auto maxUpstreamTimestamp = k.upstreamProcessedUntilTimestamp;
+        for (auto& uv : k.upstreamNodes) {
+            switch_variant(
+              uv,
+              [&](const LegacyNode* x) {
+                  maxUpstreamTimestamp = std::max(maxUpstreamTimestamp, x->timestamp);
+              },
+              [&](LegacyNode* x) {
+                  updateIfNeeded(*x);
+                  maxUpstreamTimestamp = std::max(maxUpstreamTimestamp, x->timestamp);
+              }
+            );
+        }
+        bool changed = k.upstreamProcessedUntilTimestamp < maxUpstreamTimestamp && k.computeAndUpdateIfDifferentFn();
+        if (changed) {
+            k.timestamp = nextTimestamp++;
+        }
+        k.upToDate = true;
+        k.upstreamProcessedUntilTimestamp = maxUpstreamTimestamp;
+        return changed;
+    }
+    void registerUpdater(LegacyNode& k, function<int()> computeFn, initializer_list<LegacyNode*> upstreamNodes)
+    {
+        for (auto* u : upstreamNodes) {
+            if (u->computeAndUpdateIfDifferentFn) {
+                k.upstreamNodes.push_back(u);
+            } else {
+                k.upstreamNodes.push_back(static_cast<const LegacyNode*>(u));
+            }
+            u->downstreamNodes.push_back(&k);
+        }
+        k.computeAndUpdateIfDifferentFn = [&k, computeFn = MOVE(computeFn)]() -> bool {
+            auto newValue = computeFn();
+            if (newValue == k.v) {
+                return false;
+            }
+            k.v = newValue;
+            return true;
+        };
+    }
+};
+
+void demo()
 {
-    State s;
-    ReactiveStateEngine rse(&s);
+    struct State {
+        rse::Value<int> a, b;
+        rse::Computed<int> c;
+    } s;
+
+    ReactiveStateEngine rse;
     rse.registerUpdater(s.c, [&s, &rse]() {
         return rse.get(s.a) + rse.get(s.b);
     });
@@ -18,6 +109,154 @@ int main()
     fmt::println("c: {}", rse.get(s.c));
     rse.set(s.a, 10);
     fmt::println("c: {}", rse.get(s.c));
+}
+
+// A computed node updated for the first time must get a newer timestamp than the nodes which haven't been changed yet:
+// here `c` reads `a`, which is unchanged but has the lower node id, before `b`, which is recomputed. The engine asserts
+// that the timestamp of a recomputed upstream node increases the maximum.
+void checkFirstUpdateOfUnchangedNodes()
+{
+    struct State {
+        rse::Value<int> a{}, x{};
+        rse::Computed<int> readsA, b, c;
+    } s;
+
+    ReactiveStateEngine rse;
+    rse.registerUpdater(s.readsA, [&s, &rse]() {
+        return rse.get(s.a);
+    });
+    rse.registerUpdater(s.b, [&s, &rse]() {
+        return rse.get(s.x) + 1;
+    });
+    rse.registerUpdater(s.c, [&s, &rse]() {
+        return rse.get(s.a) + rse.get(s.b);
+    });
+    CHECK(rse.get(s.c) == 1);
+    CHECK(rse.changeTimestamp(s.a) < rse.changeTimestamp(s.b));
+    rse.set(s.x, 5);
+    CHECK(rse.get(s.c) == 6);
+}
+
+struct Result {
+    double bytesPerNode;
+    double nsPerNodeUpdate;
+};
+
+void print(string_view name, const Result& r)
+{
+    fmt::println("{:>8}: {:7.1f} bytes/node, {:6.2f} ns/node update", name, r.bytesPerNode, r.nsPerNodeUpdate);
+}
+
+Result benchmarkEngine()
+{
+    auto inputs = vector<rse::Value<int>>(k_width);
+    auto nodes = vector<rse::Computed<int>>(k_width * k_depth);
+    auto bytes0 = s_allocatedBytes.load();
+    ReactiveStateEngine rse;
+    for (size_t layer : vi::iota(0u, k_depth)) {
+        for (size_t i : vi::iota(0u, k_width)) {
+            auto& k = nodes[layer * k_width + i];
+            if (layer == 0) {
+                rse.registerUpdater(k, [&rse, &x = inputs[i]]() {
+                    return rse.get(x) + 1;
+                });
+            } else {
+                auto& x = nodes[(layer - 1) * k_width + i];
+                auto& y = nodes[(layer - 1) * k_width + (i + 1) % k_width];
+                rse.registerUpdater(k, [&rse, &x, &y]() {
+                    return rse.get(x) + rse.get(y);
+                });
+            }
+        }
+    }
+    auto bytesPerNode =
+      double(s_allocatedBytes.load() - bytes0) / double(nodes.size()) + double(sizeof(rse::Computed<int>));
+
+    auto t0 = chr::steady_clock::now();
+    for (int it : vi::iota(0, int(k_numIterations))) {
+        for (auto& x : inputs) {
+            rse.set(x, it);
+        }
+        for (auto& k : span(nodes).last(k_width)) {
+            rse.get(k);
+        }
+    }
+    auto dt = chr::duration<double, std::nano>(chr::steady_clock::now() - t0).count();
+    return Result{.bytesPerNode = bytesPerNode, .nsPerNodeUpdate = dt / double(k_numIterations * nodes.size())};
+}
+
+Result benchmarkLegacy()
+{
+    auto inputs = vector<LegacyNode>(k_width);
+    auto nodes = vector<LegacyNode>(k_width * k_depth);
+    auto bytes0 = s_allocatedBytes.load();
+    LegacyEngine engine;
+    for (size_t layer : vi::iota(0u, k_depth)) {
+        for (size_t i : vi::iota(0u, k_width)) {
+            auto& k = nodes[layer * k_width + i];
+            if (layer == 0) {
+                auto& x = inputs[i];
+                engine.registerUpdater(
+                  k,
+                  [&x]() {
+                      return x.v + 1;
+                  },
+                  {&x}
+                );
+            } else {
+                auto& x = nodes[(layer - 1) * k_width + i];
+                auto& y = nodes[(layer - 1) * k_width + (i + 1) % k_width];
+                engine.registerUpdater(
+                  k,
+                  [&x, &y]() {
+                      return x.v + y.v;
+                  },
+                  {&x, &y}
+                );
+            }
+        }
+    }
+    auto bytesPerNode = double(s_allocatedBytes.load() - bytes0) / double(nodes.size()) + double(sizeof(LegacyNode));
+
+    auto t0 = chr::steady_clock::now();
+    for (int it : vi::iota(0, int(k_numIterations))) {
+        for (auto& x : inputs) {
+            engine.set(x, it);
+        }
+        for (auto& k : span(nodes).last(k_width)) {
+            engine.updateIfNeeded(k);
+        }
+    }
+    auto dt = chr::duration<double, std::nano>(chr::steady_clock::now() - t0).count();
+    return Result{.bytesPerNode = bytesPerNode, .nsPerNodeUpdate = dt / double(k_numIterations * nodes.size())};
+}
+} // namespace
+
+void* operator new(size_t n)
+{
+    s_allocatedBytes += n;
+    if (auto* p = std::malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+    demo();
+    checkFirstUpdateOfUnchangedNodes();
+
+    fmt::println("{} x {} nodes, {} iterations", k_depth, k_width, k_numIterations);
+    print("legacy", benchmarkLegacy());
+    print("engine", benchmarkEngine());
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,194 @@
+#include "common/ReactiveStateEngine.h"
+#include "common/common.h"
+
+#include "benchmark/benchmark.h"
+
+// ReactiveStateEngine micro-benchmarks on synthetic graphs of Computed<int64_t> nodes:
+//
+// - chain: value -> c1 -> c2 -> ... -> cN
+// - fanIn: N values -> c
+// - fanOut: value -> c1, c2, ..., cN
+// - diamond: value -> c1, c2, ..., cN -> c
+//
+// The engine updates and invalidates nodes recursively so the chain is limited to 10k nodes, the other shapes go up to
+// 1M. For regression tracking, emit JSON with:
+//
+//     rse_benchmark --benchmark_format=json --benchmark_out=rse_benchmark.json
+//
+
+namespace
+{
+enum class Shape {
+    chain,
+    fanIn,
+    fanOut,
+    diamond
+};
+
+constexpr int64_t k_maxChainLength = 10000;
+constexpr int64_t k_maxNumNodes = 1'000'000;
+
+struct Graph {
+    ReactiveStateEngine rse;
+    vector<rse::Value<int64_t>> sources;
+    unique_ptr<rse::Computed<int64_t>[]> nodes;
+    vector<const rse::Computed<int64_t>*> sinks;
+    size_t numDownstreamNodes = 0; // The nodes invalidated by a change of sources[0].
+
+    Graph(const Graph&) = delete;
+    void operator=(const Graph&) = delete;
+    Graph(Shape shape, size_t n)
+    {
+        switch (shape) {
+        case Shape::chain: {
+            sources = vector<rse::Value<int64_t>>(1);
+            nodes = make_unique<rse::Computed<int64_t>[]>(n);
+            numDownstreamNodes = n;
+            rse.registerUpdater(nodes[0], [this]() {
+                return rse.get(sources[0]) + 1;
+            });
+            for (size_t i : vi::iota(1u, n)) {
+                rse.registerUpdater(nodes[i], [this, &upstream = nodes[i - 1]]() {
+                    return rse.get(upstream) + 1;
+                });
+            }
+            sinks.push_back(&nodes[n - 1]);
+        } break;
+        case Shape::fanIn: {
+            sources = vector<rse::Value<int64_t>>(n);
+            nodes = make_unique<rse::Computed<int64_t>[]>(1);
+            numDownstreamNodes = 1;
+            rse.registerUpdater(nodes[0], [this]() {
+                int64_t sum = 0;
+                for (auto& s : sources) {
+                    sum += rse.get(s);
+                }
+                return sum;
+            });
+            sinks.push_back(&nodes[0]);
+        } break;
+        case Shape::fanOut:
+        case Shape::diamond: {
+            sources = vector<rse::Value<int64_t>>(1);
+            nodes = make_unique<rse::Computed<int64_t>[]>(n + 1);
+            numDownstreamNodes = shape == Shape::fanOut ? n : n + 1;
+            for (size_t i : vi::iota(0u, n)) {
+                rse.registerUpdater(nodes[i], [this, i]() {
+                    return rse.get(sources[0]) + intCast<int64_t>(i);
+                });
+            }
+            if (shape == Shape::fanOut) {
+                for (size_t i : vi::iota(0u, n)) {
+                    sinks.push_back(&nodes[i]);
+                }
+            } else {
+                rse.registerUpdater(nodes[n], [this, n]() {
+                    int64_t sum = 0;
+                    for (size_t i : vi::iota(0u, n)) {
+                        sum += rse.get(nodes[i]);
+                    }
+                    return sum;
+                });
+                sinks.push_back(&nodes[n]);
+            }
+        } break;
+        }
+    }
+
+    void getSinks()
+    {
+        for (auto* s : sinks) {
+            benchmark::DoNotOptimize(rse.get(*s));
+        }
+    }
+};
+
+void applyShapeArgs(benchmark::internal::Benchmark* b, Shape shape)
+{
+    auto maxN = shape == Shape::chain ? k_maxChainLength : k_maxNumNodes;
+    for (int64_t n = 10; n <= maxN; n *= 10) {
+        b->Arg(n);
+    }
+    b->Unit(benchmark::kMicrosecond);
+}
+
+// Cost of `set` on a source whose downstream nodes are all up-to-date: marking them out-of-date.
+void BM_SetInvalidation(benchmark::State& state, Shape shape)
+{
+    Graph g(shape, intCast<size_t>(state.range(0)));
+    int64_t value = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        g.getSinks();
+        state.ResumeTiming();
+        g.rse.set(g.sources[0], ++value);
+    }
+    state.SetItemsProcessed(state.iterations() * intCast<int64_t>(g.numDownstreamNodes));
+}
+
+// Cost of `get` on the sinks after a source has changed: recomputing the out-of-date nodes.
+void BM_GetRecompute(benchmark::State& state, Shape shape)
+{
+    Graph g(shape, intCast<size_t>(state.range(0)));
+    int64_t value = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        g.rse.set(g.sources[0], ++value);
+        state.ResumeTiming();
+        g.getSinks();
+    }
+    state.SetItemsProcessed(state.iterations() * intCast<int64_t>(g.numDownstreamNodes));
+}
+
+// Cost of building the graph: registering the updaters and collecting their inputs.
+void BM_Registration(benchmark::State& state, Shape shape)
+{
+    for (auto _ : state) {
+        auto g = make_unique<Graph>(shape, intCast<size_t>(state.range(0)));
+        benchmark::DoNotOptimize(g->nodes.get());
+        state.PauseTiming();
+        g.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Throughput of recording N `setWithUndo` ops then undoing and redoing all of them, with a computed node depending on
+// the undoable value.
+void BM_UndoRedo(benchmark::State& state)
+{
+    auto n = state.range(0);
+    for (auto _ : state) {
+        ReactiveStateEngine rse;
+        rse::UndoableValue<int> v{0};
+        rse::Computed<int> c;
+        rse.registerUpdater(c, [&]() {
+            return rse.get(v) * 2;
+        });
+        for (int i : vi::iota(1, intCast<int>(n) + 1)) {
+            rse.setWithUndo(v, i);
+        }
+        while (rse.canUndo()) {
+            rse.undo();
+        }
+        while (rse.canRedo()) {
+            rse.redo();
+        }
+        benchmark::DoNotOptimize(rse.get(c));
+    }
+    state.SetItemsProcessed(state.iterations() * n * 3);
+}
+} // namespace
+
+#define RSE_BENCHMARK_SHAPES(FN)                                                                           \
+    BENCHMARK_CAPTURE(FN, chain, Shape::chain)->Apply([](auto* b) { applyShapeArgs(b, Shape::chain); });     \
+    BENCHMARK_CAPTURE(FN, fanIn, Shape::fanIn)->Apply([](auto* b) { applyShapeArgs(b, Shape::fanIn); });     \
+    BENCHMARK_CAPTURE(FN, fanOut, Shape::fanOut)->Apply([](auto* b) { applyShapeArgs(b, Shape::fanOut); });  \
+    BENCHMARK_CAPTURE(FN, diamond, Shape::diamond)->Apply([](auto* b) { applyShapeArgs(b, Shape::diamond); })
+
+RSE_BENCHMARK_SHAPES(BM_SetInvalidation);
+RSE_BENCHMARK_SHAPES(BM_GetRecompute);
+RSE_BENCHMARK_SHAPES(BM_Registration);
+BENCHMARK(BM_UndoRedo)->RangeMultiplier(10)->Range(10, 1'000'000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,95 @@
+#include "common/Ticks.h"
+#include "common/common.h"
+
+#include "benchmark/benchmark.h"
+
+// Musical time arithmetic in Ticks against the same in Rational (boost::rational<int64_t>), on the operations of the
+// tempo map and the arrangement layout: accumulating the beats of bars of mixed time signatures and converting the
+// positions to samples.
+
+namespace
+{
+constexpr int64_t k_sampleRate = 48000;
+const Rational k_tempo(121, 4); // 121 BPM in quarter notes.
+
+// The beat units of the bars, including tuplets.
+vector<int> beatUnits(size_t n)
+{
+    constexpr array<int, 6> k_units = {4, 8, 16, 12, 4, 24};
+    vector<int> r;
+    r.reserve(n);
+    for (size_t i : vi::iota(0u, n)) {
+        r.push_back(k_units[i % k_units.size()]);
+    }
+    return r;
+}
+
+// Arg: number of beats.
+void BM_AccumulateBeats_Rational(benchmark::State& state)
+{
+    const auto units = beatUnits(size_t(state.range(0)));
+    for (auto _ : state) {
+        Rational position(0);
+        for (auto u : units) {
+            position += Rational(1, u);
+            benchmark::DoNotOptimize(position);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_AccumulateBeats_Ticks(benchmark::State& state)
+{
+    const auto units = beatUnits(size_t(state.range(0)));
+    for (auto _ : state) {
+        Ticks position;
+        for (auto u : units) {
+            position += Ticks::noteValue(u);
+            benchmark::DoNotOptimize(position);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Arg: number of beats. The first sample at or after each beat.
+void BM_BeatsToSamples_Rational(benchmark::State& state)
+{
+    const auto units = beatUnits(size_t(state.range(0)));
+    for (auto _ : state) {
+        Rational position(0);
+        for (auto u : units) {
+            position += Rational(1, u);
+            const auto samples = position / k_tempo * 60 * k_sampleRate;
+            const auto floor = samples.numerator() / samples.denominator();
+            benchmark::DoNotOptimize(floor * samples.denominator() == samples.numerator() ? floor : floor + 1);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_BeatsToSamples_Ticks(benchmark::State& state)
+{
+    const auto units = beatUnits(size_t(state.range(0)));
+    for (auto _ : state) {
+        const auto samplesPerTick = Ticks::samplesPerTick(k_tempo, k_sampleRate);
+        Ticks position;
+        for (auto u : units) {
+            position += Ticks::noteValue(u);
+            benchmark::DoNotOptimize(position.toSamples(samplesPerTick));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void applyArgs(benchmark::internal::Benchmark* b)
+{
+    b->Arg(1000)->Arg(100000);
+}
+} // namespace
+
+BENCHMARK(BM_AccumulateBeats_Rational)->Apply(applyArgs);
+BENCHMARK(BM_AccumulateBeats_Ticks)->Apply(applyArgs);
+BENCHMARK(BM_BeatsToSamples_Rational)->Apply(applyArgs);
+BENCHMARK(BM_BeatsToSamples_Ticks)->Apply(applyArgs);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,163 @@
+#include "common/AppState.h"
+#include "common/RecordingBuffer.h"
+#include "common/common.h"
+#include "ui/UI.h"
+
+#include "benchmark/benchmark.h"
+#include "imgui.h"
+
+// Headless benchmark of UI::render: ImGui runs without a platform or renderer backend, the frames are built but not
+// drawn. The AppState is filled with synthetic sections, tracks and clips. Besides the time of building a frame, it
+// reports the vertex and index counts of the draw data and the number of allocations per frame (operator new and
+// ImGui's allocator). For regression tracking, emit JSON with:
+//
+//     ui_benchmark --benchmark_format=json --benchmark_out=ui_benchmark.json
+//
+
+namespace
+{
+std::atomic<size_t> s_numAllocations;
+
+constexpr auto k_displaySize = ImVec2(1600, 1000);
+constexpr double k_clipSampleRate = 12800;
+constexpr size_t k_clipLength = 25600;
+
+void* countingImGuiAlloc(size_t n, void*)
+{
+    ++s_numAllocations;
+    return std::malloc(n);
+}
+void countingImGuiFree(void* p, void*)
+{
+    std::free(p);
+}
+
+void fillAppState(AppState& appState, size_t numSections, size_t numTracks, size_t numClips)
+{
+    auto& rse = appState.rse;
+    auto ts44 = TimeSignature{4, 4};
+    auto ts34 = TimeSignature{3, 4};
+    const auto sectionIds = Id<Section>::makeN(numSections);
+    for (size_t i : vi::iota(0u, numSections)) {
+        auto id = sectionIds[i];
+        auto bars = Bars{};
+        for (size_t j : vi::iota(0u, 8u)) {
+            bars.bars.push_back(Bar{.timeSignature = j % 4 == 3 ? ts34 : ts44});
+        }
+        rse.insert(
+          appState.sections,
+          pair(
+            id,
+            Section{
+              .name = fmt::format("Section {}", i),
+              .tempo = {},
+              .structure = MOVE(bars),
+              .clipLinksAnchored = {},
+              .clipLinksOverlapping = {}
+            }
+          )
+        );
+        rse.pushBack(appState.sectionOrder, id);
+    }
+
+    SlotMap<Id<Track>, Track> tracks;
+    vector<Id<Track>> trackOrder;
+    const auto trackIds = Id<Track>::makeN(numTracks);
+    for (size_t i : vi::iota(0u, numTracks)) {
+        auto id = trackIds[i];
+        tracks.insert(pair(id, Track{.name = fmt::format("Track {}", i + 1)}));
+        trackOrder.push_back(id);
+    }
+    rse.setWithUndo(appState.tracks, MOVE(tracks));
+    rse.setWithUndo(appState.trackOrder, MOVE(trackOrder));
+
+    RecordingBuffer rb;
+    rb.channels.resize(1);
+    for (size_t i : vi::iota(0u, k_clipLength)) {
+        rb.channels[0].push_back(float(std::sin(double(i) * 0.05) * std::exp(-double(i) / double(k_clipLength))));
+    }
+    for (UNUSED size_t i : vi::iota(0u, numClips)) {
+        AudioClip clip(k_clipSampleRate, 1);
+        clip.append(rb);
+        rse.insert(appState.clips, pair(Id<AudioClip>::make(), MOVE(clip)));
+    }
+}
+
+struct HeadlessImGui {
+    ImGuiContext* context;
+
+    HeadlessImGui()
+    {
+        ImGui::SetAllocatorFunctions(countingImGuiAlloc, countingImGuiFree);
+        context = ImGui::CreateContext();
+        auto& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = k_displaySize;
+        io.DeltaTime = 1.0f / 60;
+        io.Fonts->AddFontDefault();
+        unsigned char* pixels{};
+        int width{}, height{};
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+    }
+    ~HeadlessImGui()
+    {
+        ImGui::DestroyContext(context);
+    }
+};
+
+// Args: number of sections, tracks and clips.
+void BM_UIRender(benchmark::State& state)
+{
+    HeadlessImGui imgui;
+    AppState appState;
+    appState.registerUpdaters();
+    fillAppState(appState, size_t(state.range(0)), size_t(state.range(1)), size_t(state.range(2)));
+    auto ui = UI::make(appState);
+
+    // The first frames create the windows and compute the state, these are not measured.
+    for (UNUSED int i : vi::iota(0, 3)) {
+        ui->updateState();
+        ui->render();
+    }
+
+    size_t numVertices = 0, numIndices = 0;
+    auto numAllocations0 = s_numAllocations.load();
+    for (auto _ : state) {
+        ui->updateState();
+        ui->render();
+        auto* drawData = ImGui::GetDrawData();
+        numVertices += size_t(drawData->TotalVtxCount);
+        numIndices += size_t(drawData->TotalIdxCount);
+    }
+    auto numFrames = double(state.iterations());
+    state.counters["vertices"] = benchmark::Counter(double(numVertices) / numFrames);
+    state.counters["indices"] = benchmark::Counter(double(numIndices) / numFrames);
+    state.counters["allocs"] = benchmark::Counter(double(s_numAllocations.load() - numAllocations0) / numFrames);
+}
+} // namespace
+
+void* operator new(size_t n)
+{
+    ++s_numAllocations;
+    if (auto* p = std::malloc(n)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+BENCHMARK(BM_UIRender)
+  ->Args({3, 4, 0})
+  ->Args({10, 16, 10})
+  ->Args({100, 100, 100})
+  ->Args({1000, 500, 1000})
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
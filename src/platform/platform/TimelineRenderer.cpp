@@ -0,0 +1,244 @@
+#include "TimelineRenderer.h"
+
+#include "common/common.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3/SDL_opengl.h>
+
+namespace
+{
+// The functions are loaded through SDL so the platform library doesn't need to link OpenGL and it works on Windows,
+// where only GL 1.1 is exported.
+#define TIMELINE_RENDERER_GL_FUNCTIONS(X)                         \
+    X(decltype(&::glBlendFunc), BlendFunc)                        \
+    X(decltype(&::glDisable), Disable)                            \
+    X(decltype(&::glDrawArrays), DrawArrays)                      \
+    X(decltype(&::glEnable), Enable)                              \
+    X(decltype(&::glScissor), Scissor)                            \
+    X(PFNGLATTACHSHADERPROC, AttachShader)                        \
+    X(PFNGLBINDATTRIBLOCATIONPROC, BindAttribLocation)            \
+    X(PFNGLBINDBUFFERPROC, BindBuffer)                            \
+    X(PFNGLBINDVERTEXARRAYPROC, BindVertexArray)                  \
+    X(PFNGLBUFFERDATAPROC, BufferData)                            \
+    X(PFNGLCOMPILESHADERPROC, CompileShader)                      \
+    X(PFNGLCREATEPROGRAMPROC, CreateProgram)                      \
+    X(PFNGLCREATESHADERPROC, CreateShader)                        \
+    X(PFNGLDELETEBUFFERSPROC, DeleteBuffers)                      \
+    X(PFNGLDELETEPROGRAMPROC, DeleteProgram)                      \
+    X(PFNGLDELETESHADERPROC, DeleteShader)                        \
+    X(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays)            \
+    X(PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray)  \
+    X(PFNGLGENBUFFERSPROC, GenBuffers)                            \
+    X(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays)                  \
+    X(PFNGLGETPROGRAMINFOLOGPROC, GetProgramInfoLog)              \
+    X(PFNGLGETPROGRAMIVPROC, GetProgramiv)                        \
+    X(PFNGLGETSHADERINFOLOGPROC, GetShaderInfoLog)                \
+    X(PFNGLGETSHADERIVPROC, GetShaderiv)                          \
+    X(PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation)            \
+    X(PFNGLLINKPROGRAMPROC, LinkProgram)                          \
+    X(PFNGLSHADERSOURCEPROC, ShaderSource)                        \
+    X(PFNGLUNIFORM1FPROC, Uniform1f)                              \
+    X(PFNGLUNIFORM2FPROC, Uniform2f)                              \
+    X(PFNGLUNIFORMMATRIX4FVPROC, UniformMatrix4fv)                \
+    X(PFNGLUSEPROGRAMPROC, UseProgram)                            \
+    X(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer)
+
+struct GLFunctions {
+#define X(type, name) type name = nullptr;
+    TIMELINE_RENDERER_GL_FUNCTIONS(X)
+#undef X
+
+    expected<void, string> load()
+    {
+#define X(type, name)                                                                   \
+    name = reinterpret_cast<type>(SDL_GL_GetProcAddress("gl" #name));                   \
+    if (!name) {                                                                        \
+        return unexpected(fmt::format("OpenGL function gl{} is not available", #name)); \
+    }
+        TIMELINE_RENDERER_GL_FUNCTIONS(X)
+#undef X
+        return {};
+    }
+};
+#undef TIMELINE_RENDERER_GL_FUNCTIONS
+
+constexpr GLuint k_positionAttrib = 0;
+constexpr GLuint k_colorAttrib = 1;
+
+constexpr const char* k_vertexShader = R"(
+uniform mat4 u_projection;
+uniform vec2 u_origin;
+uniform float u_scrollSeconds;
+uniform float u_pixelsPerSecond;
+in vec3 a_position; // x, seconds, yOffset
+in vec4 a_color;
+out vec4 v_color;
+void main()
+{
+    vec2 p = u_origin + vec2(a_position.x, (a_position.y - u_scrollSeconds) * u_pixelsPerSecond + a_position.z);
+    v_color = a_color;
+    gl_Position = u_projection * vec4(p, 0.0, 1.0);
+}
+)";
+
+constexpr const char* k_fragmentShader = R"(
+in vec4 v_color;
+out vec4 o_color;
+void main()
+{
+    o_color = v_color;
+}
+)";
+
+expected<GLuint, string> compileShader(const GLFunctions& gl, GLenum type, const char* glslVersion, const char* source)
+{
+    const char* sources[] = {glslVersion, "\n", source};
+    GLuint shader = gl.CreateShader(type);
+    gl.ShaderSource(shader, GLsizei(std::size(sources)), sources, nullptr);
+    gl.CompileShader(shader);
+    GLint status = GL_FALSE;
+    gl.GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_TRUE) {
+        return shader;
+    }
+    array<char, 1024> log{};
+    gl.GetShaderInfoLog(shader, GLsizei(log.size()), nullptr, log.data());
+    gl.DeleteShader(shader);
+    return unexpected(fmt::format("Failed to compile timeline shader: {}", log.data()));
+}
+
+struct TimelineRendererImpl : public TimelineRenderer {
+    GLFunctions gl;
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLuint vbo = 0;
+    GLsizei numVertices = 0;
+    GLint projectionLocation = -1;
+    GLint originLocation = -1;
+    GLint scrollSecondsLocation = -1;
+    GLint pixelsPerSecondLocation = -1;
+
+    ~TimelineRendererImpl() override
+    {
+        if (vbo) {
+            gl.DeleteBuffers(1, &vbo);
+        }
+        if (vao) {
+            gl.DeleteVertexArrays(1, &vao);
+        }
+        if (program) {
+            gl.DeleteProgram(program);
+        }
+    }
+
+    expected<void, string> init(const char* glslVersion)
+    {
+        if (auto r = gl.load(); !r) {
+            return r;
+        }
+        auto vs = compileShader(gl, GL_VERTEX_SHADER, glslVersion, k_vertexShader);
+        if (!vs) {
+            return unexpected(vs.error());
+        }
+        auto fs = compileShader(gl, GL_FRAGMENT_SHADER, glslVersion, k_fragmentShader);
+        if (!fs) {
+            gl.DeleteShader(*vs);
+            return unexpected(fs.error());
+        }
+        program = gl.CreateProgram();
+        gl.AttachShader(program, *vs);
+        gl.AttachShader(program, *fs);
+        gl.BindAttribLocation(program, k_positionAttrib, "a_position");
+        gl.BindAttribLocation(program, k_colorAttrib, "a_color");
+        gl.LinkProgram(program);
+        gl.DeleteShader(*vs);
+        gl.DeleteShader(*fs);
+        GLint status = GL_FALSE;
+        gl.GetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE) {
+            array<char, 1024> log{};
+            gl.GetProgramInfoLog(program, GLsizei(log.size()), nullptr, log.data());
+            return unexpected(fmt::format("Failed to link timeline shader: {}", log.data()));
+        }
+        projectionLocation = gl.GetUniformLocation(program, "u_projection");
+        originLocation = gl.GetUniformLocation(program, "u_origin");
+        scrollSecondsLocation = gl.GetUniformLocation(program, "u_scrollSeconds");
+        pixelsPerSecondLocation = gl.GetUniformLocation(program, "u_pixelsPerSecond");
+
+        // The attribute layout is recorded in the VAO once, `setGeometry` only replaces the buffer's contents.
+        gl.GenVertexArrays(1, &vao);
+        gl.GenBuffers(1, &vbo);
+        gl.BindVertexArray(vao);
+        gl.BindBuffer(GL_ARRAY_BUFFER, vbo);
+        gl.EnableVertexAttribArray(k_positionAttrib);
+        gl.EnableVertexAttribArray(k_colorAttrib);
+        gl.VertexAttribPointer(
+          k_positionAttrib, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, x))
+        );
+        gl.VertexAttribPointer(
+          k_colorAttrib, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, color))
+        );
+        gl.BindVertexArray(0);
+        return {};
+    }
+
+    void setGeometry(span<const Vertex> triangles) override
+    {
+        CHECK(triangles.size() % 3 == 0);
+        gl.BindBuffer(GL_ARRAY_BUFFER, vbo);
+        gl.BufferData(GL_ARRAY_BUFFER, GLsizeiptr(triangles.size_bytes()), triangles.data(), GL_STATIC_DRAW);
+        numVertices = intCast<GLsizei>(triangles.size());
+    }
+
+    void draw(const View& view) override
+    {
+        if (numVertices == 0) {
+            return;
+        }
+        const auto [x0, y0, x1, y1] = view.clipRect;
+        const auto [posX, posY] = view.displayPos;
+        const auto [scaleX, scaleY] = view.framebufferScale;
+        const float fbHeight = view.displaySize[1] * scaleY;
+        if (x1 <= x0 || y1 <= y0) {
+            return;
+        }
+        // Same orthographic projection as the ImGui backend's.
+        const float l = posX, r = posX + view.displaySize[0], t = posY, b = posY + view.displaySize[1];
+        // clang-format off
+        const float projection[4][4] = {
+            {2.0f / (r - l),    0.0f,              0.0f, 0.0f},
+            {0.0f,              2.0f / (t - b),    0.0f, 0.0f},
+            {0.0f,              0.0f,             -1.0f, 0.0f},
+            {(r + l) / (l - r), (t + b) / (b - t), 0.0f, 1.0f},
+        };
+        // clang-format on
+        gl.Enable(GL_BLEND);
+        gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        gl.Disable(GL_CULL_FACE);
+        gl.Disable(GL_DEPTH_TEST);
+        gl.Enable(GL_SCISSOR_TEST);
+        gl.Scissor(
+          GLint((x0 - posX) * scaleX),
+          GLint(fbHeight - (y1 - posY) * scaleY),
+          GLsizei((x1 - x0) * scaleX),
+          GLsizei((y1 - y0) * scaleY)
+        );
+        gl.UseProgram(program);
+        gl.UniformMatrix4fv(projectionLocation, 1, GL_FALSE, &projection[0][0]);
+        gl.Uniform2f(originLocation, view.origin[0], view.origin[1]);
+        gl.Uniform1f(scrollSecondsLocation, view.scrollSeconds);
+        gl.Uniform1f(pixelsPerSecondLocation, view.pixelsPerSecond);
+        gl.BindVertexArray(vao);
+        gl.DrawArrays(GL_TRIANGLES, 0, numVertices);
+    }
+};
+} // namespace
+
+expected<unique_ptr<TimelineRenderer>, string> TimelineRenderer::make(const char* glslVersion)
+{
+    auto r = make_unique<TimelineRendererImpl>();
+    if (auto initResult = r->init(glslVersion); !initResult) {
+        return unexpected(initResult.error());
+    }
+    return r;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common/std.h"
+
+// Draws the static geometry of the timeline (grid, markers, waveforms) from a persistent GL vertex buffer. The geometry
+// is uploaded only when it changes, a frame only sets the view uniforms and issues a single draw call, so its CPU cost
+// doesn't depend on the length of the arrangement.
+//
+// Vertices are placed in time vertically and in pixels horizontally:
+//
+//     screen.x = origin.x + x
+//     screen.y = origin.y + (seconds - scrollSeconds) * pixelsPerSecond + yOffset
+//
+// `yOffset` is in pixels so lines and markers keep their thickness when zooming.
+class TimelineRenderer
+{
+public:
+    struct Vertex {
+        float x;
+        float seconds;
+        float yOffset;
+        uint32_t color; // Same layout as ImU32.
+    };
+    // All coordinates are in ImGui's screen space, the display fields are those of ImDrawData.
+    struct View {
+        array<float, 2> origin;
+        float scrollSeconds;
+        float pixelsPerSecond;
+        array<float, 4> clipRect; // x0, y0, x1, y1
+        array<float, 2> displayPos, displaySize, framebufferScale;
+    };
+
+    // The GL context must be current, here and in all member functions.
+    static expected<unique_ptr<TimelineRenderer>, string> make(const char* glslVersion);
+    virtual ~TimelineRenderer() = default;
+
+    // Replace the geometry, a list of triangles.
+    virtual void setGeometry(span<const Vertex> triangles) = 0;
+    // Meant to be called from an ImDrawList callback. Changes the GL state, the callback should be followed by
+    // `ImDrawCallback_ResetRenderState`.
+    virtual void draw(const View& view) = 0;
+};
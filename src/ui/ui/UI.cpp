@@ -1,12 +1,19 @@
 #include "UI.h"
 
 #include "common/AppState.h"
+#include "common/AudioLevelMeters.h"
+#include "common/FrameProfiler.h"
+#include "common/FrameTextArena.h"
 #include "common/ReactiveStateEngine.h"
 #include "common/msg.h"
 #include "platform/AppMsgQueue.h"
+#include "platform/TimelineRenderer.h"
 
 #include "imgui.h"
 
+#include <filesystem>
+#include <fstream>
+
 // Record
 // Time signature 4/4
 // start
@@ -14,7 +21,36 @@
 namespace
 {
 
-constexpr auto k_targetBufferTimeRange = chr::seconds(1);
+constexpr float k_clipWaveformWidth = 200;
+constexpr float k_liveWaveformWidth = 400;
+constexpr float k_liveWaveformHeight = 60;
+constexpr float k_meterFloorDb = -60;
+constexpr float k_meterPeakReleaseDbPerSecond = 20;
+constexpr auto k_meterPeakHoldTime = chr::milliseconds(1500);
+constexpr auto k_meterPollInterval = chr::milliseconds(100); // While the meters are at the floor.
+constexpr auto k_meterSize = ImVec2(150, 8);
+// Horizontal positions in the Arrangement window.
+constexpr float k_beatMarkersX = 150;
+constexpr float k_clipLinkMarkersX = 120;
+constexpr float k_clipLinkWaveformX = 80;
+constexpr float k_clipLinkWaveformHalfWidth = 30;
+// The waveforms are uploaded to the GPU once, at a fixed resolution, independent of the zoom.
+constexpr double k_timelineWaveformColumnsPerSecond = 100;
+
+float toDb(float x)
+{
+    return x > 0 ? std::max(k_meterFloorDb, 20 * std::log10(x)) : k_meterFloorDb;
+}
+
+float toMs(FrameProfiler::Clock::duration d)
+{
+    return chr::duration<float, std::milli>(d).count();
+}
+
+double toMB(size_t bytes)
+{
+    return double(bytes) / double(1 << 20);
+}
 
 string makeMenuShortcutString(string_view s)
 {
@@ -30,12 +66,51 @@ string makeMenuShortcutString(string_view s)
     }
     return fmt::format("{}{}", prefix, s);
 }
+
+// Two triangles. x is in pixels, the vertical position is in seconds, plus an offset in pixels.
+void addTimelineQuad(
+  vector<TimelineRenderer::Vertex>& vs, float x0, float x1, float seconds0, float seconds1, float yOffset0,
+  float yOffset1, ImU32 color
+)
+{
+    const TimelineRenderer::Vertex a{x0, seconds0, yOffset0, color}, b{x1, seconds0, yOffset0, color},
+      c{x1, seconds1, yOffset1, color}, d{x0, seconds1, yOffset1, color};
+    vs.insert(vs.end(), {a, b, c, a, c, d});
+}
 } // namespace
 
 struct UIImpl : public UI {
     bool show_demo_window = false;
+    bool showFrameProfiler = false;
+    const FrameProfiler* frameProfiler = nullptr;
+    AudioLevelMeters* inputLevelMeters = nullptr;
+    TimelineRenderer* timelineRenderer = nullptr;
+    // Change timestamps of the arrangement layout and the clips the uploaded timeline geometry was built from.
+    pair<uint64_t, uint64_t> timelineGeometryTimestamps;
+    vector<TimelineRenderer::Vertex> timelineVertices;
+    // Set while building the frame, completed and used by the draw callback.
+    TimelineRenderer::View timelineView{};
+
+    // Meter ballistics: the peak jumps up and falls back at a constant rate, the peak hold stays for a while.
+    struct MeterDisplay {
+        float peakDb = k_meterFloorDb;
+        float rmsDb = k_meterFloorDb;
+        float holdDb = k_meterFloorDb;
+        chr::steady_clock::time_point holdTime;
+    };
+    array<MeterDisplay, AudioLevelMeters::k_maxNumChannels> inputMeterDisplays;
+    optional<chr::steady_clock::time_point> lastMeterUpdateTime;
     const AppState& appState;
     ReactiveStateEngine& rse;
+    optional<rse::ReadSet> lastFrameReads;
+    vector<PeakPyramid::Peak> waveformPixels;
+    vector<TimelineIndex::Interval> hoveredIntervals; // The clips under the mouse in the Arrangement window.
+    // Text formatted while building a frame, valid until the next one.
+    FrameTextArena frameText;
+    const string settingsMenuShortcut = makeMenuShortcutString(",");
+    const string quitMenuShortcut = makeMenuShortcutString("Q");
+    // Hovering a clip's play button prefetches the clip once.
+    optional<Id<AudioClip>> lastHoveredPlayButton;
 
     UIImpl(const AppState& appStateArg)
         : appState(appStateArg)
@@ -43,12 +118,130 @@ struct UIImpl : public UI {
     {
     }
 
+    void updateState() override
+    {
+        if (lastFrameReads) {
+            rse.updateAllIfNeeded(*lastFrameReads);
+        }
+    }
+
     void render() override
+    {
+        rse.beginRecordingReads();
+        renderCore();
+        lastFrameReads = rse.endRecordingReads();
+    }
+
+    bool isRefreshNeeded() override
+    {
+        return !lastFrameReads || rse.hasAnyChangedSince(*lastFrameReads);
+    }
+
+    bool isAnimating() override
+    {
+        return rse.get(appState.playedTime).has_value() || rse.get(appState.clipBeingRecordedSeconds).has_value()
+            || ImGui::IsAnyItemActive() || ImGui::GetIO().WantTextInput || areInputMetersMoving();
+    }
+
+    optional<chr::milliseconds> idlePollInterval() override
+    {
+        // The meters are polled, a signal can arrive any time while the input is running.
+        if (inputLevelMeters && inputLevelMeters->numChannels() > 0) {
+            return k_meterPollInterval;
+        }
+        return nullopt;
+    }
+
+    // True while there's a signal or a displayed meter hasn't settled at the floor: the peak is falling back or the
+    // peak hold hasn't expired.
+    bool areInputMetersMoving() const
+    {
+        if (!inputLevelMeters) {
+            return false;
+        }
+        for (size_t i : vi::iota(0u, inputLevelMeters->numChannels())) {
+            auto levels = inputLevelMeters->peek(i);
+            auto& md = inputMeterDisplays[i];
+            if (toDb(levels.peak) > k_meterFloorDb || toDb(levels.rms) > k_meterFloorDb || md.peakDb > k_meterFloorDb
+                || md.rmsDb > k_meterFloorDb || md.holdDb > k_meterFloorDb) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void updateInputMeterDisplays()
+    {
+        if (!inputLevelMeters) {
+            return;
+        }
+        auto now = chr::steady_clock::now();
+        auto dt = lastMeterUpdateTime ? chr::duration<float>(now - *lastMeterUpdateTime).count() : 0.0f;
+        lastMeterUpdateTime = now;
+        for (size_t i : vi::iota(0u, inputLevelMeters->numChannels())) {
+            auto levels = inputLevelMeters->read(i);
+            auto& md = inputMeterDisplays[i];
+            auto releasedPeakDb = std::max(k_meterFloorDb, md.peakDb - k_meterPeakReleaseDbPerSecond * dt);
+            md.peakDb = std::max(toDb(levels.peak), releasedPeakDb);
+            md.rmsDb = toDb(levels.rms);
+            if (md.holdDb <= md.peakDb) {
+                md.holdDb = md.peakDb;
+                md.holdTime = now;
+            } else if (now - md.holdTime > k_meterPeakHoldTime) {
+                md.holdDb = md.peakDb;
+            }
+        }
+    }
+
+    // One column per recorded buffer, the latest at the right edge. Only the visible tail is read.
+    void drawLiveWaveform(const vector<PeakPyramid::Peak>& columns, ImVec2 size)
+    {
+        const auto p0 = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(size);
+        auto* drawList = ImGui::GetWindowDrawList();
+        drawList->AddRectFilled(p0, p0 + size, IM_COL32(30, 30, 30, 255));
+        const auto numVisible = std::min(columns.size(), size_t(size.x));
+        const float midY = p0.y + size.y / 2;
+        const float halfHeight = size.y / 2;
+        const float x0 = p0.x + size.x - float(numVisible);
+        for (size_t i : vi::iota(0u, numVisible)) {
+            auto& p = columns[columns.size() - numVisible + i];
+            const float x = x0 + float(i) + 0.5f;
+            drawList->AddLine(
+              ImVec2(x, midY - std::clamp(p.max, -1.0f, 1.0f) * halfHeight),
+              ImVec2(x, midY - std::clamp(p.min, -1.0f, 1.0f) * halfHeight + 1),
+              IM_COL32(255, 90, 90, 255)
+            );
+        }
+    }
+
+    void drawMeter(const MeterDisplay& md)
+    {
+        const auto p0 = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(k_meterSize);
+        auto* drawList = ImGui::GetWindowDrawList();
+        auto xOf = [&](float db) {
+            return p0.x + (db - k_meterFloorDb) / -k_meterFloorDb * k_meterSize.x;
+        };
+        const auto p1 = p0 + k_meterSize;
+        drawList->AddRectFilled(p0, p1, IM_COL32(40, 40, 40, 255));
+        drawList->AddRectFilled(p0, ImVec2(xOf(md.peakDb), p1.y), IM_COL32(60, 140, 60, 255));
+        drawList->AddRectFilled(p0, ImVec2(xOf(md.rmsDb), p1.y), IM_COL32(90, 220, 90, 255));
+        if (md.holdDb > k_meterFloorDb) {
+            auto x = xOf(md.holdDb);
+            drawList->AddLine(
+              ImVec2(x, p0.y), ImVec2(x, p1.y), md.holdDb >= 0 ? IM_COL32(255, 60, 60, 255) : IM_COL32_WHITE, 2
+            );
+        }
+    }
+
+    void renderCore()
     {
         const auto& metronome = rse.get(appState.metronome);
 
         ImGuiIO& io = ImGui::GetIO();
 
+        frameText.reset();
         ImGui::NewFrame();
 
         ImGui::SetNextWindowPos(ImVec2(0, 0));
@@ -64,10 +257,30 @@ struct UIImpl : public UI {
 
         if (ImGui::BeginMainMenuBar()) {
             if (ImGui::BeginMenu("DawTracker")) {
-                if (ImGui::MenuItem("Settings", makeMenuShortcutString(",").c_str())) {
+                if (ImGui::MenuItem("Settings", settingsMenuShortcut.c_str())) {
                     sendToApp(msg::MainMenu::settings);
                 }
-                if (ImGui::MenuItem("Quit", makeMenuShortcutString("Q").c_str())) {
+                if (ImGui::MenuItem("Save project")) {
+                    sendToApp(msg::MainMenu::saveProject);
+                }
+                if (ImGui::MenuItem("Open project")) {
+                    sendToApp(msg::MainMenu::openProject);
+                }
+                if (ImGui::MenuItem("Import audio files")) {
+                    sendToApp(msg::MainMenu::importAudioFiles);
+                }
+                const bool exportingMixdown = rse.get(appState.mixdownProgress).has_value();
+                if (ImGui::MenuItem("Export mixdown (WAV)", nullptr, false, !exportingMixdown)) {
+                    sendToApp(msg::Mixdown::V(msg::Mixdown::Export{msg::Mixdown::Format::wav}));
+                }
+                if (ImGui::MenuItem("Export mixdown (FLAC)", nullptr, false, !exportingMixdown)) {
+                    sendToApp(msg::Mixdown::V(msg::Mixdown::Export{msg::Mixdown::Format::flac}));
+                }
+                if (ImGui::MenuItem("Dump state graph")) {
+                    sendToApp(msg::MainMenu::dumpStateGraph);
+                }
+                ImGui::MenuItem("Frame profiler", nullptr, &showFrameProfiler);
+                if (ImGui::MenuItem("Quit", quitMenuShortcut.c_str())) {
                     sendToApp(msg::MainMenu::quit);
                 }
                 ImGui::EndMenu();
@@ -75,28 +288,15 @@ struct UIImpl : public UI {
             ImGui::EndMainMenuBar();
         }
 
-        double avgUIRefreshHz = NAN;
-        double maxDt = NAN;
-        double avgDt = NAN;
-        if (frameTimes.size() > 1) {
-            auto maxDuration = frameTimes[0].dt;
-            auto sumDuration = chr::high_resolution_clock::duration::zero();
-            auto minT = frameTimes[0].t;
-            auto maxT = frameTimes[0].t;
-            for (auto& f : frameTimes) {
-                maxDuration = std::max(maxDuration, f.dt);
-                sumDuration += f.dt;
-                minT = std::min(minT, f.t);
-                maxT = std::max(maxT, f.t);
-            }
-            maxDt = chr::duration<double>(maxDuration).count();
-            avgDt = chr::duration<double>(sumDuration).count() / frameTimes.size();
-            avgUIRefreshHz = (frameTimes.size() - 1) / chr::duration<double>(maxT - minT).count();
+        if (frameProfiler) {
+            auto p = frameProfiler->percentiles(nullopt);
+            ImGui::TextUnformatted(
+              frameText.format("Average UI refresh: {:.2f} Hz", frameProfiler->averageFrameRate())
+            );
+            ImGui::TextUnformatted(
+              frameText.format("UI repaint time: {:.2f} ms (p99 {:.2f} ms)", toMs(p.p50), toMs(p.p99))
+            );
         }
-        ImGui::TextUnformatted(fmt::format("Average UI refresh: {:.2f} Hz", avgUIRefreshHz).c_str());
-        ImGui::TextUnformatted(
-          fmt::format("UI repaint time: {:.2f} ms (max {:.2f} ms)", avgDt * 1000, maxDt * 1000).c_str()
-        );
         ImGui::Checkbox("Demo Window",
                         &show_demo_window); // Edit bools storing our window open/close state
         bool on = metronome.on;
@@ -109,22 +309,35 @@ struct UIImpl : public UI {
             sendToApp(MAKE_VARIANT_V(msg::Metronome, BPM{bpm}));
         }
 
-        auto outputs = rse.get(appState.outputs);
+        auto& outputs = rse.get(appState.outputs);
         if (!outputs.empty()) {
             ImGui::TextUnformatted("Outputs:");
-            for (auto& i : outputs) {
-                if (ImGui::Checkbox(i.name.c_str(), &i.enabled)) {
-                    sendToApp(msg::OutputChanged{i.name, i.enabled});
+            for (auto& o : outputs) {
+                bool enabled = o.enabled;
+                if (ImGui::Checkbox(o.name.c_str(), &enabled)) {
+                    sendToApp(msg::OutputChanged{o.name, enabled});
                 }
             }
         }
 
-        auto inputs = rse.get(appState.inputs);
+        auto& inputs = rse.get(appState.inputs);
         if (!inputs.empty()) {
             ImGui::TextUnformatted("Inputs:");
+            updateInputMeterDisplays();
+            // The audio callback receives only the enabled channels, in order.
+            size_t meterIx = 0;
             for (auto& i : inputs) {
-                if (ImGui::Checkbox(i.name.c_str(), &i.enabled)) {
-                    sendToApp(msg::InputChanged{i.name, i.enabled});
+                const bool enabled = i.enabled;
+                bool checked = enabled;
+                if (ImGui::Checkbox(i.name.c_str(), &checked)) {
+                    sendToApp(msg::InputChanged{i.name, checked});
+                }
+                if (enabled && inputLevelMeters && meterIx < inputLevelMeters->numChannels()) {
+                    ImGui::SameLine(150.0f);
+                    drawMeter(inputMeterDisplays[meterIx]);
+                }
+                if (enabled) {
+                    ++meterIx;
                 }
             }
         }
@@ -138,11 +351,14 @@ struct UIImpl : public UI {
         auto clipBeingRecordedSeconds = rse.get(appState.clipBeingRecordedSeconds);
         if (clipBeingRecordedSeconds) {
             ImGui::SameLine();
-            ImGui::TextUnformatted(fmt::format("Recording {:.1f} seconds", *clipBeingRecordedSeconds).c_str());
+            ImGui::TextUnformatted(frameText.format("Recording {:.1f} seconds", *clipBeingRecordedSeconds));
         }
         if (!rse.get(appState.recordButtonEnabled)) {
             ImGui::EndDisabled();
         }
+        if (clipBeingRecordedSeconds) {
+            drawLiveWaveform(rse.get(appState.recordingWaveform), ImVec2(k_liveWaveformWidth, k_liveWaveformHeight));
+        }
 
         if (!rse.get(appState.stopButtonEnabled)) {
             ImGui::BeginDisabled();
@@ -161,7 +377,7 @@ struct UIImpl : public UI {
         auto playedTime = rse.get(appState.playedTime);
         if (playedTime) {
             ImGui::SameLine();
-            ImGui::TextUnformatted(fmt::format("Playing {:.1f} seconds", *playedTime).c_str());
+            ImGui::TextUnformatted(frameText.format("Playing {:.1f} seconds", *playedTime));
         }
         if (!rse.get(appState.playButtonEnabled)) {
             ImGui::EndDisabled();
@@ -169,15 +385,64 @@ struct UIImpl : public UI {
         if (ImGui::Button("Add track")) {
             sendToApp(msg::AddTrack{});
         }
+        if (auto mixdownProgress = rse.get(appState.mixdownProgress)) {
+            ImGui::TextUnformatted(frameText.format("Exporting mixdown {:.0f}%", 100 * *mixdownProgress));
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel export")) {
+                sendToApp(msg::Mixdown::V(msg::Mixdown::Cancel{}));
+            }
+        }
+        if (auto& autosaveError = rse.get(appState.autosaveError)) {
+            ImGui::PushStyleColor(ImGuiCol_Text, IM_COL32(255, 90, 90, 255));
+            ImGui::TextUnformatted(frameText.format("Autosave failed: {}", *autosaveError));
+            ImGui::PopStyleColor();
+        }
 
-        auto& clips = rse.get(appState.clips);
-        for (auto& [id, clip] : clips) {
-            ImGui::TextUnformatted(fmt::format("Clip #{}", id.v).c_str());
-            ImGui::SameLine(150.0f);
-            if (ImGui::Button(fmt::format("Play##{}", id.v).c_str())) {
-                sendToApp(msg::PlayClip{id});
+        // Only the visible rows are submitted.
+        auto& clipList = rse.get(appState.clipList);
+        optional<Id<AudioClip>> hoveredPlayButton;
+        if (!clipList.empty()) {
+            auto& clips = rse.get(appState.clips);
+            ImGuiListClipper clipper;
+            clipper.Begin(intCast<int>(clipList.size()));
+            while (clipper.Step()) {
+                for (int i : vi::iota(clipper.DisplayStart, clipper.DisplayEnd)) {
+                    auto& item = clipList[size_t(i)];
+                    ImGui::TextUnformatted(item.label.c_str());
+                    ImGui::SameLine(150.0f);
+                    if (ImGui::Button(item.playButtonLabel.c_str())) {
+                        sendToApp(msg::PlayClip{item.id});
+                    }
+                    if (ImGui::IsItemHovered()) {
+                        hoveredPlayButton = item.id;
+                    }
+                    ImGui::SameLine();
+                    drawWaveform(clips.at(item.id), ImVec2(k_clipWaveformWidth, ImGui::GetFrameHeight()));
+                }
             }
         }
+        if (hoveredPlayButton && hoveredPlayButton != lastHoveredPlayButton) {
+            sendToApp(msg::PrefetchClip{*hoveredPlayButton});
+        }
+        lastHoveredPlayButton = hoveredPlayButton;
+
+        auto& css = rse.get(appState.clipStorageStats);
+        if (css.numCompressedClips > 0) {
+            ImGui::TextUnformatted(frameText.format(
+              "Clip memory: {:.1f} MB decoded ({} clips), {:.1f} MB compressed from {:.1f} MB ({} clips)",
+              toMB(css.decodedBytes),
+              css.numDecodedClips,
+              toMB(css.compressedBytes),
+              toMB(css.compressedClipsDecodedBytes),
+              css.numCompressedClips
+            ));
+            ImGui::TextUnformatted(frameText.format(
+              "Compression: {:.2f} s, decompression: {:.2f} s ({} on playback)",
+              css.compressionTime.count(),
+              css.decompressionTime.count(),
+              css.numSynchronousDecompressions
+            ));
+        }
 
         ImGui::End();
 
@@ -249,8 +514,6 @@ struct UIImpl : public UI {
 
         constexpr int k_arrangementX = 300;
         constexpr int k_arrangementWidth = 200;
-        constexpr float k_pixelsPerSeconds = 40.0f;
-        constexpr int k_beatMarkersX = 150;
         ImGui::SetNextWindowPos(ImVec2(k_arrangementX, 0));
         ImGui::SetNextWindowSize(ImVec2(k_arrangementWidth, io.DisplaySize.y));
         ImGui::Begin(
@@ -260,69 +523,87 @@ struct UIImpl : public UI {
             | ImGuiWindowFlags_NoSavedSettings
         );
 
-        auto& sections = rse.get(appState.sections);
-        auto& sectionOrder = rse.get(appState.sectionOrder);
-        int sectionIx = 0;
-        for (auto& sectionId : sectionOrder) {
-            auto& section = sections.at(sectionId);
-            auto secondsOfSection = boost::rational_cast<float>(section.duration(metronome.tempo));
+        // Sections are placed at their precomputed y, the ones outside the visible area are skipped.
+        auto& layout = rse.get(appState.arrangementLayout);
+        const auto contentOrigin = ImGui::GetCursorScreenPos();
+        const auto contentWidth = ImGui::GetContentRegionAvail().x;
+        auto* drawList = ImGui::GetWindowDrawList();
+        // The grid and the clip links are drawn under the sections' child windows, either from the GPU buffers or
+        // with ImDrawList calls.
+        if (timelineRenderer) {
+            updateTimelineGeometry(layout, rse.get(appState.clips));
+            const auto scrollY = ImGui::GetScrollY();
+            timelineView.origin = {contentOrigin.x, contentOrigin.y + scrollY};
+            timelineView.scrollSeconds = scrollY / ArrangementLayout::k_pixelsPerSecond;
+            timelineView.pixelsPerSecond = ArrangementLayout::k_pixelsPerSecond;
+            drawList->AddCallback(drawTimeline, this);
+            drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+        } else {
+            for (auto& cl : layout.clipLinks) {
+                drawList->AddLine(
+                  contentOrigin + ImVec2(k_clipLinkMarkersX - 10, cl.y),
+                  contentOrigin + ImVec2(k_clipLinkMarkersX + 10, cl.y),
+                  IM_COL32(80, 160, 255, 255),
+                  2
+                );
+            }
+        }
+        for (size_t sectionIx : vi::iota(0u, layout.sections.size())) {
+            auto& sl = layout.sections[sectionIx];
+            const auto sectionPos = contentOrigin + ImVec2(0, sl.y);
+            if (!ImGui::IsRectVisible(sectionPos, sectionPos + ImVec2(contentWidth, sl.height))) {
+                continue;
+            }
+            ImGui::SetCursorScreenPos(sectionPos);
+            ImGui::PushID(intCast<int>(sectionIx));
             ImGui::BeginChild(
-              fmt::format("ArrangementSection{}", sectionIx++).c_str(),
-              ImVec2(ImGui::GetContentRegionAvail().x, secondsOfSection * k_pixelsPerSeconds),
+              "ArrangementSection",
+              ImVec2(contentWidth, sl.height),
               ImGuiChildFlags_Borders,
               ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse
             );
-            auto tempo = section.tempo.value_or(metronome.tempo);
-            ImGui::TextUnformatted(fmt::format("name: {}, {} s", section.name, secondsOfSection).c_str());
-            const auto windowPos = ImGui::GetWindowPos();
-            switch_variant(
-              section.structure,
-              [&](const Bars& x) {
-                  float secondsInBars = 0;
-                  for (auto& b : x.bars) {
-                      ImGui::TextUnformatted(fmt::format("{}/{}", b.timeSignature.upper, b.timeSignature.lower).c_str()
-                      );
-                      const auto beatInSeconds = boost::rational_cast<float>(60 / tempo / b.timeSignature.lower);
-                      bool firstInBar = true;
-                      for (UNUSED auto beatIxInBar : vi::iota(0, b.timeSignature.upper)) {
-                          auto y = secondsInBars * k_pixelsPerSeconds;
-                          if (firstInBar) {
-                              ImGui::GetWindowDrawList()->AddLine(
-                                windowPos + ImVec2(k_beatMarkersX - 10, y),
-                                windowPos + ImVec2(k_beatMarkersX + 10, y),
-                                IM_COL32_WHITE,
-                                2
-                              );
-                              firstInBar = false;
-                          } else {
-                              ImGui::GetWindowDrawList()->AddCircleFilled(
-                                windowPos + ImVec2(k_beatMarkersX, y), 1, IM_COL32_WHITE
-                              );
-                          }
-                          secondsInBars += beatInSeconds;
-                      }
-                  }
-              },
-              [&](const Period& x) {
-                  ImGui::TextUnformatted(
-                    fmt::format("{:.2f} whole notes", boost::rational_cast<float>(x.wholeNotes)).c_str()
-                  );
-                  auto numWholeBeats =
-                    (x.wholeNotes.numerator() * metronome.timeSignature.lower) / x.wholeNotes.denominator() + 1;
-                  for (int64_t i : vi::iota(0, numWholeBeats)) {
-                      auto y = boost::rational_cast<float>(Rational(i) / tempo * 60) * k_pixelsPerSeconds;
-                      ImGui::GetWindowDrawList()->AddCircleFilled(
-                        windowPos + ImVec2(k_beatMarkersX, y), 1, IM_COL32_WHITE
-                      );
-                  }
-              },
-              [](const Duration& x) {
-                  ImGui::TextUnformatted(fmt::format("{:.2f} seconds", boost::rational_cast<float>(x.seconds)).c_str());
-              }
-            );
-
+            for (auto& line : sl.textLines) {
+                ImGui::TextUnformatted(line.c_str());
+            }
+            if (!timelineRenderer) {
+                const auto windowPos = ImGui::GetWindowPos();
+                auto* sectionDrawList = ImGui::GetWindowDrawList();
+                const auto beatMarkers =
+                  span(layout.beatMarkers).subspan(sl.beatMarkersBegin, sl.beatMarkersEnd - sl.beatMarkersBegin);
+                for (auto& m : beatMarkers) {
+                    if (m.barStart) {
+                        sectionDrawList->AddLine(
+                          windowPos + ImVec2(k_beatMarkersX - 10, m.yInSection),
+                          windowPos + ImVec2(k_beatMarkersX + 10, m.yInSection),
+                          IM_COL32_WHITE,
+                          2
+                        );
+                    } else {
+                        sectionDrawList->AddCircleFilled(
+                          windowPos + ImVec2(k_beatMarkersX, m.yInSection), 1, IM_COL32_WHITE
+                        );
+                    }
+                }
+            }
             ImGui::EndChild();
+            ImGui::PopID();
+        }
+        if (ImGui::IsWindowHovered(ImGuiHoveredFlags_ChildWindows)) {
+            auto& timelineIndex = rse.get(appState.timelineIndex);
+            const auto seconds = (ImGui::GetMousePos().y - contentOrigin.y) / ArrangementLayout::k_pixelsPerSecond;
+            hoveredIntervals.clear();
+            timelineIndex.at(timelineIndex.toSamples(seconds), hoveredIntervals);
+            if (!hoveredIntervals.empty()) {
+                ImGui::BeginTooltip();
+                ImGui::TextUnformatted(frameText.format("{:.2f} s", seconds));
+                for (auto& x : hoveredIntervals) {
+                    ImGui::TextUnformatted(frameText.format("Clip #{}", x.audioClipId.v));
+                }
+                ImGui::EndTooltip();
+            }
         }
+        ImGui::SetCursorScreenPos(contentOrigin);
+        ImGui::Dummy(ImVec2(contentWidth, float(layout.durationSeconds) * ArrangementLayout::k_pixelsPerSecond));
         ImGui::End();
 
         constexpr int k_tracksWidth = 400;
@@ -336,14 +617,19 @@ struct UIImpl : public UI {
             | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_HorizontalScrollbar
         );
         ImGui::PushStyleVar(ImGuiStyleVar_SelectableTextAlign, ImVec2(0.5f, 0.0f));
-        int ix = 0;
+        // Only the visible columns are submitted, a dummy item at the end keeps the horizontal scroll range.
+        auto& trackLabels = rse.get(appState.trackLabels);
         auto y0 = ImGui::GetCursorPosY();
-        for (auto& trackId : rse.get(appState.trackOrder)) {
-            auto& track = rse.get(appState.tracks).at(trackId);
+        const auto scrollX = ImGui::GetScrollX();
+        const auto firstVisibleIx = std::min(trackLabels.size(), size_t(scrollX / k_trackWidth));
+        const auto endVisibleIx =
+          std::min(trackLabels.size(), size_t((scrollX + ImGui::GetWindowWidth()) / k_trackWidth) + 1);
+        for (size_t ix : vi::iota(firstVisibleIx, endVisibleIx)) {
             ImGui::SetCursorPos(ImVec2(floatFromInt<float>(ix) * k_trackWidth, y0));
-            ImGui::Selectable(track.name.c_str(), false, 0, ImVec2(k_trackWidth, 15));
-            ++ix;
+            ImGui::Selectable(trackLabels[ix].c_str(), false, 0, ImVec2(k_trackWidth, 15));
         }
+        ImGui::SetCursorPos(ImVec2(floatFromInt<float>(trackLabels.size()) * k_trackWidth, y0));
+        ImGui::Dummy(ImVec2(0, 15));
         ImGui::PopStyleVar();
         ImGui::End();
         // 3. Show another simple window.
@@ -360,29 +646,181 @@ struct UIImpl : public UI {
         //    ImGui::End();
         //}
 
+        if (showFrameProfiler && frameProfiler) {
+            renderFrameProfiler(*frameProfiler);
+        }
+
         // Rendering
         ImGui::Render();
     }
-    struct FrameTimeItem {
-        chr::high_resolution_clock::time_point t;
-        chr::high_resolution_clock::duration dt;
-    };
-    vector<FrameTimeItem> frameTimes;
-    size_t nextFrameTimeIx = 0;
-    void addFrameTime(chr::high_resolution_clock::time_point t, chr::high_resolution_clock::duration dt) override
+    // First channel of the clip, one vertical min-max line per pixel with the RMS range drawn over it.
+    void drawWaveform(const AudioClip& clip, ImVec2 size)
     {
-        // Maintain frameTimes as a circular buffer.
-        if (frameTimes.size() <= nextFrameTimeIx) {
-            frameTimes.push_back(FrameTimeItem{t, dt});
-            nextFrameTimeIx = frameTimes.size();
-        } else {
-            frameTimes[nextFrameTimeIx++] = FrameTimeItem{t, dt};
+        const auto p0 = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(size);
+        if (clip.numChannels() == 0 || clip.size() == 0 || !ImGui::IsItemVisible()) {
+            return;
+        }
+        waveformPixels.resize(size_t(size.x));
+        clip.waveform(0, 0, clip.size(), waveformPixels);
+        auto* drawList = ImGui::GetWindowDrawList();
+        const float midY = p0.y + size.y / 2;
+        const float halfHeight = size.y / 2;
+        for (size_t i : vi::iota(0u, waveformPixels.size())) {
+            auto& p = waveformPixels[i];
+            const float x = p0.x + float(i) + 0.5f;
+            const float rms = std::min(std::sqrt(p.meanSquare), 1.0f);
+            drawList->AddLine(
+              ImVec2(x, midY - std::clamp(p.max, -1.0f, 1.0f) * halfHeight),
+              ImVec2(x, midY - std::clamp(p.min, -1.0f, 1.0f) * halfHeight + 1),
+              IM_COL32(80, 160, 255, 255)
+            );
+            drawList->AddLine(
+              ImVec2(x, midY - rms * halfHeight), ImVec2(x, midY + rms * halfHeight + 1), IM_COL32(180, 220, 255, 255)
+            );
+        }
+    }
+
+    void setFrameProfiler(const FrameProfiler* frameProfilerArg) override
+    {
+        frameProfiler = frameProfilerArg;
+    }
+
+    void setInputLevelMeters(AudioLevelMeters* inputLevelMetersArg) override
+    {
+        inputLevelMeters = inputLevelMetersArg;
+    }
+
+    void setTimelineRenderer(TimelineRenderer* timelineRendererArg) override
+    {
+        timelineRenderer = timelineRendererArg;
+        timelineGeometryTimestamps = {};
+    }
+
+    // The grid, the clip link markers and the first channel of the linked clips' waveforms, in timeline coordinates
+    // (x in pixels, y in seconds). Rebuilt and uploaded only when the layout or the clip extents change, not when
+    // ClipTiering compresses or decompresses a clip.
+    void updateTimelineGeometry(const ArrangementLayout& layout, const SlotMap<Id<AudioClip>, AudioClip>& clips)
+    {
+        rse.get(appState.clipExtents); // Brings its timestamp up to date.
+        const auto timestamps =
+          pair(rse.changeTimestamp(appState.arrangementLayout), rse.changeTimestamp(appState.clipExtents));
+        if (timestamps == timelineGeometryTimestamps) {
+            return;
+        }
+        timelineGeometryTimestamps = timestamps;
+        timelineVertices.clear();
+        for (auto& sl : layout.sections) {
+            const auto beatMarkers =
+              span(layout.beatMarkers).subspan(sl.beatMarkersBegin, sl.beatMarkersEnd - sl.beatMarkersBegin);
+            for (auto& m : beatMarkers) {
+                const auto seconds = float(sl.startSeconds) + m.yInSection / ArrangementLayout::k_pixelsPerSecond;
+                const float halfWidth = m.barStart ? 10 : 1;
+                addTimelineQuad(
+                  timelineVertices,
+                  k_beatMarkersX - halfWidth,
+                  k_beatMarkersX + halfWidth,
+                  seconds,
+                  seconds,
+                  -1,
+                  1,
+                  IM_COL32_WHITE
+                );
+            }
+        }
+        for (auto& cl : layout.clipLinks) {
+            const auto originSeconds = float(cl.clipOriginSeconds);
+            addTimelineQuad(
+              timelineVertices,
+              k_clipLinkMarkersX - 10,
+              k_clipLinkMarkersX + 10,
+              originSeconds,
+              originSeconds,
+              -1,
+              1,
+              IM_COL32(80, 160, 255, 255)
+            );
+            auto it = clips.find(cl.audioClipId);
+            if (it == clips.end() || it->second.numChannels() == 0 || it->second.size() == 0) {
+                continue;
+            }
+            auto& clip = it->second;
+            const double durationSeconds = double(clip.size()) / clip.sampleRate;
+            const auto numColumns =
+              std::max<size_t>(1, size_t(std::ceil(durationSeconds * k_timelineWaveformColumnsPerSecond)));
+            waveformPixels.resize(numColumns);
+            clip.waveform(0, 0, clip.size(), waveformPixels);
+            const double columnSeconds = durationSeconds / double(numColumns);
+            for (size_t i : vi::iota(0u, numColumns)) {
+                auto& p = waveformPixels[i];
+                const float x0 = k_clipLinkWaveformX + std::clamp(p.min, -1.0f, 1.0f) * k_clipLinkWaveformHalfWidth;
+                const float x1 = k_clipLinkWaveformX + std::clamp(p.max, -1.0f, 1.0f) * k_clipLinkWaveformHalfWidth;
+                addTimelineQuad(
+                  timelineVertices,
+                  x0,
+                  std::max(x1, x0 + 1),
+                  originSeconds + float(double(i) * columnSeconds),
+                  originSeconds + float(double(i + 1) * columnSeconds),
+                  0,
+                  0,
+                  IM_COL32(80, 160, 255, 160)
+                );
+            }
+        }
+        timelineRenderer->setGeometry(timelineVertices);
+    }
+
+    static void drawTimeline(const ImDrawList*, const ImDrawCmd* cmd)
+    {
+        auto* self = static_cast<UIImpl*>(cmd->UserCallbackData);
+        auto* drawData = ImGui::GetDrawData();
+        auto view = self->timelineView;
+        view.clipRect = {cmd->ClipRect.x, cmd->ClipRect.y, cmd->ClipRect.z, cmd->ClipRect.w};
+        view.displayPos = {drawData->DisplayPos.x, drawData->DisplayPos.y};
+        view.displaySize = {drawData->DisplaySize.x, drawData->DisplaySize.y};
+        view.framebufferScale = {drawData->FramebufferScale.x, drawData->FramebufferScale.y};
+        self->timelineRenderer->draw(view);
+    }
+
+    void renderFrameProfiler(const FrameProfiler& fp)
+    {
+        ImGui::SetNextWindowBgAlpha(0.8f);
+        ImGui::Begin(
+          "Frame profiler", &showFrameProfiler, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings
+        );
+        ImGui::TextUnformatted(frameText.format("{} frames, {:.1f} Hz", fp.numFrames(), fp.averageFrameRate()));
+        if (ImGui::BeginTable("Stages", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit)) {
+            for (auto* h : {"Stage (ms)", "p50", "p95", "p99"}) {
+                ImGui::TableSetupColumn(h);
+            }
+            ImGui::TableHeadersRow();
+            auto row = [](string_view name, const FrameProfiler::Percentiles& p) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(name.data(), name.data() + name.size());
+                for (auto d : {p.p50, p.p95, p.p99}) {
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.2f", double(toMs(d)));
+                }
+            };
+            for (size_t i : vi::iota(0u, FrameProfiler::k_numStages)) {
+                auto stage = FrameProfiler::Stage(i);
+                row(FrameProfiler::stageName(stage), fp.percentiles(stage));
+            }
+            row("frame", fp.percentiles(nullopt));
+            ImGui::EndTable();
         }
-        auto bufferTimeRange = t - frameTimes[0].t;
-        if (bufferTimeRange > k_targetBufferTimeRange) {
-            frameTimes.resize(nextFrameTimeIx);
-            nextFrameTimeIx = 0;
+        if (ImGui::Button("Export Chrome trace")) {
+            auto filename = std::filesystem::temp_directory_path() / "dawtracker_frames.json";
+            std::ofstream f(filename);
+            f << fp.chromeTraceJson();
+            if (!f) {
+                LOG(ERROR) << fmt::format("Failed to write {}", filename);
+            } else {
+                LOG(INFO) << fmt::format("Frame trace written to {}", filename);
+            }
         }
+        ImGui::End();
     }
 };
 
@@ -3,12 +3,31 @@
 #include "common/std.h"
 
 struct AppState;
+class FrameProfiler;
+class AudioLevelMeters;
+class TimelineRenderer;
 
 class UI
 {
 public:
     static unique_ptr<UI> make(const AppState& appState);
     virtual ~UI() = default;
+    // Bring the AppState read by the last frame up-to-date so `render` doesn't have to recompute it while building the
+    // frame.
+    virtual void updateState() = 0;
     virtual void render() = 0;
-    virtual void addFrameTime(chr::high_resolution_clock::time_point t, chr::high_resolution_clock::duration dt) = 0;
+    // True if any of the AppState variables read by the last `render` has changed since.
+    virtual bool isRefreshNeeded() = 0;
+    // True if the screen changes without AppState changes, e.g. during playback or while dragging a widget.
+    virtual bool isAnimating() = 0;
+    // While idle, `isAnimating` needs to be checked at this interval for changes which come without events, e.g. a
+    // signal arriving at the input meters. nullopt if it's enough to check it after events.
+    virtual optional<chr::milliseconds> idlePollInterval() = 0;
+    // Used for the frame statistics and the frame profiler overlay, can be nullptr.
+    virtual void setFrameProfiler(const FrameProfiler* frameProfiler) = 0;
+    // Read at every frame for the input meters, can be nullptr.
+    virtual void setInputLevelMeters(AudioLevelMeters* inputLevelMeters) = 0;
+    // Draws the grid and the waveforms of the Arrangement window from GPU buffers. Can be nullptr, then the grid is
+    // drawn with ImDrawList calls.
+    virtual void setTimelineRenderer(TimelineRenderer* timelineRenderer) = 0;
 };